@@ -52,11 +52,25 @@ enum {
 	/** Maximum active async calls per phone */
 	IPC_MAX_ASYNC_CALLS = 64,
 
+	/** Maximum number of items received by one batched IPC wait */
+	IPC_WAIT_BATCH_MAX = 32,
+
 	/**
 	 * Maximum buffer size allowed for IPC_M_DATA_WRITE and
 	 * IPC_M_DATA_READ requests.
 	 */
 	DATA_XFER_LIMIT = 64 * 1024,
+
+	/**
+	 * Maximum buffer size allowed for IPC_M_DATA_WRITE and
+	 * IPC_M_DATA_READ requests whose buffer the kernel is able to pin
+	 * and transfer without an intermediate kernel copy. IPC_M_DATA_READ
+	 * requests of at least a page may be this large regardless of their
+	 * buffer. IPC_M_DATA_WRITE requests above DATA_XFER_LIMIT should use
+	 * IPC_XF_RESTRICT so that they are cut down to DATA_XFER_LIMIT should
+	 * the buffer turn out not pinnable.
+	 */
+	DATA_XFER_LIMIT_PINNED = 4 * 1024 * 1024,
 };
 
 /* Flags for calls */
@@ -70,6 +70,8 @@ typedef struct {
 	uint16_t frequency_mhz;  /**< Frequency in MHz */
 	uint64_t idle_cycles;    /**< Number of idle cycles */
 	uint64_t busy_cycles;    /**< Number of busy cycles */
+	uint64_t steal_attempts; /**< Number of idle work stealing attempts */
+	uint64_t steals;         /**< Number of threads stolen when idle */
 } stats_cpu_t;
 
 /** Physical memory statistics
@@ -80,6 +82,9 @@ typedef struct {
 	uint64_t unavail;  /**< Unavailable (reserved, firmware) bytes */
 	uint64_t used;     /**< Allocated physical memory (bytes) */
 	uint64_t free;     /**< Free physical memory (bytes) */
+	uint64_t cached;   /**< Free memory in per-CPU frame caches (bytes) */
+	uint64_t cache_hits;    /**< Allocations served by frame caches */
+	uint64_t cache_misses;  /**< Frame cache refills */
 } stats_physmem_t;
 
 /** IPC statistics
@@ -81,6 +81,10 @@ typedef struct {
 	tss_t *tss;
 
 	size_t iomapver_copy;  /** Copy of TASK's I/O Permission bitmap generation count. */
+
+	uint32_t l_apic_tick;        /** Local APIC timer count of one clock tick. */
+	uint32_t l_apic_stop_count;  /** Local APIC timer count of tickless idle. */
+	uint32_t l_apic_stop_phase;  /** Count left to the next tick when stopped. */
 } cpu_arch_t;
 
 #endif
@@ -39,12 +39,14 @@
 #include <arch/boot/boot.h>
 #include <assert.h>
 #include <mm/page.h>
+#include <time/clock.h>
 #include <time/delay.h>
 #include <interrupt.h>
 #include <arch/interrupt.h>
 #include <log.h>
 #include <arch/asm.h>
 #include <arch.h>
+#include <cpu.h>
 #include <ddi/irq.h>
 #include <genarch/pic/pic_ops.h>
 
@@ -180,6 +182,81 @@ static void l_apic_timer_irq_handler(irq_t *irq)
 	irq_spinlock_lock(&irq->lock, false);
 }
 
+/** Stop the periodic tick of the local APIC timer.
+ *
+ * The timer is switched to one-shot mode so that it expires when
+ * the n-th periodic tick would have.
+ *
+ * @param ticks Number of ticks to skip (at least 1).
+ *
+ */
+static void l_apic_timer_stop(uint64_t ticks)
+{
+	uint32_t phase = l_apic[CCRT];
+	uint64_t max = (UINT32_MAX - phase) / CPU->arch.l_apic_tick + 1;
+
+	if (ticks > max)
+		ticks = max;
+
+	CPU->arch.l_apic_stop_phase = phase;
+	CPU->arch.l_apic_stop_count = phase +
+	    (uint32_t) (ticks - 1) * CPU->arch.l_apic_tick;
+
+	lvt_tm_t tm;
+	tm.value = l_apic[LVT_Tm];
+	tm.mode = TIMER_ONESHOT;
+	l_apic[LVT_Tm] = tm.value;
+
+	l_apic[ICRT] = CPU->arch.l_apic_stop_count;
+}
+
+/** Restart the periodic tick of the local APIC timer.
+ *
+ * @return Number of ticks elapsed since l_apic_timer_stop() not counting
+ *         the tick delivered by the one-shot expiration.
+ *
+ */
+static uint64_t l_apic_timer_restart(void)
+{
+	uint32_t left = l_apic[CCRT];
+	uint32_t elapsed = CPU->arch.l_apic_stop_count - left;
+
+	lvt_tm_t tm;
+	tm.value = l_apic[LVT_Tm];
+	tm.mode = TIMER_PERIODIC;
+	l_apic[LVT_Tm] = tm.value;
+
+	l_apic[ICRT] = CPU->arch.l_apic_tick;
+
+	if (elapsed < CPU->arch.l_apic_stop_phase)
+		return 0;
+
+	uint64_t ticks = 1 + (elapsed - CPU->arch.l_apic_stop_phase) /
+	    CPU->arch.l_apic_tick;
+
+	/*
+	 * Once expired, the timer interrupt has been or is going to be
+	 * delivered and clock() accounts for it by itself.
+	 */
+	if (left == 0)
+		ticks--;
+
+	return ticks;
+}
+
+/** Wake up a CPU sleeping with its local APIC timer stopped. */
+static void l_apic_timer_kick(cpu_t *cpu)
+{
+	(void) l_apic_send_custom_ipi((uint8_t) cpu->arch.id,
+	    VECTOR_WAKEUP_IPI);
+}
+
+static clock_tickless_ops_t l_apic_tickless_ops = {
+	.stop = l_apic_timer_stop,
+	.restart = l_apic_timer_restart,
+	.kick = l_apic_timer_kick
+};
+
 /** Get Local APIC ID.
  *
  * @return Local APIC ID.
@@ -246,6 +323,8 @@ void apic_init(void)
 	l_apic_debug();
 
 	bsp_l_apic = l_apic_id();
+
+	clock_tickless_ops = &l_apic_tickless_ops;
 }
 
 /** Poll for APIC errors.
@@ -510,7 +589,8 @@ void l_apic_init(void)
 	delay(1000000 / HZ);
 	uint32_t t2 = l_apic[CCRT];
 
-	l_apic[ICRT] = t1 - t2;
+	CPU->arch.l_apic_tick = t1 - t2;
+	l_apic[ICRT] = CPU->arch.l_apic_tick;
 
 	/* Program Logical Destination Register. */
 	assert(CPU->id < 8);
@@ -42,12 +42,41 @@
 #define BITMAP_ELEMENT   8
 #define BITMAP_REMAINER  7
 
+/** Number of bits summarized by one leaf of the summary tree */
+#define BITMAP_SUMMARY_LEAF  64
+
+/** Node of the bitmap summary tree
+ *
+ * Describes the runs of zero bits within the part of the bitmap
+ * covered by the node.
+ *
+ */
+typedef struct {
+	/** Number of zero bits at the start of the node */
+	uint32_t prefix;
+	/** Number of zero bits at the end of the node */
+	uint32_t suffix;
+	/** Longest run of zero bits within the node */
+	uint32_t longest;
+} bitmap_node_t;
+
 typedef struct {
 	size_t elements;
 	uint8_t *bits;
 	size_t next_fit;
+
+	/**
+	 * Optional summary tree (NULL if not present). The tree is stored
+	 * as an implicit binary tree with the root at index 1 and leaves
+	 * at indices summary_leaves to 2 * summary_leaves - 1.
+	 */
+	bitmap_node_t *summary;
+	/** Number of leaves of the summary tree (a power of two) */
+	size_t summary_leaves;
 } bitmap_t;
 
+extern void bitmap_summary_update(bitmap_t *, size_t, size_t);
+
 static inline void bitmap_set(bitmap_t *bitmap, size_t element,
     unsigned int value)
 {
@@ -63,6 +92,9 @@ static inline void bitmap_set(bitmap_t *bitmap, size_t element,
 		bitmap->bits[byte] &= ~mask;
 		bitmap->next_fit = byte;
 	}
+
+	if (bitmap->summary != NULL)
+		bitmap_summary_update(bitmap, element, 1);
 }
 
 static inline unsigned int bitmap_get(bitmap_t *bitmap, size_t element)
@@ -79,6 +111,9 @@ static inline unsigned int bitmap_get(bitmap_t *bitmap, size_t element)
 extern size_t bitmap_size(size_t);
 extern void bitmap_initialize(bitmap_t *, size_t, void *);
 
+extern size_t bitmap_summary_size(size_t);
+extern void bitmap_summary_initialize(bitmap_t *, void *);
+
 extern void bitmap_set_range(bitmap_t *, size_t, size_t);
 extern void bitmap_clear_range(bitmap_t *, size_t, size_t);
 
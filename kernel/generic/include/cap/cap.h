@@ -110,18 +110,53 @@ typedef struct cap {
 	/* Link to the task's capabilities of the same kobject type. */
 	link_t type_link;
 
-	ht_link_t caps_link;
-
 	/* The underlying kernel object. */
 	kobject_t *kobject;
 } cap_t;
 
+/** Number of low bits of a capability handle indexing a table leaf */
+#define CAP_TABLE_LEAF_BITS  9
+#define CAP_TABLE_LEAF_SIZE  (1 << CAP_TABLE_LEAF_BITS)
+
+/** Number of leaves of the capability table */
+#define CAP_TABLE_LEAVES  1024
+
+/** Number of capability handles a task can have */
+#define CAP_TABLE_CAPACITY  (CAP_TABLE_LEAVES * CAP_TABLE_LEAF_SIZE)
+
+/*
+ * Slot of the capability table.
+ *
+ * The kobject member mirrors the kobject of a published capability and can
+ * be read without the cap_info_t lock by kobject_get(). Such a reader
+ * announces itself in the readers counter for the short time it takes to
+ * add its reference to the kobject. Whoever clears the kobject member waits
+ * for the counter to drop to zero before it drops the capability's
+ * reference.
+ */
+typedef struct cap_slot {
+	/** Published kernel object or NULL. */
+	_Atomic(kobject_t *) kobject;
+	/** Number of lock-free readers inspecting the slot. */
+	atomic_size_t readers;
+	/** Capability using the slot, protected by the cap_info_t lock. */
+	cap_t *cap;
+} cap_slot_t;
+
+typedef struct cap_leaf {
+	cap_slot_t slot[CAP_TABLE_LEAF_SIZE];
+} cap_leaf_t;
+
 typedef struct cap_info {
 	mutex_t lock;
 
 	list_t type_list[KOBJECT_TYPE_MAX];
 
-	hash_table_t caps;
+	/*
+	 * Capability table indexed by handle. Leaves are allocated under the
+	 * lock when first needed and are not freed before the task is.
+	 */
+	_Atomic(cap_leaf_t *) leaves[CAP_TABLE_LEAVES];
 	ra_arena_t *handles;
 } cap_info_t;
 
@@ -35,11 +35,13 @@
 #ifndef KERN_CPU_H_
 #define KERN_CPU_H_
 
+#include <mm/frame.h>
 #include <mm/tlb.h>
 #include <synch/spinlock.h>
 #include <proc/scheduler.h>
 #include <arch/cpu.h>
 #include <arch/context.h>
+#include <time/timeout_wheel.h>
 #include <adt/list.h>
 #include <arch.h>
 
@@ -59,10 +61,15 @@ typedef struct cpu {
 
 	atomic_size_t nrdy;
 	runq_t rq[RQ_COUNT];
+	/**
+	 * Bit i is set if and only if rq[i] is not empty.
+	 * Updated with the respective rq[i].lock held.
+	 */
+	atomic_uint rq_mask;
 	volatile size_t needs_relink;
 
 	IRQ_SPINLOCK_DECLARE(timeoutlock);
-	list_t timeout_active_list;
+	timeout_wheel_t timeout_wheel;
 
 	/**
 	 * When system clock loses a tick, it is
@@ -73,6 +80,12 @@ typedef struct cpu {
 	 */
 	size_t missed_clock_ticks;
 
+	/**
+	 * The periodic tick is stopped while the CPU is idle.
+	 * See clock_tickless_enter().
+	 */
+	atomic_bool tickless;
+
 	/**
 	 * Processor cycle accounting.
 	 */
@@ -81,6 +94,17 @@ typedef struct cpu {
 	uint64_t idle_cycles;
 	uint64_t busy_cycles;
 
+	/**
+	 * Work stealing statistics of an idle processor.
+	 */
+	uint64_t steal_attempts;
+	uint64_t steals;
+
+	/**
+	 * Cache of free frames for single-frame allocations.
+	 */
+	frame_cache_t frame_cache;
+
 	/**
 	 * Processor ID assigned by kernel.
 	 */
@@ -104,6 +128,28 @@ typedef struct cpu {
 
 extern cpu_t *cpus;
 
+/** Mark run queue as non-empty
+ *
+ * @param cpu CPU owning the run queue.
+ * @param i   Index of the run queue (with its lock held).
+ *
+ */
+static inline void cpu_rq_mark(cpu_t *cpu, unsigned int i)
+{
+	atomic_fetch_or(&cpu->rq_mask, 1U << i);
+}
+
+/** Mark run queue as empty
+ *
+ * @param cpu CPU owning the run queue.
+ * @param i   Index of the run queue (with its lock held).
+ *
+ */
+static inline void cpu_rq_unmark(cpu_t *cpu, unsigned int i)
+{
+	atomic_fetch_and(&cpu->rq_mask, ~(1U << i));
+}
+
 extern void cpu_init(void);
 extern void cpu_list(void);
 
@@ -39,6 +39,7 @@
 #include <synch/mutex.h>
 #include <synch/waitq.h>
 #include <abi/ipc/ipc.h>
+#include <ipc/xfer.h>
 #include <abi/proc/task.h>
 #include <typedefs.h>
 #include <mm/slab.h>
@@ -165,6 +166,9 @@ typedef struct call {
 
 	/** Buffer for IPC_M_DATA_WRITE and IPC_M_DATA_READ. */
 	uint8_t *buffer;
+
+	/** Caller's buffer pinned for IPC_M_DATA_WRITE and IPC_M_DATA_READ. */
+	ipc_pinned_t pinned;
 } call_t;
 
 extern slab_cache_t *phone_cache;
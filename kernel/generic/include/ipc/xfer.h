@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_ipc
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_IPC_XFER_H_
+#define KERN_IPC_XFER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <typedefs.h>
+
+struct call;
+struct as;
+
+/** User buffer for a single-copy IPC data transfer
+ *
+ * The buffer is described when the request is sent and its frames are pinned
+ * when the request is answered. The frames carry an extra reference for as
+ * long as the structure holds them, so the kernel can copy directly between
+ * them and the address space of the peer task without a kernel bounce buffer.
+ *
+ */
+typedef struct {
+	/** Userspace address of the buffer. */
+	uspace_addr_t addr;
+	/** Size of the buffer. */
+	size_t size;
+	/** True if the kernel is going to write into the buffer. */
+	bool write;
+	/** True if the buffer may be pinned. */
+	bool valid;
+
+	/** Physical addresses of the pinned frames. */
+	uintptr_t *frames;
+	/** Number of pinned frames. */
+	size_t count;
+	/** Offset of the buffer within the first frame. */
+	size_t offset;
+} ipc_pinned_t;
+
+extern errno_t ipc_data_xfer_prepare(struct call *, uspace_addr_t, bool);
+extern errno_t ipc_buffer_init(ipc_pinned_t *, uspace_addr_t, size_t, bool);
+extern errno_t ipc_buffer_check(ipc_pinned_t *, uspace_addr_t, size_t, bool);
+extern errno_t ipc_buffer_pin(ipc_pinned_t *, struct as *, size_t);
+extern void ipc_buffer_unpin(ipc_pinned_t *);
+extern errno_t ipc_pinned_copy_to_uspace(uspace_addr_t, ipc_pinned_t *,
+    size_t);
+extern errno_t ipc_pinned_copy_from_uspace(ipc_pinned_t *, uspace_addr_t,
+    size_t);
+
+#endif
+
+/** @}
+ */
@@ -89,6 +89,50 @@ typedef uint8_t zone_flags_t;
 	(((((zf) & ZONE_EF_MASK)) == ((f) & ZONE_EF_MASK)) && \
 	    (((zf) & ~ZONE_EF_MASK) & (f)))
 
+/** Number of frames exchanged between a frame cache and the zones at once */
+#define FRAME_CACHE_BATCH  16
+
+/** Maximum number of frames held by one list of a per-CPU frame cache */
+#define FRAME_CACHE_SIZE  (4 * FRAME_CACHE_BATCH)
+
+/** Lists of a per-CPU frame cache */
+typedef enum {
+	/** Frames of ZONE_LOWMEM zones */
+	FRAME_CACHE_LOWMEM,
+	/** Frames of ZONE_HIGHMEM zones */
+	FRAME_CACHE_HIGHMEM,
+	FRAME_CACHE_LISTS
+} frame_cache_list_t;
+
+/** Per-CPU cache of free frames
+ *
+ * Single-frame allocations and deallocations are served from the cache of
+ * the current CPU without taking the zones lock. The frames of each list
+ * are kept in a double-ended ring: frames freed on the CPU are put to and
+ * allocated from the hot end, frames exchanged with the zones in batches
+ * of FRAME_CACHE_BATCH enter and leave at the cold end.
+ *
+ * While in the cache, the frames stay allocated in their zone (with the
+ * reference count of one) and are accounted in zone_t.cached_count.
+ *
+ */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+
+	struct {
+		pfn_t pfn[FRAME_CACHE_SIZE];
+		/** Index of the hot end */
+		size_t hot;
+		/** Number of frames in the list */
+		size_t count;
+	} list[FRAME_CACHE_LISTS];
+
+	/** Number of allocations served from the cache */
+	uint64_t hits;
+	/** Number of allocations which had to refill the cache */
+	uint64_t misses;
+} frame_cache_t;
+
 typedef struct {
 	size_t refcount;  /**< Tracking of shared frames */
 	void *parent;     /**< If allocated by slab, this points there */
@@ -107,6 +151,9 @@ typedef struct {
 	/** Number of busy frame_t structures */
 	size_t busy_count;
 
+	/** Number of busy frames which are free in per-CPU frame caches */
+	size_t cached_count;
+
 	/** Type of the zone */
 	zone_flags_t flags;
 
@@ -150,7 +197,11 @@ extern pfn_t zone_external_conf_alloc(size_t);
 extern bool zone_merge(size_t, size_t);
 extern void zone_merge_all(void);
 extern uint64_t zones_total_size(void);
-extern void zones_stats(uint64_t *, uint64_t *, uint64_t *, uint64_t *);
+extern void zones_stats(uint64_t *, uint64_t *, uint64_t *, uint64_t *,
+    uint64_t *, uint64_t *, uint64_t *);
+
+extern void frame_cache_initialize(frame_cache_t *);
+extern size_t frame_cache_drain_all(void);
 
 /*
  * Console functions
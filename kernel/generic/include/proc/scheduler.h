@@ -57,6 +57,7 @@ extern void scheduler_init(void);
 extern void scheduler_fpu_lazy_request(void);
 extern void scheduler(void);
 extern void kcpulb(void *arg);
+extern void scheduler_kick_idle(struct cpu *);
 
 extern void sched_print_list(void);
 
@@ -39,6 +39,29 @@
 
 #define HZ  100
 
+/** Maximum number of ticks a CPU may skip in tickless idle */
+#define CLOCK_TICKLESS_MAX  HZ
+
+struct cpu;
+
+/** Local timer operations needed for tickless idle
+ *
+ * The operations are always invoked on the affected CPU with interrupts
+ * disabled, except for kick().
+ *
+ */
+typedef struct {
+	/** Stop the periodic tick, interrupt once in place of the n-th tick. */
+	void (*stop)(uint64_t);
+	/**
+	 * Restart the periodic tick. Return the number of ticks that elapsed
+	 * while stopped, except for the one delivered by the stop() interrupt.
+	 */
+	uint64_t (*restart)(void);
+	/** Wake up a CPU that sleeps with its periodic tick stopped. */
+	void (*kick)(struct cpu *);
+} clock_tickless_ops_t;
+
 /** Uptime structure */
 typedef struct {
 	sysarg_t seconds1;
@@ -47,9 +70,13 @@ typedef struct {
 } uptime_t;
 
 extern uptime_t *uptime;
+extern clock_tickless_ops_t *clock_tickless_ops;
 
 extern void clock(void);
 extern void clock_counter_init(void);
+extern void clock_tickless_enter(void);
+extern void clock_tickless_leave(void);
+extern void clock_tickless_kick(struct cpu *);
 
 #endif
 
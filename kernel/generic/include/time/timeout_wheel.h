@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_time
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_TIMEOUT_WHEEL_H_
+#define KERN_TIMEOUT_WHEEL_H_
+
+#include <adt/list.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of bits of the tick number resolved by one wheel level */
+#define TIMEOUT_WHEEL_BITS    6
+#define TIMEOUT_WHEEL_SLOTS   (1 << TIMEOUT_WHEEL_BITS)
+#define TIMEOUT_WHEEL_MASK    (TIMEOUT_WHEEL_SLOTS - 1)
+
+/** Number of wheel levels
+ *
+ * The wheel covers TIMEOUT_WHEEL_SLOTS ^ TIMEOUT_WHEEL_LEVELS ticks.
+ * Timeouts further in the future are parked in the last level and
+ * cascaded again until they get within reach.
+ *
+ */
+#define TIMEOUT_WHEEL_LEVELS  4
+
+/** Maximum distance of a deadline the wheel can hold directly */
+#define TIMEOUT_WHEEL_RANGE \
+	(((uint64_t) 1 << (TIMEOUT_WHEEL_BITS * TIMEOUT_WHEEL_LEVELS)) - 1)
+
+/** Per-CPU hierarchical timing wheel
+ *
+ * Level 0 has one slot per clock() tick, each subsequent level has one slot
+ * per full revolution of the previous level. Timeouts of the upper levels
+ * are cascaded down when the lower level wraps around.
+ *
+ */
+typedef struct {
+	/** Next clock() tick to be processed by the wheel. */
+	uint64_t tick;
+	/** Slots of the individual wheel levels. */
+	list_t slot[TIMEOUT_WHEEL_LEVELS][TIMEOUT_WHEEL_SLOTS];
+	/** Expired timeouts whose handlers are being run by clock(). */
+	list_t expired;
+
+	/** Number of timeouts registered on the wheel. */
+	size_t pending;
+	/** Number of timeouts registered since boot. */
+	uint64_t registered;
+	/** Worst observed duration of timeout_register() (in cycles). */
+	uint64_t insert_max_cycles;
+} timeout_wheel_t;
+
+#endif
+
+/** @}
+ */
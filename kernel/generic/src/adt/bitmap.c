@@ -36,11 +36,17 @@
  * This file implements bitmap ADT and provides functions for
  * setting and clearing ranges of bits and for finding ranges
  * of unset bits.
+ *
+ * Optionally, a summary tree can be attached to the bitmap. Each node
+ * of the tree records the longest run of unset bits within the part of
+ * the bitmap it covers, together with the runs touching its edges, so
+ * that ranges of unset bits can be found without a linear scan.
  */
 
 #include <adt/bitmap.h>
 #include <align.h>
 #include <assert.h>
+#include <bitops.h>
 #include <macros.h>
 #include <typedefs.h>
 
@@ -91,8 +97,6 @@ size_t bitmap_size(size_t elements)
  * @param bitmap     Bitmap structure.
  * @param elements   Number of bits stored in bitmap.
  * @param data       Address of the memory used to hold the map.
- *                   The optional 2nd level bitmap follows the 1st
- *                   level bitmap.
  *
  */
 void bitmap_initialize(bitmap_t *bitmap, size_t elements, void *data)
@@ -100,6 +104,365 @@ void bitmap_initialize(bitmap_t *bitmap, size_t elements, void *data)
 	bitmap->elements = elements;
 	bitmap->bits = (uint8_t *) data;
 	bitmap->next_fit = 0;
+	bitmap->summary = NULL;
+	bitmap->summary_leaves = 0;
+}
+
+static int constraint_satisfy(size_t index, size_t base, size_t constraint)
+{
+	return (((base + index) & constraint) == 0);
+}
+
+/*
+ * Summary tree functions
+ */
+
+/** Get number of leaves of the summary tree
+ *
+ * @param elements Number of bits stored in bitmap.
+ *
+ * @return Number of leaves (a power of two).
+ *
+ */
+static size_t bitmap_summary_leaves(size_t elements)
+{
+	size_t leaves = 1;
+
+	while (leaves * BITMAP_SUMMARY_LEAF < elements)
+		leaves <<= 1;
+
+	return leaves;
+}
+
+/** Get summary tree size
+ *
+ * Return the size (in bytes) required for the summary tree
+ * of the bitmap.
+ *
+ * @param elements Number of bits stored in bitmap.
+ *
+ * @return Size (in bytes) required for the summary tree.
+ *
+ */
+size_t bitmap_summary_size(size_t elements)
+{
+	return 2 * bitmap_summary_leaves(elements) * sizeof(bitmap_node_t);
+}
+
+/** Compute summary tree leaf from the bits it covers
+ *
+ * Bits beyond the end of the bitmap are treated as set.
+ *
+ * @param bitmap Bitmap structure.
+ * @param leaf   Leaf number.
+ *
+ */
+static void bitmap_summary_leaf(bitmap_t *bitmap, size_t leaf)
+{
+	size_t start = leaf * BITMAP_SUMMARY_LEAF;
+	size_t end = min(start + BITMAP_SUMMARY_LEAF, bitmap->elements);
+
+	uint32_t prefix = 0;
+	uint32_t longest = 0;
+	uint32_t run = 0;
+	bool in_prefix = true;
+
+	size_t i = start;
+	while (i < end) {
+		uint8_t byte = bitmap->bits[i / BITMAP_ELEMENT];
+
+		/* Whole bytes can be accounted at once. */
+		if ((i + BITMAP_ELEMENT <= end) &&
+		    ((byte == ALL_ZEROES) || (byte == ALL_ONES))) {
+			if (byte == ALL_ZEROES) {
+				run += BITMAP_ELEMENT;
+				longest = max(longest, run);
+			} else {
+				if (in_prefix) {
+					prefix = run;
+					in_prefix = false;
+				}
+
+				run = 0;
+			}
+
+			i += BITMAP_ELEMENT;
+			continue;
+		}
+
+		if (bitmap_get_fast(bitmap, i)) {
+			if (in_prefix) {
+				prefix = run;
+				in_prefix = false;
+			}
+
+			run = 0;
+		} else {
+			run++;
+			longest = max(longest, run);
+		}
+
+		i++;
+	}
+
+	if (in_prefix)
+		prefix = run;
+
+	bitmap_node_t *node = &bitmap->summary[bitmap->summary_leaves + leaf];
+
+	node->prefix = prefix;
+	node->suffix = (end == start + BITMAP_SUMMARY_LEAF) ? run : 0;
+	node->longest = longest;
+}
+
+/** Compute summary tree node from its children
+ *
+ * @param bitmap Bitmap structure.
+ * @param node   Node index.
+ * @param len    Number of bits covered by each of the children.
+ *
+ */
+static void bitmap_summary_merge(bitmap_t *bitmap, size_t node, size_t len)
+{
+	bitmap_node_t *parent = &bitmap->summary[node];
+	bitmap_node_t *left = &bitmap->summary[2 * node];
+	bitmap_node_t *right = &bitmap->summary[2 * node + 1];
+
+	parent->prefix = (left->prefix == len) ?
+	    len + right->prefix : left->prefix;
+	parent->suffix = (right->suffix == len) ?
+	    len + left->suffix : right->suffix;
+	parent->longest = max3(left->longest, right->longest,
+	    left->suffix + right->prefix);
+}
+
+/** Update summary tree after a change of a range of bits
+ *
+ * @param bitmap Bitmap structure.
+ * @param start  Starting bit.
+ * @param count  Number of changed bits.
+ *
+ */
+void bitmap_summary_update(bitmap_t *bitmap, size_t start, size_t count)
+{
+	assert(bitmap->summary != NULL);
+
+	if (count == 0)
+		return;
+
+	size_t first = start / BITMAP_SUMMARY_LEAF;
+	size_t last = (start + count - 1) / BITMAP_SUMMARY_LEAF;
+
+	for (size_t leaf = first; leaf <= last; leaf++)
+		bitmap_summary_leaf(bitmap, leaf);
+
+	size_t lo = bitmap->summary_leaves + first;
+	size_t hi = bitmap->summary_leaves + last;
+	size_t len = BITMAP_SUMMARY_LEAF;
+
+	while (lo > 1) {
+		lo /= 2;
+		hi /= 2;
+
+		for (size_t node = lo; node <= hi; node++)
+			bitmap_summary_merge(bitmap, node, len);
+
+		len *= 2;
+	}
+}
+
+/** Attach summary tree to bitmap
+ *
+ * The summary tree allows bitmap_allocate_range() to find runs
+ * of zero bits in logarithmic time instead of scanning the bitmap.
+ * It is built from the current content of the bitmap and kept up
+ * to date by all functions modifying the bitmap.
+ *
+ * @param bitmap Bitmap structure.
+ * @param data   Address of the memory used to hold the summary tree
+ *               (of bitmap_summary_size() bytes).
+ *
+ */
+void bitmap_summary_initialize(bitmap_t *bitmap, void *data)
+{
+	/* The lengths of the runs must fit into the tree nodes. */
+	assert(bitmap->elements <= UINT32_MAX / 2);
+
+	bitmap->summary = (bitmap_node_t *) data;
+	bitmap->summary_leaves = bitmap_summary_leaves(bitmap->elements);
+
+	bitmap->summary[0].prefix = 0;
+	bitmap->summary[0].suffix = 0;
+	bitmap->summary[0].longest = 0;
+
+	bitmap_summary_update(bitmap, 0,
+	    bitmap->summary_leaves * BITMAP_SUMMARY_LEAF);
+}
+
+/** Find the first constraint-compliant index not below the given one
+ *
+ * @param index      Starting index.
+ * @param base       Address of the first bit in the bitmap.
+ * @param constraint Constraint for the address.
+ *
+ * @return First index satisfying the constraint or -1 if there is none.
+ *
+ */
+static size_t constraint_next(size_t index, size_t base, size_t constraint)
+{
+	size_t addr = base + index;
+	size_t conflict = addr & constraint;
+
+	if (conflict == 0)
+		return index;
+
+	/*
+	 * Increment the address just above the highest conflicting bit,
+	 * letting the carry pass through the constrained bits.
+	 */
+	size_t low = ((((size_t) 1) << fnzb(conflict)) << 1) - 1;
+	size_t next = ((addr | low | constraint) + 1) & ~constraint;
+
+	if (next <= addr)
+		return (size_t) -1;
+
+	return next - base;
+}
+
+/** Search arguments of bitmap_summary_find() */
+typedef struct {
+	/** First bit the range may start at */
+	size_t from;
+	/** Number of continuous zero bits to find */
+	size_t count;
+	/** Address of the first bit in the bitmap */
+	size_t base;
+	/** Constraint for the address of the first zero bit */
+	size_t constraint;
+	/**
+	 * Number of zero bits (not before from) immediately preceding
+	 * the node being searched.
+	 */
+	size_t carry;
+} bitmap_search_t;
+
+/** Find the first range of zero bits using the summary tree
+ *
+ * The tree is walked from the left. Subtrees lying before the starting
+ * bit or without a long enough run are skipped, so that only a logarithmic
+ * number of nodes is visited unless the constraint rules out most of the
+ * runs.
+ *
+ * @param bitmap Bitmap structure.
+ * @param node   Node index.
+ * @param lo     First bit covered by the node.
+ * @param len    Number of bits covered by the node.
+ * @param search Search arguments, the carry is updated to the number
+ *               of zero bits at the end of the node.
+ *
+ * @return Index of the first bit of the range or -1 if not found
+ *         within the node.
+ *
+ */
+static size_t bitmap_summary_find(bitmap_t *bitmap, size_t node, size_t lo,
+    size_t len, bitmap_search_t *search)
+{
+	bitmap_node_t *summary = &bitmap->summary[node];
+
+	if (lo + len <= search->from) {
+		search->carry = 0;
+		return (size_t) -1;
+	}
+
+	if (lo >= search->from) {
+		/* Try the run continuing from the preceding nodes. */
+		size_t run = search->carry + summary->prefix;
+
+		if (run >= search->count) {
+			size_t index = constraint_next(lo - search->carry,
+			    search->base, search->constraint);
+
+			if ((index != (size_t) -1) &&
+			    (index + search->count <= lo + summary->prefix))
+				return index;
+		}
+
+		if (summary->longest < search->count) {
+			search->carry = (summary->prefix == len) ?
+			    search->carry + len : summary->suffix;
+			return (size_t) -1;
+		}
+	}
+
+	if (len == BITMAP_SUMMARY_LEAF) {
+		size_t end = min(lo + len, bitmap->elements);
+		size_t run = search->carry;
+		size_t i = max(lo, search->from);
+
+		while (i < end) {
+			/* Skip whole bytes with all bits set. */
+			if (((i & BITMAP_REMAINER) == 0) &&
+			    (bitmap->bits[i / BITMAP_ELEMENT] == ALL_ONES)) {
+				run = 0;
+				i += BITMAP_ELEMENT;
+				continue;
+			}
+
+			if (bitmap_get_fast(bitmap, i)) {
+				run = 0;
+			} else {
+				run++;
+
+				size_t index = i + 1 - search->count;
+				if ((run >= search->count) &&
+				    (constraint_satisfy(index, search->base,
+				    search->constraint)))
+					return index;
+			}
+
+			i++;
+		}
+
+		search->carry = (end == lo + len) ? run : 0;
+		return (size_t) -1;
+	}
+
+	size_t half = len / 2;
+	size_t index = bitmap_summary_find(bitmap, 2 * node, lo, half, search);
+	if (index != (size_t) -1)
+		return index;
+
+	return bitmap_summary_find(bitmap, 2 * node + 1, lo + half, half,
+	    search);
+}
+
+/** Find a continuous zero bit range using the summary tree
+ *
+ * @param bitmap     Bitmap structure.
+ * @param count      Number of continuous zero bits to find.
+ * @param base       Address of the first bit in the bitmap.
+ * @param constraint Constraint for the address of the first zero bit.
+ * @param from       First bit the range may start at.
+ * @param index      Place to store the index of the first zero bit.
+ *
+ * @return True if a range has been found.
+ *
+ */
+static bool bitmap_summary_allocate(bitmap_t *bitmap, size_t count,
+    size_t base, size_t constraint, size_t from, size_t *index)
+{
+	bitmap_search_t search = {
+		.from = from,
+		.count = count,
+		.base = base,
+		.constraint = constraint,
+		.carry = 0
+	};
+
+	*index = bitmap_summary_find(bitmap, 1, 0,
+	    bitmap->summary_leaves * BITMAP_SUMMARY_LEAF, &search);
+
+	return (*index != (size_t) -1);
 }
 
 /** Set range of bits.
@@ -132,6 +495,10 @@ void bitmap_set_range(bitmap_t *bitmap, size_t start, size_t count)
 		/* Set bits in the middle of byte. */
 		bitmap->bits[start_byte] |=
 		    ((1 << lub) - 1) << (start & BITMAP_REMAINER);
+
+		if (bitmap->summary != NULL)
+			bitmap_summary_update(bitmap, start, count);
+
 		return;
 	}
 
@@ -154,6 +521,9 @@ void bitmap_set_range(bitmap_t *bitmap, size_t start, size_t count)
 		bitmap->bits[aligned_start / BITMAP_ELEMENT + i] |=
 		    (1 << tab) - 1;
 	}
+
+	if (bitmap->summary != NULL)
+		bitmap_summary_update(bitmap, start, count);
 }
 
 /** Clear range of bits.
@@ -186,6 +556,10 @@ void bitmap_clear_range(bitmap_t *bitmap, size_t start, size_t count)
 		/* Set bits in the middle of byte */
 		bitmap->bits[start_byte] &=
 		    ~(((1 << lub) - 1) << (start & BITMAP_REMAINER));
+
+		if (bitmap->summary != NULL)
+			bitmap_summary_update(bitmap, start, count);
+
 		return;
 	}
 
@@ -210,6 +584,9 @@ void bitmap_clear_range(bitmap_t *bitmap, size_t start, size_t count)
 	}
 
 	bitmap->next_fit = start_byte;
+
+	if (bitmap->summary != NULL)
+		bitmap_summary_update(bitmap, start, count);
 }
 
 /** Copy portion of one bitmap into another bitmap.
@@ -235,11 +612,9 @@ void bitmap_copy(bitmap_t *dst, bitmap_t *src, size_t count)
 		dst->bits[i] |= src->bits[i] &
 		    ((1 << (count % BITMAP_ELEMENT)) - 1);
 	}
-}
 
-static int constraint_satisfy(size_t index, size_t base, size_t constraint)
-{
-	return (((base + index) & constraint) == 0);
+	if (dst->summary != NULL)
+		bitmap_summary_update(dst, 0, count);
 }
 
 /** Find a continuous zero bit range
@@ -254,6 +629,9 @@ static int constraint_satisfy(size_t index, size_t base, size_t constraint)
  * is set and the index of the first bit is stored to index.
  * Otherwise the bitmap stays untouched.
  *
+ * If the bitmap has a summary tree attached, the range is found
+ * in logarithmic time, otherwise the bitmap is scanned linearly.
+ *
  * @param bitmap     Bitmap structure.
  * @param count      Number of continuous zero bits to find.
  * @param base       Address of the first bit in the bitmap.
@@ -288,6 +666,24 @@ bool bitmap_allocate_range(bitmap_t *bitmap, size_t count, size_t base,
 			next_fit = prefered_fit;
 	}
 
+	if (bitmap->summary != NULL) {
+		size_t from = next_fit * BITMAP_ELEMENT;
+		size_t i;
+
+		if ((!bitmap_summary_allocate(bitmap, count, base, constraint,
+		    from, &i)) && ((from == 0) || (!bitmap_summary_allocate(
+		    bitmap, count, base, constraint, 0, &i))))
+			return false;
+
+		if (index != NULL) {
+			bitmap_set_range(bitmap, i, count);
+			bitmap->next_fit = i / BITMAP_ELEMENT;
+			*index = i;
+		}
+
+		return true;
+	}
+
 	for (size_t pos = 0; pos < size; pos++) {
 		size_t byte = (next_fit + pos) % size;
 
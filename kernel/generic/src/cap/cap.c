@@ -86,14 +86,16 @@
 #include <ipc/ipcrsc.h>
 #include <ipc/ipc.h>
 #include <ipc/irq.h>
+#include <preemption.h>
+#include <mem.h>
 
 #include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #define CAPS_START	((intptr_t) CAP_NIL + 1)
-#define CAPS_SIZE	(INT_MAX - (int) CAPS_START)
-#define CAPS_LAST	(CAPS_SIZE - 1)
+#define CAPS_LAST	((intptr_t) CAP_TABLE_CAPACITY - 1)
+#define CAPS_SIZE	(CAPS_LAST - CAPS_START + 1)
 
 static slab_cache_t *cap_cache;
 static slab_cache_t *kobject_cache;
@@ -105,31 +107,6 @@ kobject_ops_t *kobject_ops[KOBJECT_TYPE_MAX] = {
 	[KOBJECT_TYPE_WAITQ] = &waitq_kobject_ops
 };
 
-static size_t caps_hash(const ht_link_t *item)
-{
-	cap_t *cap = hash_table_get_inst(item, cap_t, caps_link);
-	return hash_mix(cap_handle_raw(cap->handle));
-}
-
-static size_t caps_key_hash(const void *key)
-{
-	const cap_handle_t *handle = key;
-	return hash_mix(cap_handle_raw(*handle));
-}
-
-static bool caps_key_equal(const void *key, const ht_link_t *item)
-{
-	const cap_handle_t *handle = key;
-	cap_t *cap = hash_table_get_inst(item, cap_t, caps_link);
-	return *handle == cap->handle;
-}
-
-static hash_table_ops_t caps_ops = {
-	.hash = caps_hash,
-	.key_hash = caps_key_hash,
-	.key_equal = caps_key_equal
-};
-
 void caps_init(void)
 {
 	cap_cache = slab_cache_create("cap_t", sizeof(cap_t), 0, NULL,
@@ -152,8 +129,8 @@ errno_t caps_task_alloc(task_t *task)
 		goto error_handles;
 	if (!ra_span_add(task->cap_info->handles, CAPS_START, CAPS_SIZE))
 		goto error_span;
-	if (!hash_table_create(&task->cap_info->caps, 0, 0, &caps_ops))
-		goto error_span;
+	for (size_t i = 0; i < CAP_TABLE_LEAVES; i++)
+		atomic_init(&task->cap_info->leaves[i], NULL);
 	return EOK;
 
 error_span:
@@ -181,7 +158,8 @@ void caps_task_init(task_t *task)
  */
 void caps_task_free(task_t *task)
 {
-	hash_table_destroy(&task->cap_info->caps);
+	for (size_t i = 0; i < CAP_TABLE_LEAVES; i++)
+		free(atomic_load(&task->cap_info->leaves[i]));
 	ra_arena_destroy(task->cap_info->handles);
 	free(task->cap_info);
 }
@@ -229,6 +207,33 @@ static void cap_initialize(cap_t *cap, task_t *task, cap_handle_t handle)
 	link_initialize(&cap->type_link);
 }
 
+/** Find capability table slot for capability handle
+ *
+ * This does not require the cap_info_t lock as leaves of the table are never
+ * freed while the task exists.
+ *
+ * @param task    Task whose capability table to search.
+ * @param handle  Capability handle.
+ *
+ * @return Address of the slot or NULL if the handle is out of range or its
+ *         leaf has not been allocated.
+ */
+static cap_slot_t *cap_slot_find(task_t *task, cap_handle_t handle)
+{
+	intptr_t raw = cap_handle_raw(handle);
+
+	if ((raw < CAPS_START) || (raw > CAPS_LAST))
+		return NULL;
+
+	cap_leaf_t *leaf = atomic_load_explicit(
+	    &task->cap_info->leaves[raw >> CAP_TABLE_LEAF_BITS],
+	    memory_order_acquire);
+	if (!leaf)
+		return NULL;
+
+	return &leaf->slot[raw & (CAP_TABLE_LEAF_SIZE - 1)];
+}
+
 /** Get capability using capability handle
  *
  * @param task    Task whose capability to get.
@@ -242,18 +247,44 @@ static cap_t *cap_get(task_t *task, cap_handle_t handle, cap_state_t state)
 {
 	assert(mutex_locked(&task->cap_info->lock));
 
-	if ((cap_handle_raw(handle) < CAPS_START) ||
-	    (cap_handle_raw(handle) > CAPS_LAST))
-		return NULL;
-	ht_link_t *link = hash_table_find(&task->cap_info->caps, &handle);
-	if (!link)
+	cap_slot_t *slot = cap_slot_find(task, handle);
+	if (!slot || !slot->cap)
 		return NULL;
-	cap_t *cap = hash_table_get_inst(link, cap_t, caps_link);
+	cap_t *cap = slot->cap;
 	if (cap->state != state)
 		return NULL;
 	return cap;
 }
 
+/** Make sure there is a table leaf for capability handle
+ *
+ * @param task    Task whose capability table to extend.
+ * @param handle  Capability handle.
+ *
+ * @return Address of the slot for the handle or NULL if out of memory.
+ */
+static cap_slot_t *cap_slot_make(task_t *task, cap_handle_t handle)
+{
+	assert(mutex_locked(&task->cap_info->lock));
+
+	size_t idx = cap_handle_raw(handle) >> CAP_TABLE_LEAF_BITS;
+	cap_leaf_t *leaf = atomic_load_explicit(&task->cap_info->leaves[idx],
+	    memory_order_relaxed);
+
+	if (!leaf) {
+		leaf = malloc(sizeof(cap_leaf_t));
+		if (!leaf)
+			return NULL;
+		memsetb(leaf, sizeof(cap_leaf_t), 0);
+
+		/* Publish the initialized leaf to lock-free readers. */
+		atomic_store_explicit(&task->cap_info->leaves[idx], leaf,
+		    memory_order_release);
+	}
+
+	return cap_slot_find(task, handle);
+}
+
 /** Allocate new capability
  *
  * @param task  Task for which to allocate the new capability.
@@ -277,7 +308,14 @@ errno_t cap_alloc(task_t *task, cap_handle_t *handle)
 		return ENOMEM;
 	}
 	cap_initialize(cap, task, (cap_handle_t) hbase);
-	hash_table_insert(&task->cap_info->caps, &cap->caps_link);
+	cap_slot_t *slot = cap_slot_make(task, cap->handle);
+	if (!slot) {
+		ra_free(task->cap_info->handles, hbase, 1);
+		slab_free(cap_cache, cap);
+		mutex_unlock(&task->cap_info->lock);
+		return ENOMEM;
+	}
+	slot->cap = cap;
 
 	cap->state = CAP_STATE_ALLOCATED;
 	*handle = cap->handle;
@@ -306,6 +344,7 @@ cap_publish(task_t *task, cap_handle_t handle, kobject_t *kobj)
 	cap->state = CAP_STATE_PUBLISHED;
 	/* Hand over kobj's reference to cap */
 	cap->kobject = kobj;
+	atomic_store(&cap_slot_find(task, handle)->kobject, kobj);
 	list_append(&cap->kobj_link, &kobj->caps_list);
 	list_append(&cap->type_link, &task->cap_info->type_list[kobj->type]);
 	mutex_unlock(&task->cap_info->lock);
@@ -314,6 +353,17 @@ cap_publish(task_t *task, cap_handle_t handle, kobject_t *kobj)
 
 static void cap_unpublish_unsafe(cap_t *cap)
 {
+	cap_slot_t *slot = cap_slot_find(cap->task, cap->handle);
+
+	/*
+	 * Hide the kobject from lock-free readers and wait for those which
+	 * might have already seen it to take their reference. Only then can
+	 * the capability's reference be handed over or dropped.
+	 */
+	atomic_store(&slot->kobject, NULL);
+	while (atomic_load(&slot->readers) != 0)
+		;
+
 	cap->kobject = NULL;
 	list_remove(&cap->kobj_link);
 	list_remove(&cap->type_link);
@@ -401,7 +451,7 @@ void cap_free(task_t *task, cap_handle_t handle)
 
 	assert(cap);
 
-	hash_table_remove_item(&task->cap_info->caps, &cap->caps_link);
+	cap_slot_find(task, handle)->cap = NULL;
 	ra_free(task->cap_info->handles, cap_handle_raw(handle), 1);
 	slab_free(cap_cache, cap);
 	mutex_unlock(&task->cap_info->lock);
@@ -435,6 +485,9 @@ void kobject_initialize(kobject_t *kobj, kobject_type_t type, void *raw)
 }
 
 /** Get new reference to kernel object from capability
+ *
+ * The lookup does not take the cap_info_t lock and never waits. See
+ * cap_slot_t for how it synchronizes with capabilities being unpublished.
  *
  * @param task    Task from which to get the reference.
  * @param handle  Capability handle.
@@ -447,17 +500,27 @@ void kobject_initialize(kobject_t *kobj, kobject_type_t type, void *raw)
 kobject_t *
 kobject_get(struct task *task, cap_handle_t handle, kobject_type_t type)
 {
-	kobject_t *kobj = NULL;
+	cap_slot_t *slot = cap_slot_find(task, handle);
+	if (!slot)
+		return NULL;
 
-	mutex_lock(&task->cap_info->lock);
-	cap_t *cap = cap_get(task, handle, CAP_STATE_PUBLISHED);
-	if (cap) {
-		if (cap->kobject->type == type) {
-			kobj = cap->kobject;
+	/*
+	 * Keep the window during which a writer may be spinning on the
+	 * readers counter short.
+	 */
+	preemption_disable();
+
+	atomic_inc(&slot->readers);
+	kobject_t *kobj = atomic_load(&slot->kobject);
+	if (kobj) {
+		if (kobj->type == type)
 			atomic_inc(&kobj->refcnt);
-		}
+		else
+			kobj = NULL;
 	}
-	mutex_unlock(&task->cap_info->lock);
+	atomic_dec(&slot->readers);
+
+	preemption_enable();
 
 	return kobj;
 }
@@ -64,6 +64,7 @@
 #include <proc/scheduler.h>
 #include <proc/thread.h>
 #include <proc/task.h>
+#include <time/timeout.h>
 #include <ipc/ipc.h>
 #include <ipc/irq.h>
 #include <ipc/event.h>
@@ -495,6 +496,14 @@ static cmd_info_t sched_info = {
 	.argc = 0
 };
 
+static int cmd_timeouts(cmd_arg_t *argv);
+static cmd_info_t timeouts_info = {
+	.name = "timeouts",
+	.description = "Show pending timeouts and timeout insertion latency.",
+	.func = cmd_timeouts,
+	.argc = 0
+};
+
 static int cmd_caches(cmd_arg_t *argv);
 static cmd_info_t caches_info = {
 	.name = "caches",
@@ -604,6 +613,7 @@ static cmd_info_t *basic_commands[] = {
 	&sysinfo_info,
 	&tasks_info,
 	&threads_info,
+	&timeouts_info,
 	&tlb_info,
 	&uptime_info,
 	&version_info,
@@ -1280,6 +1290,18 @@ int cmd_sched(cmd_arg_t *argv)
 	return 1;
 }
 
+/** Command for printing timeout information
+ *
+ * @param argv Ignored
+ *
+ * @return Always 1
+ */
+int cmd_timeouts(cmd_arg_t *argv)
+{
+	timeout_print_stats();
+	return 1;
+}
+
 /** Command for listing memory zones
  *
  * @param argv Ignored
@@ -35,6 +35,9 @@
 #include <assert.h>
 #include <ipc/sysipc_ops.h>
 #include <ipc/ipc.h>
+#include <ipc/xfer.h>
+#include <mm/as.h>
+#include <proc/task.h>
 #include <stdlib.h>
 #include <abi/errno.h>
 #include <syscall/copy.h>
@@ -42,18 +45,9 @@
 
 static errno_t request_preprocess(call_t *call, phone_t *phone)
 {
-	size_t size = ipc_get_arg2(&call->data);
+	uspace_addr_t dst = ipc_get_arg1(&call->data);
 
-	if (size > DATA_XFER_LIMIT) {
-		int flags = ipc_get_arg3(&call->data);
-
-		if (flags & IPC_XF_RESTRICT)
-			ipc_set_arg2(&call->data, DATA_XFER_LIMIT);
-		else
-			return ELIMIT;
-	}
-
-	return EOK;
+	return ipc_data_xfer_prepare(call, dst, true);
 }
 
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
@@ -74,6 +68,38 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 			 */
 			ipc_set_arg1(&answer->data, dst);
 
+			if (answer->pinned.valid) {
+				/*
+				 * Pin only the part of the caller's buffer
+				 * which is going to be written and copy
+				 * straight into it, answer_process() has
+				 * nothing left to do then.
+				 */
+				irq_spinlock_lock(&answer->sender->lock, true);
+				as_t *as = answer->sender->as;
+				irq_spinlock_unlock(&answer->sender->lock,
+				    true);
+
+				errno_t rc = ipc_buffer_pin(&answer->pinned,
+				    as, size);
+				if (rc == EOK) {
+					rc = ipc_pinned_copy_from_uspace(
+					    &answer->pinned, src, size);
+					if (rc)
+						ipc_set_retval(&answer->data,
+						    rc);
+					ipc_buffer_unpin(&answer->pinned);
+					return EOK;
+				}
+
+				/*
+				 * Some page of the caller's buffer is not
+				 * present or cannot be pinned. Fall back to a
+				 * kernel copy, answer_process() will fault the
+				 * buffer in if needed.
+				 */
+			}
+
 			answer->buffer = malloc(size);
 			if (!answer->buffer) {
 				ipc_set_retval(&answer->data, ENOMEM);
@@ -96,6 +122,8 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 		}
 	}
 
+	ipc_buffer_unpin(&answer->pinned);
+
 	return EOK;
 }
 
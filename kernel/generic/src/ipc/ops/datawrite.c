@@ -35,6 +35,9 @@
 #include <assert.h>
 #include <ipc/sysipc_ops.h>
 #include <ipc/ipc.h>
+#include <ipc/xfer.h>
+#include <mm/as.h>
+#include <proc/task.h>
 #include <stdlib.h>
 #include <abi/errno.h>
 #include <syscall/copy.h>
@@ -43,22 +46,24 @@
 static errno_t request_preprocess(call_t *call, phone_t *phone)
 {
 	uspace_addr_t src = ipc_get_arg1(&call->data);
-	size_t size = ipc_get_arg2(&call->data);
 
-	if (size > DATA_XFER_LIMIT) {
-		int flags = ipc_get_arg3(&call->data);
+	errno_t rc = ipc_data_xfer_prepare(call, src, false);
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * A pinnable source buffer is copied directly to the recipient in
+	 * answer_preprocess(), there is no need for a kernel copy.
+	 */
+	if (call->pinned.valid)
+		return EOK;
 
-		if (flags & IPC_XF_RESTRICT) {
-			size = DATA_XFER_LIMIT;
-			ipc_set_arg2(&call->data, size);
-		} else
-			return ELIMIT;
-	}
+	size_t size = ipc_get_arg2(&call->data);
 
 	call->buffer = (uint8_t *) malloc(size);
 	if (!call->buffer)
 		return ENOMEM;
-	errno_t rc = copy_from_uspace(call->buffer, src, size);
+	rc = copy_from_uspace(call->buffer, src, size);
 	if (rc != EOK) {
 		/*
 		 * call->buffer will be cleaned up in ipc_call_free() at the
@@ -72,7 +77,7 @@ static errno_t request_preprocess(call_t *call, phone_t *phone)
 
 static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 {
-	assert(answer->buffer);
+	assert(answer->buffer || answer->pinned.valid);
 
 	if (!ipc_get_retval(&answer->data)) {
 		/* The recipient agreed to receive data. */
@@ -81,8 +86,26 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 		size_t max_size = ipc_get_arg2(olddata);
 
 		if (size <= max_size) {
-			errno_t rc = copy_to_uspace(dst,
-			    answer->buffer, size);
+			errno_t rc;
+
+			if (answer->pinned.valid) {
+				/*
+				 * Pin only as much of the caller's buffer as
+				 * the recipient is willing to receive.
+				 */
+				irq_spinlock_lock(&answer->sender->lock, true);
+				as_t *as = answer->sender->as;
+				irq_spinlock_unlock(&answer->sender->lock,
+				    true);
+
+				rc = ipc_buffer_pin(&answer->pinned, as, size);
+				if (rc == EOK) {
+					rc = ipc_pinned_copy_to_uspace(dst,
+					    &answer->pinned, size);
+				}
+			} else {
+				rc = copy_to_uspace(dst, answer->buffer, size);
+			}
 			if (rc)
 				ipc_set_retval(&answer->data, rc);
 		} else {
@@ -90,6 +113,9 @@ static errno_t answer_preprocess(call_t *answer, ipc_data_t *olddata)
 		}
 	}
 
+	/* The caller's frames are no longer needed. */
+	ipc_buffer_unpin(&answer->pinned);
+
 	return EOK;
 }
 
@@ -756,7 +756,7 @@ sys_errno_t sys_ipc_hangup(cap_phone_handle_t handle)
 	return rc;
 }
 
-/** Wait for an incoming IPC call or an answer.
+/** Receive one incoming IPC call or answer.
  *
  * @param calldata Pointer to buffer where the call/answer data is stored.
  * @param usec     Timeout. See waitq_sleep_timeout() for explanation.
@@ -765,7 +765,7 @@ sys_errno_t sys_ipc_hangup(cap_phone_handle_t handle)
  *
  * @return An error code on error.
  */
-sys_errno_t sys_ipc_wait_for_call(uspace_ptr_ipc_data_t calldata, uint32_t usec,
+static errno_t ipc_receive(uspace_ptr_ipc_data_t calldata, uint32_t usec,
     unsigned int flags)
 {
 	call_t *call = NULL;
@@ -865,6 +865,63 @@ error:
 	return rc;
 }
 
+/** Wait for an incoming IPC call or an answer.
+ *
+ * @param calldata Pointer to buffer where the call/answer data is stored.
+ * @param usec     Timeout. See waitq_sleep_timeout() for explanation.
+ * @param flags    Select mode of sleep operation. See waitq_sleep_timeout()
+ *                 for explanation.
+ *
+ * @return An error code on error.
+ */
+sys_errno_t sys_ipc_wait_for_call(uspace_ptr_ipc_data_t calldata, uint32_t usec,
+    unsigned int flags)
+{
+	return ipc_receive(calldata, usec, flags);
+}
+
+/** Wait for incoming IPC calls or answers and receive a batch of them.
+ *
+ * The first item is waited for as in sys_ipc_wait_for_call(). After that,
+ * whatever else is already pending in the answerbox is received without
+ * blocking, up to the capacity of the buffer.
+ *
+ * @param calldata Pointer to an array where the call/answer data is stored.
+ * @param count    Number of entries in the array.
+ * @param uspace_received Pointer to a variable where the number of received
+ *                 items is stored on success.
+ * @param usec     Timeout for the first item. See waitq_sleep_timeout() for
+ *                 explanation.
+ * @param flags    Select mode of sleep operation for the first item. See
+ *                 waitq_sleep_timeout() for explanation.
+ *
+ * @return An error code on error.
+ */
+sys_errno_t sys_ipc_wait_batch(uspace_ptr_ipc_data_t calldata, size_t count,
+    uspace_ptr_size_t uspace_received, uint32_t usec, unsigned int flags)
+{
+	if (count == 0)
+		return EINVAL;
+
+	if (count > IPC_WAIT_BATCH_MAX)
+		count = IPC_WAIT_BATCH_MAX;
+
+	errno_t rc = ipc_receive(calldata, usec, flags);
+	if (rc != EOK)
+		return rc;
+
+	size_t received = 1;
+	while (received < count) {
+		if (ipc_receive(calldata + received * sizeof(ipc_data_t),
+		    SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NON_BLOCKING) != EOK)
+			break;
+
+		received++;
+	}
+
+	return copy_to_uspace(uspace_received, &received, sizeof(received));
+}
+
 /** Interrupt one thread from sys_ipc_wait_for_call().
  *
  */
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_ipc
+ * @{
+ */
+/**
+ * @file
+ * @brief Single-copy transfers for IPC_M_DATA_READ and IPC_M_DATA_WRITE.
+ *
+ * Instead of copying the data into a kernel buffer in the context of one task
+ * and out of it in the context of the other, the answering task copies the
+ * data directly between its own address space and the frames backing the
+ * user buffer of the caller. These are accessed through the identity mapping
+ * or a temporary kernel mapping.
+ *
+ * The frames of the caller's buffer are pinned when the request is answered
+ * and only for as much data as the answering task actually transfers, which
+ * is often much less than the caller asked for. A destination buffer is not
+ * looked at before that, if it turns out not to be pinnable then, the data
+ * goes through a kernel bounce buffer after all. A source buffer has to be
+ * checked when the request is sent, as its contents must be reachable from
+ * the answering task.
+ */
+
+#include <assert.h>
+#include <ipc/xfer.h>
+#include <ipc/ipc.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <mm/frame.h>
+#include <mm/km.h>
+#include <genarch/mm/page_pt.h>
+#include <genarch/mm/page_ht.h>
+#include <syscall/copy.h>
+#include <abi/errno.h>
+#include <align.h>
+#include <config.h>
+#include <macros.h>
+#include <stdlib.h>
+#include <arch.h>
+
+/** Look up and optionally reference the frame backing a user page.
+ *
+ * The frame is accepted only if it belongs to a zone managed by the frame
+ * allocator. Other frames (e.g. firmware or device memory mapped by
+ * physmem_map()) have no reference counts to hold them with.
+ *
+ * @param as    Address space containing the page.
+ * @param page  Virtual address of the page.
+ * @param write True if the kernel is going to write into the page.
+ * @param frame If not NULL, the frame is referenced and its physical
+ *              address is stored here.
+ *
+ * @return True if the page is present and backed by a suitable frame.
+ *
+ */
+static bool ipc_page_lookup(as_t *as, uintptr_t page, bool write,
+    uintptr_t *frame)
+{
+	pte_t pte;
+	bool found = false;
+
+	page_table_lock(as, true);
+	if (page_mapping_find(as, page, false, &pte) &&
+	    PTE_PRESENT(&pte) && (!write || PTE_WRITABLE(&pte))) {
+		pfn_t pfn = ADDR2PFN(PTE_GET_FRAME(&pte));
+
+		irq_spinlock_lock(&zones.lock, true);
+
+		size_t znum = find_zone(pfn, 1, 0);
+		if ((znum != (size_t) -1) &&
+		    (zones.info[znum].flags & ZONE_AVAILABLE)) {
+			if (frame) {
+				zone_t *zone = &zones.info[znum];
+
+				zone->frames[pfn - zone->base].refcount++;
+				*frame = PFN2ADDR(pfn);
+			}
+
+			found = true;
+		}
+
+		irq_spinlock_unlock(&zones.lock, true);
+	}
+	page_table_unlock(as, true);
+
+	return found;
+}
+
+/** Prepare the caller's buffer of a data transfer request.
+ *
+ * Requests of at least one page are served without a bounce buffer if the
+ * caller's buffer can be pinned, which allows for sizes up to
+ * DATA_XFER_LIMIT_PINNED. Otherwise the request is subject to the
+ * DATA_XFER_LIMIT of the bounce-buffer path.
+ *
+ * The size of the transfer is taken from and, if IPC_XF_RESTRICT is set in
+ * the flags, cut down in the second argument of the call.
+ *
+ * @param call  Data transfer request being sent by the current task.
+ * @param addr  Userspace address of the caller's buffer.
+ * @param write True if the kernel is going to write into the buffer.
+ *
+ * @return EOK on success or ELIMIT if the request is too large.
+ *
+ */
+errno_t ipc_data_xfer_prepare(call_t *call, uspace_addr_t addr, bool write)
+{
+	size_t size = ipc_get_arg2(&call->data);
+	unsigned int flags = ipc_get_arg3(&call->data);
+
+	if (size > DATA_XFER_LIMIT_PINNED) {
+		if (!(flags & IPC_XF_RESTRICT))
+			return ELIMIT;
+
+		size = DATA_XFER_LIMIT_PINNED;
+		ipc_set_arg2(&call->data, size);
+	}
+
+	/*
+	 * Any failure to check the buffer is left to be reported by the
+	 * bounce-buffer path, which will encounter the same problem when
+	 * it accesses the buffer.
+	 */
+	if (size >= PAGE_SIZE) {
+		errno_t rc;
+
+		if (write)
+			rc = ipc_buffer_init(&call->pinned, addr, size, write);
+		else
+			rc = ipc_buffer_check(&call->pinned, addr, size, write);
+
+		if (rc == EOK)
+			return EOK;
+	}
+
+	if (size > DATA_XFER_LIMIT) {
+		if (!(flags & IPC_XF_RESTRICT))
+			return ELIMIT;
+
+		ipc_set_arg2(&call->data, DATA_XFER_LIMIT);
+	}
+
+	return EOK;
+}
+
+/** Describe a buffer in the current address space to be pinned later.
+ *
+ * Only the address range of the buffer is checked, the pages themselves are
+ * not looked at until ipc_buffer_pin(). This is enough for buffers which the
+ * kernel is going to write into, since the transfer can still fall back to a
+ * bounce buffer if they turn out not to be pinnable then.
+ *
+ * @param pin   Structure to be filled in.
+ * @param addr  Userspace address of the buffer.
+ * @param size  Size of the buffer.
+ * @param write True if the kernel is going to write into the buffer.
+ *
+ * @return EOK on success.
+ * @return EPERM if the buffer is not in the userspace part of the address
+ *         space.
+ *
+ */
+errno_t ipc_buffer_init(ipc_pinned_t *pin, uspace_addr_t addr, size_t size,
+    bool write)
+{
+	if (addr + size < addr)
+		return EPERM;
+
+	if (!KERNEL_ADDRESS_SPACE_SHADOWED) {
+		if (overlaps(addr, size, KERNEL_ADDRESS_SPACE_START,
+		    KERNEL_ADDRESS_SPACE_END - KERNEL_ADDRESS_SPACE_START))
+			return EPERM;
+	}
+
+#ifdef ADDRESS_SPACE_HOLE_START
+	if (overlaps(addr, size, ADDRESS_SPACE_HOLE_START,
+	    ADDRESS_SPACE_HOLE_END - ADDRESS_SPACE_HOLE_START))
+		return EPERM;
+#endif
+
+	pin->addr = addr;
+	pin->size = size;
+	pin->write = write;
+	pin->valid = true;
+
+	return EOK;
+}
+
+/** Check that a buffer in the current address space can be pinned.
+ *
+ * All pages of the buffer are faulted in and checked to be backed by memory
+ * managed by the frame allocator. The frames are not referenced yet, this is
+ * left to ipc_buffer_pin() once the amount of data to transfer is known.
+ *
+ * @param pin   Structure to be filled in.
+ * @param addr  Userspace address of the buffer.
+ * @param size  Size of the buffer.
+ * @param write True if the kernel is going to write into the buffer.
+ *
+ * @return EOK on success.
+ * @return ENOTSUP if some page of the buffer cannot be pinned. The caller is
+ *         expected to fall back to a bounce buffer in that case.
+ * @return Other error code if the buffer is not accessible at all.
+ *
+ */
+errno_t ipc_buffer_check(ipc_pinned_t *pin, uspace_addr_t addr, size_t size,
+    bool write)
+{
+	uintptr_t base = ALIGN_DOWN((uintptr_t) addr, PAGE_SIZE);
+	size_t count = (ALIGN_UP((uintptr_t) addr + size, PAGE_SIZE) - base) /
+	    PAGE_SIZE;
+
+	for (size_t i = 0; i < count; i++) {
+		uintptr_t page = base + i * PAGE_SIZE;
+		uintptr_t probe = max(page, (uintptr_t) addr);
+		uint8_t dummy;
+
+		/* Make sure the page is mapped, faulting it in if necessary. */
+		errno_t rc = copy_from_uspace(&dummy, (uspace_addr_t) probe,
+		    1);
+		if (rc != EOK)
+			return rc;
+
+		if (!ipc_page_lookup(AS, page, write, NULL))
+			return ENOTSUP;
+	}
+
+	return ipc_buffer_init(pin, addr, size, write);
+}
+
+/** Pin the beginning of a checked buffer.
+ *
+ * The frames backing the first @a size bytes of the buffer are referenced so
+ * that they survive even if the buffer gets unmapped before the transfer is
+ * carried out. The pages are not faulted in, a buffer described by
+ * ipc_buffer_init() alone may therefore fail to be pinned.
+ *
+ * @param pin  Buffer described by ipc_buffer_init() or ipc_buffer_check().
+ * @param as   Address space of the task which checked the buffer.
+ * @param size Number of bytes to pin, at most the size of the buffer.
+ *
+ * @return EOK on success.
+ * @return ELIMIT if @a size exceeds the size of the buffer.
+ * @return EPERM if some page of the buffer is not present or cannot be
+ *         pinned.
+ * @return ENOMEM if there is not enough memory for the frame array.
+ *
+ */
+errno_t ipc_buffer_pin(ipc_pinned_t *pin, as_t *as, size_t size)
+{
+	assert(pin->valid);
+	assert(!pin->frames);
+
+	if (size > pin->size)
+		return ELIMIT;
+
+	if (size == 0)
+		return EOK;
+
+	uintptr_t base = ALIGN_DOWN((uintptr_t) pin->addr, PAGE_SIZE);
+	size_t count = (ALIGN_UP((uintptr_t) pin->addr + size, PAGE_SIZE) -
+	    base) / PAGE_SIZE;
+
+	uintptr_t *frames = malloc(count * sizeof(uintptr_t));
+	if (!frames)
+		return ENOMEM;
+
+	pin->frames = frames;
+	pin->count = 0;
+	pin->offset = (uintptr_t) pin->addr - base;
+
+	for (size_t i = 0; i < count; i++) {
+		if (!ipc_page_lookup(as, base + i * PAGE_SIZE, pin->write,
+		    &frames[i])) {
+			ipc_buffer_unpin(pin);
+			return EPERM;
+		}
+
+		pin->count++;
+	}
+
+	return EOK;
+}
+
+/** Release frames pinned by ipc_buffer_pin().
+ *
+ * It is safe to call this function repeatedly or on a structure which does
+ * not hold any frames.
+ *
+ * @param pin Pinned buffer.
+ *
+ */
+void ipc_buffer_unpin(ipc_pinned_t *pin)
+{
+	if (!pin->frames)
+		return;
+
+	for (size_t i = 0; i < pin->count; i++)
+		frame_free_noreserve(pin->frames[i], 1);
+
+	free(pin->frames);
+	pin->frames = NULL;
+	pin->count = 0;
+}
+
+/** Copy between a pinned buffer and the current address space.
+ *
+ * @param uaddr Userspace address in the current address space.
+ * @param pin   Pinned buffer.
+ * @param size  Number of bytes to copy, at most the number of bytes pinned.
+ * @param to    True to copy from the pinned buffer to @a uaddr, false to copy
+ *              in the opposite direction.
+ *
+ * @return EOK on success or an error code from @ref errno.h.
+ *
+ */
+static errno_t ipc_pinned_copy(uspace_addr_t uaddr, ipc_pinned_t *pin,
+    size_t size, bool to)
+{
+	if (size > pin->size)
+		return ELIMIT;
+
+	size_t done = 0;
+	size_t offset = pin->offset;
+
+	for (size_t i = 0; done < size; i++) {
+		assert(i < pin->count);
+
+		size_t chunk = min(PAGE_SIZE - offset, size - done);
+		uintptr_t frame = pin->frames[i];
+		uintptr_t page;
+
+		if (frame < config.identity_size) {
+			page = PA2KA(frame);
+		} else {
+			page = km_map(frame, PAGE_SIZE, PAGE_SIZE,
+			    PAGE_READ | PAGE_WRITE | PAGE_CACHEABLE);
+		}
+
+		errno_t rc;
+		if (to) {
+			rc = copy_to_uspace(uaddr + done,
+			    (void *) (page + offset), chunk);
+		} else {
+			rc = copy_from_uspace((void *) (page + offset),
+			    uaddr + done, chunk);
+		}
+
+		if (frame >= config.identity_size)
+			km_unmap(page, PAGE_SIZE);
+
+		if (rc != EOK)
+			return rc;
+
+		done += chunk;
+		offset = 0;
+	}
+
+	return EOK;
+}
+
+/** Copy data from a pinned buffer to the current address space.
+ *
+ * @param dst  Destination userspace address.
+ * @param pin  Pinned source buffer.
+ * @param size Number of bytes to copy.
+ *
+ * @return EOK on success or an error code from @ref errno.h.
+ *
+ */
+errno_t ipc_pinned_copy_to_uspace(uspace_addr_t dst, ipc_pinned_t *pin,
+    size_t size)
+{
+	return ipc_pinned_copy(dst, pin, size, true);
+}
+
+/** Copy data from the current address space to a pinned buffer.
+ *
+ * @param pin  Pinned destination buffer.
+ * @param src  Source userspace address.
+ * @param size Number of bytes to copy.
+ *
+ * @return EOK on success or an error code from @ref errno.h.
+ *
+ */
+errno_t ipc_pinned_copy_from_uspace(ipc_pinned_t *pin, uspace_addr_t src,
+    size_t size)
+{
+	return ipc_pinned_copy(src, pin, size, false);
+}
+
+/** @}
+ */
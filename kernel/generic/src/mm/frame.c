@@ -61,9 +61,13 @@
 #include <config.h>
 #include <str.h>
 #include <proc/thread.h> /* THREAD */
+#include <cpu.h>
 
 zones_t zones;
 
+/** Whether there is any available high memory zone. */
+static bool zones_highmem = false;
+
 /*
  * Synchronization primitives used to sleep when there is no memory
  * available.
@@ -161,7 +165,7 @@ _NO_TRACE static size_t frame_total_free_get_internal(void)
 	size_t i;
 
 	for (i = 0; i < zones.count; i++)
-		total += zones.info[i].free_count;
+		total += zones.info[i].free_count + zones.info[i].cached_count;
 
 	return total;
 }
@@ -427,6 +431,34 @@ _NO_TRACE static size_t zone_frame_free(zone_t *zone, size_t index)
 	return 0;
 }
 
+/** Release frame from zone to a per-CPU frame cache.
+ *
+ * Assume zone is locked and is available for deallocation. Unlike
+ * zone_frame_free(), the last reference is not dropped, but handed
+ * over to the frame cache.
+ *
+ * @param zone  Pointer to zone from which the frame is to be freed.
+ * @param index Frame index relative to zone.
+ *
+ * @return Number of freed frames.
+ *
+ */
+_NO_TRACE static size_t zone_frame_release(zone_t *zone, size_t index)
+{
+	assert(zone->flags & ZONE_AVAILABLE);
+
+	frame_t *frame = zone_get_frame(zone, index);
+	assert(frame->refcount > 0);
+
+	if (frame->refcount > 1) {
+		frame->refcount--;
+		return 0;
+	}
+
+	zone->cached_count++;
+	return 1;
+}
+
 /** Mark frame in zone unavailable to allocation. */
 _NO_TRACE static void zone_mark_unavailable(zone_t *zone, size_t index)
 {
@@ -489,9 +521,11 @@ _NO_TRACE static void zone_merge_internal(size_t z1, size_t z2, zone_t *old_z1,
 	zones.info[z1].count = base_diff + zones.info[z2].count;
 	zones.info[z1].free_count += zones.info[z2].free_count;
 	zones.info[z1].busy_count += zones.info[z2].busy_count;
+	zones.info[z1].cached_count += zones.info[z2].cached_count;
 
 	bitmap_initialize(&zones.info[z1].bitmap, zones.info[z1].count,
-	    confdata + (sizeof(frame_t) * zones.info[z1].count));
+	    confdata + (sizeof(frame_t) * zones.info[z1].count) +
+	    bitmap_summary_size(zones.info[z1].count));
 	bitmap_clear_range(&zones.info[z1].bitmap, 0, zones.info[z1].count);
 
 	zones.info[z1].frames = (frame_t *) confdata;
@@ -513,6 +547,9 @@ _NO_TRACE static void zone_merge_internal(size_t z1, size_t z2, zone_t *old_z1,
 		    zones.info[z2].frames[i];
 	}
 
+	bitmap_summary_initialize(&zones.info[z1].bitmap,
+	    confdata + (sizeof(frame_t) * zones.info[z1].count));
+
 	/*
 	 * Mark the gap between the original zones as unavailable.
 	 */
@@ -660,16 +697,20 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
 	zone->flags = flags;
 	zone->free_count = count;
 	zone->busy_count = 0;
+	zone->cached_count = 0;
 
 	if (flags & ZONE_AVAILABLE) {
 		/*
-		 * Initialize frame bitmap (located after the array of
-		 * frame_t structures in the configuration space).
+		 * Initialize frame bitmap and its summary tree (located
+		 * after the array of frame_t structures in the
+		 * configuration space).
 		 */
 
 		bitmap_initialize(&zone->bitmap, count, confdata +
-		    (sizeof(frame_t) * count));
+		    (sizeof(frame_t) * count) + bitmap_summary_size(count));
 		bitmap_clear_range(&zone->bitmap, 0, count);
+		bitmap_summary_initialize(&zone->bitmap, confdata +
+		    (sizeof(frame_t) * count));
 
 		/*
 		 * Initialize the array of frame_t structures.
@@ -694,7 +735,8 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
  */
 size_t zone_conf_size(size_t count)
 {
-	return (count * sizeof(frame_t) + bitmap_size(count));
+	return (count * sizeof(frame_t) + bitmap_summary_size(count) +
+	    bitmap_size(count));
 }
 
 /** Allocate external configuration frames from low memory. */
@@ -784,6 +826,9 @@ size_t zone_create(pfn_t start, size_t count, pfn_t confframe,
 		void *confdata = (void *) PA2KA(PFN2ADDR(confframe));
 		zone_construct(&zones.info[znum], start, count, flags, confdata);
 
+		if (flags & ZONE_HIGHMEM)
+			zones_highmem = true;
+
 		/* If confdata in zone, mark as unavailable */
 		if ((confframe >= start) && (confframe < start + count)) {
 			for (size_t i = confframe; i < confframe + confcount; i++)
@@ -859,7 +904,303 @@ static size_t try_find_zone(size_t count, bool lowmem,
 	    frame_constraint, hint);
 }
 
+/*
+ * Per-CPU frame cache functions
+ */
+
+/** Initialize per-CPU frame cache.
+ *
+ * @param cache Frame cache to be initialized.
+ *
+ */
+void frame_cache_initialize(frame_cache_t *cache)
+{
+	irq_spinlock_initialize(&cache->lock, "cpu.frame_cache.lock");
+
+	for (unsigned int i = 0; i < FRAME_CACHE_LISTS; i++) {
+		cache->list[i].hot = 0;
+		cache->list[i].count = 0;
+	}
+
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+/** Take frame from the hot end of a frame cache list. */
+_NO_TRACE static pfn_t frame_cache_pop_hot(frame_cache_t *cache,
+    frame_cache_list_t l)
+{
+	assert(cache->list[l].count > 0);
+
+	pfn_t pfn = cache->list[l].pfn[cache->list[l].hot];
+	cache->list[l].hot = (cache->list[l].hot + FRAME_CACHE_SIZE - 1) %
+	    FRAME_CACHE_SIZE;
+	cache->list[l].count--;
+
+	return pfn;
+}
+
+/** Put frame to the hot end of a frame cache list. */
+_NO_TRACE static void frame_cache_push_hot(frame_cache_t *cache,
+    frame_cache_list_t l, pfn_t pfn)
+{
+	assert(cache->list[l].count < FRAME_CACHE_SIZE);
+
+	cache->list[l].hot = (cache->list[l].hot + 1) % FRAME_CACHE_SIZE;
+	cache->list[l].pfn[cache->list[l].hot] = pfn;
+	cache->list[l].count++;
+}
+
+/** Take frame from the cold end of a frame cache list. */
+_NO_TRACE static pfn_t frame_cache_pop_cold(frame_cache_t *cache,
+    frame_cache_list_t l)
+{
+	assert(cache->list[l].count > 0);
+
+	size_t cold = (cache->list[l].hot + FRAME_CACHE_SIZE + 1 -
+	    cache->list[l].count) % FRAME_CACHE_SIZE;
+	cache->list[l].count--;
+
+	return cache->list[l].pfn[cold];
+}
+
+/** Put frame to the cold end of a frame cache list. */
+_NO_TRACE static void frame_cache_push_cold(frame_cache_t *cache,
+    frame_cache_list_t l, pfn_t pfn)
+{
+	assert(cache->list[l].count < FRAME_CACHE_SIZE);
+
+	size_t cold = (cache->list[l].hot + FRAME_CACHE_SIZE -
+	    cache->list[l].count) % FRAME_CACHE_SIZE;
+	cache->list[l].pfn[cold] = pfn;
+	cache->list[l].count++;
+}
+
+/** Refill frame cache list from the zones.
+ *
+ * Assume the frame cache is locked. A contiguous batch of frames is
+ * preferred, should the zones be too fragmented, single frames are
+ * gathered instead.
+ *
+ * @param cache Frame cache.
+ * @param l     List to refill.
+ *
+ */
+_NO_TRACE static void frame_cache_refill(frame_cache_t *cache,
+    frame_cache_list_t l)
+{
+	zone_flags_t flags = ZONE_AVAILABLE |
+	    ((l == FRAME_CACHE_HIGHMEM) ? ZONE_HIGHMEM : ZONE_LOWMEM);
+
+	irq_spinlock_lock(&zones.lock, false);
+
+	size_t znum = find_free_zone(FRAME_CACHE_BATCH, flags, 0, 0);
+	if (znum != (size_t) -1) {
+		zone_t *zone = &zones.info[znum];
+		size_t index = zone_frame_alloc(zone, FRAME_CACHE_BATCH, 0);
+
+		for (size_t i = 0; i < FRAME_CACHE_BATCH; i++)
+			frame_cache_push_cold(cache, l, zone->base + index + i);
+
+		zone->cached_count += FRAME_CACHE_BATCH;
+	} else {
+		znum = 0;
+
+		while (cache->list[l].count < FRAME_CACHE_BATCH) {
+			znum = find_free_zone(1, flags, 0, znum);
+			if (znum == (size_t) -1)
+				break;
+
+			zone_t *zone = &zones.info[znum];
+			size_t index = zone_frame_alloc(zone, 1, 0);
+
+			frame_cache_push_cold(cache, l, zone->base + index);
+			zone->cached_count++;
+		}
+	}
+
+	irq_spinlock_unlock(&zones.lock, false);
+}
+
+/** Return frames from the cold end of a frame cache list to the zones.
+ *
+ * Assume the frame cache is locked.
+ *
+ * @param cache Frame cache.
+ * @param l     List to drain.
+ * @param count Maximum number of frames to return.
+ *
+ * @return Number of frames returned to the zones.
+ *
+ */
+_NO_TRACE static size_t frame_cache_drain(frame_cache_t *cache,
+    frame_cache_list_t l, size_t count)
+{
+	size_t drained = 0;
+	size_t znum = 0;
+
+	irq_spinlock_lock(&zones.lock, false);
+
+	while ((drained < count) && (cache->list[l].count > 0)) {
+		pfn_t pfn = frame_cache_pop_cold(cache, l);
+
+		znum = find_zone(pfn, 1, znum);
+		assert(znum != (size_t) -1);
+
+		zone_t *zone = &zones.info[znum];
+		assert(zone->cached_count > 0);
+
+		zone->cached_count--;
+		drained += zone_frame_free(zone, pfn - zone->base);
+	}
+
+	irq_spinlock_unlock(&zones.lock, false);
+
+	return drained;
+}
+
+/** Return all frames held by the per-CPU frame caches to the zones.
+ *
+ * This is needed when the zones cannot satisfy an allocation on their
+ * own, e.g. when the free frames are scattered among the caches or when
+ * contiguous frames are requested.
+ *
+ * @return Number of frames returned to the zones.
+ *
+ */
+size_t frame_cache_drain_all(void)
+{
+	size_t drained = 0;
+
+	if (cpus == NULL)
+		return 0;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		/* Caches of inactive processors are never used. */
+		if (!cpus[i].active)
+			continue;
+
+		frame_cache_t *cache = &cpus[i].frame_cache;
+
+		irq_spinlock_lock(&cache->lock, true);
+
+		for (unsigned int l = 0; l < FRAME_CACHE_LISTS; l++) {
+			drained += frame_cache_drain(cache,
+			    (frame_cache_list_t) l, FRAME_CACHE_SIZE);
+		}
+
+		irq_spinlock_unlock(&cache->lock, true);
+	}
+
+	return drained;
+}
+
+/** Take a frame from a frame cache list, refilling it if needed.
+ *
+ * Assume the frame cache is locked.
+ *
+ * @return Frame number or zero if the list could not be refilled.
+ *
+ */
+_NO_TRACE static pfn_t frame_cache_get(frame_cache_t *cache,
+    frame_cache_list_t l)
+{
+	if (cache->list[l].count > 0) {
+		cache->hits++;
+	} else {
+		cache->misses++;
+		frame_cache_refill(cache, l);
+
+		if (cache->list[l].count == 0)
+			return 0;
+	}
+
+	return frame_cache_pop_hot(cache, l);
+}
+
+/** Allocate a single frame from the frame cache of the current CPU.
+ *
+ * @param lowmem Whether the frame must be identity-mapped.
+ *
+ * @return Frame number or zero if no frame could be allocated this way.
+ *
+ */
+_NO_TRACE static pfn_t frame_cache_alloc(bool lowmem)
+{
+	pfn_t pfn = 0;
+	ipl_t ipl = interrupts_disable();
+
+	if (CPU != NULL) {
+		frame_cache_t *cache = &CPU->frame_cache;
+
+		irq_spinlock_lock(&cache->lock, false);
+
+		if ((!lowmem) && (zones_highmem))
+			pfn = frame_cache_get(cache, FRAME_CACHE_HIGHMEM);
+
+		if (pfn == 0)
+			pfn = frame_cache_get(cache, FRAME_CACHE_LOWMEM);
+
+		irq_spinlock_unlock(&cache->lock, false);
+	}
+
+	interrupts_restore(ipl);
+	return pfn;
+}
+
+/** Free a single frame to the frame cache of the current CPU.
+ *
+ * @param pfn Frame to be freed.
+ *
+ * @return Number of freed frames or -1 if the frame cannot be cached.
+ *
+ */
+_NO_TRACE static size_t frame_cache_free(pfn_t pfn)
+{
+	/* Keep high-priority memory for those who really need it. */
+	if (is_high_priority(pfn, 1))
+		return (size_t) -1;
+
+	ipl_t ipl = interrupts_disable();
+
+	if (CPU == NULL) {
+		interrupts_restore(ipl);
+		return (size_t) -1;
+	}
+
+	irq_spinlock_lock(&zones.lock, false);
+
+	size_t znum = find_zone(pfn, 1, 0);
+	assert(znum != (size_t) -1);
+
+	zone_t *zone = &zones.info[znum];
+	frame_cache_list_t l = (zone->flags & ZONE_LOWMEM) ?
+	    FRAME_CACHE_LOWMEM : FRAME_CACHE_HIGHMEM;
+	size_t freed = zone_frame_release(zone, pfn - zone->base);
+
+	irq_spinlock_unlock(&zones.lock, false);
+
+	if (freed > 0) {
+		frame_cache_t *cache = &CPU->frame_cache;
+
+		irq_spinlock_lock(&cache->lock, false);
+
+		if (cache->list[l].count == FRAME_CACHE_SIZE)
+			frame_cache_drain(cache, l, FRAME_CACHE_BATCH);
+
+		frame_cache_push_hot(cache, l, pfn);
+
+		irq_spinlock_unlock(&cache->lock, false);
+	}
+
+	interrupts_restore(ipl);
+	return freed;
+}
+
 /** Allocate frames of physical memory.
+ *
+ * Single frames without a constraint are taken from the per-CPU frame
+ * cache, the preferred zone is left untouched in that case.
  *
  * @param count      Number of continuous frames to allocate.
  * @param flags      Flags for host zone selection and address processing.
@@ -884,17 +1225,37 @@ uintptr_t frame_alloc_generic(size_t count, frame_flags_t flags,
 	if (!(flags & FRAME_NO_RESERVE))
 		reserve_force_alloc(count);
 
-loop:
-	irq_spinlock_lock(&zones.lock, true);
-
 	// TODO: Print diagnostic if neither is explicitly specified.
 	bool lowmem = (flags & FRAME_LOWMEM) || !(flags & FRAME_HIGHMEM);
 
+	if ((count == 1) && (frame_constraint == 0)) {
+		pfn_t pfn = frame_cache_alloc(lowmem);
+		if (pfn != 0)
+			return PFN2ADDR(pfn);
+	}
+
+loop:
+	irq_spinlock_lock(&zones.lock, true);
+
 	/*
 	 * First, find suitable frame zone.
 	 */
 	size_t znum = try_find_zone(count, lowmem, frame_constraint, hint);
 
+	/*
+	 * If no memory, return the frames held by the per-CPU
+	 * frame caches to the zones.
+	 */
+	if (znum == (size_t) -1) {
+		irq_spinlock_unlock(&zones.lock, true);
+		size_t drained = frame_cache_drain_all();
+		irq_spinlock_lock(&zones.lock, true);
+
+		if (drained > 0)
+			znum = try_find_zone(count, lowmem, frame_constraint,
+			    hint);
+	}
+
 	/*
 	 * If no memory, reclaim some slab memory,
 	 * if it does not help, reclaim all.
@@ -995,7 +1356,8 @@ uintptr_t frame_alloc(size_t count, frame_flags_t flags, uintptr_t constraint)
  *
  * Find respective frame structures for supplied physical frames.
  * Decrement each frame reference count. If it drops to zero, mark
- * the frames as available.
+ * the frames as available. Single frames are put to the per-CPU
+ * frame cache instead.
  *
  * @param start Physical Address of the first frame to be freed.
  * @param count Number of frames to free.
@@ -1004,24 +1366,29 @@ uintptr_t frame_alloc(size_t count, frame_flags_t flags, uintptr_t constraint)
  */
 void frame_free_generic(uintptr_t start, size_t count, frame_flags_t flags)
 {
-	size_t freed = 0;
+	size_t freed = (count == 1) ?
+	    frame_cache_free(ADDR2PFN(start)) : (size_t) -1;
 
-	irq_spinlock_lock(&zones.lock, true);
+	if (freed == (size_t) -1) {
+		freed = 0;
 
-	for (size_t i = 0; i < count; i++) {
-		/*
-		 * First, find host frame zone for addr.
-		 */
-		pfn_t pfn = ADDR2PFN(start) + i;
-		size_t znum = find_zone(pfn, 1, 0);
+		irq_spinlock_lock(&zones.lock, true);
 
-		assert(znum != (size_t) -1);
+		for (size_t i = 0; i < count; i++) {
+			/*
+			 * First, find host frame zone for addr.
+			 */
+			pfn_t pfn = ADDR2PFN(start) + i;
+			size_t znum = find_zone(pfn, 1, 0);
 
-		freed += zone_frame_free(&zones.info[znum],
-		    pfn - zones.info[znum].base);
-	}
+			assert(znum != (size_t) -1);
 
-	irq_spinlock_unlock(&zones.lock, true);
+			freed += zone_frame_free(&zones.info[znum],
+			    pfn - zones.info[znum].base);
+		}
+
+		irq_spinlock_unlock(&zones.lock, true);
+	}
 
 	/*
 	 * Signal that some memory has been freed.
@@ -1195,13 +1562,30 @@ uint64_t zones_total_size(void)
 	return total;
 }
 
+/** Gather physical memory statistics.
+ *
+ * Frames held by the per-CPU frame caches are reported as free and
+ * additionally in @a cached.
+ *
+ * @param total   Total size of all zones (bytes).
+ * @param unavail Size of unavailable zones (bytes).
+ * @param busy    Allocated memory (bytes).
+ * @param free    Free memory (bytes).
+ * @param cached  Free memory held by the per-CPU frame caches (bytes).
+ * @param hits    Number of allocations served by the frame caches.
+ * @param misses  Number of frame cache refills.
+ *
+ */
 void zones_stats(uint64_t *total, uint64_t *unavail, uint64_t *busy,
-    uint64_t *free)
+    uint64_t *free, uint64_t *cached, uint64_t *hits, uint64_t *misses)
 {
 	assert(total != NULL);
 	assert(unavail != NULL);
 	assert(busy != NULL);
 	assert(free != NULL);
+	assert(cached != NULL);
+	assert(hits != NULL);
+	assert(misses != NULL);
 
 	irq_spinlock_lock(&zones.lock, true);
 
@@ -1209,18 +1593,40 @@ void zones_stats(uint64_t *total, uint64_t *unavail, uint64_t *busy,
 	*unavail = 0;
 	*busy = 0;
 	*free = 0;
+	*cached = 0;
 
 	for (size_t i = 0; i < zones.count; i++) {
 		*total += (uint64_t) FRAMES2SIZE(zones.info[i].count);
 
 		if (zones.info[i].flags & ZONE_AVAILABLE) {
-			*busy += (uint64_t) FRAMES2SIZE(zones.info[i].busy_count);
-			*free += (uint64_t) FRAMES2SIZE(zones.info[i].free_count);
+			size_t busy_count = zones.info[i].busy_count -
+			    zones.info[i].cached_count;
+			size_t free_count = zones.info[i].free_count +
+			    zones.info[i].cached_count;
+
+			*busy += (uint64_t) FRAMES2SIZE(busy_count);
+			*free += (uint64_t) FRAMES2SIZE(free_count);
+			*cached += (uint64_t)
+			    FRAMES2SIZE(zones.info[i].cached_count);
 		} else
 			*unavail += (uint64_t) FRAMES2SIZE(zones.info[i].count);
 	}
 
 	irq_spinlock_unlock(&zones.lock, true);
+
+	/*
+	 * The counters are only updated by their own processors,
+	 * reading them unlocked yields a good enough snapshot.
+	 */
+	*hits = 0;
+	*misses = 0;
+
+	if (cpus != NULL) {
+		for (size_t i = 0; i < config.cpu_count; i++) {
+			*hits += cpus[i].frame_cache.hits;
+			*misses += cpus[i].frame_cache.misses;
+		}
+	}
 }
 
 /** Prints list of zones.
@@ -1342,6 +1748,14 @@ void zones_print_list(void)
 	    false);
 	printf("Available high priority: %zu frames (%" PRIu64 " %s)\n",
 	    free_highprio, size, size_suffix);
+
+	uint64_t total, unavail, busy, free, cached, hits, misses;
+	zones_stats(&total, &unavail, &busy, &free, &cached, &hits, &misses);
+
+	bin_order_suffix(cached, &size, &size_suffix, false);
+	printf("Per-CPU frame caches:    %" PRIu64 " frames (%" PRIu64 " %s), "
+	    "%" PRIu64 " hits, %" PRIu64 " misses\n", cached / FRAME_SIZE,
+	    size, size_suffix, hits, misses);
 }
 
 /** Prints zone details.
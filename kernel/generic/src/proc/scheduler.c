@@ -47,6 +47,7 @@
 #include <mm/page.h>
 #include <mm/as.h>
 #include <time/timeout.h>
+#include <time/clock.h>
 #include <time/delay.h>
 #include <arch/asm.h>
 #include <arch/faddr.h>
@@ -59,6 +60,7 @@
 #include <halt.h>
 #include <arch.h>
 #include <adt/list.h>
+#include <bitops.h>
 #include <panic.h>
 #include <cpu.h>
 #include <stdio.h>
@@ -172,6 +174,185 @@ void scheduler_init(void)
 {
 }
 
+#ifdef CONFIG_SMP
+
+/** Steal a thread from a run queue of another CPU
+ *
+ * The queue is searched from the back. CPU-wired threads, threads
+ * already stolen, threads for which migration was temporarily disabled
+ * and threads whose FPU context is still in the CPU are skipped.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param cpu CPU to steal from.
+ * @param rq  Index of the run queue to steal from.
+ *
+ * @return Stolen thread removed from the run queue or NULL.
+ *
+ */
+static thread_t *steal_thread(cpu_t *cpu, int rq)
+{
+	irq_spinlock_lock(&(cpu->rq[rq].lock), false);
+	if (cpu->rq[rq].n == 0) {
+		irq_spinlock_unlock(&(cpu->rq[rq].lock), false);
+		return NULL;
+	}
+
+	thread_t *thread = NULL;
+
+	/* Search rq from the back */
+	link_t *link = list_last(&cpu->rq[rq].rq);
+
+	while (link != NULL) {
+		thread = (thread_t *) list_get_instance(link, thread_t,
+		    rq_link);
+
+		irq_spinlock_lock(&thread->lock, false);
+
+		if ((!thread->wired) && (!thread->stolen) &&
+		    (!thread->nomigrate) && (!thread->fpu_context_engaged)) {
+			/*
+			 * Remove thread from ready queue.
+			 */
+			irq_spinlock_unlock(&thread->lock, false);
+
+			atomic_dec(&cpu->nrdy);
+			atomic_dec(&nrdy);
+
+			if (--cpu->rq[rq].n == 0)
+				cpu_rq_unmark(cpu, rq);
+			list_remove(&thread->rq_link);
+
+			break;
+		}
+
+		irq_spinlock_unlock(&thread->lock, false);
+
+		link = list_prev(link, &cpu->rq[rq].rq);
+		thread = NULL;
+	}
+
+	if (thread == NULL) {
+		irq_spinlock_unlock(&(cpu->rq[rq].lock), false);
+		return NULL;
+	}
+
+	irq_spinlock_pass(&(cpu->rq[rq].lock), &thread->lock);
+
+	thread->stolen = true;
+	thread->state = Entering;
+
+	irq_spinlock_unlock(&thread->lock, false);
+
+	return thread;
+}
+
+/** Steal work for an idle CPU
+ *
+ * Instead of waiting for kcpulb to rebalance the load, an idle CPU
+ * tries to take a ready thread from a busy CPU right away. The CPUs
+ * with the numerically closest IDs are tried first as they are most
+ * likely to share caches. The lowest-priority queues are searched
+ * first, same as in kcpulb.
+ *
+ * Interrupts must be disabled.
+ *
+ * @return True if a thread was made ready on the current CPU.
+ *
+ */
+static bool steal_for_idle(void)
+{
+	bool attempted = false;
+	thread_t *thread = NULL;
+
+	for (size_t dist = 1; (dist < config.cpu_count) && (!thread); dist++) {
+		for (int side = 0; (side < 2) && (!thread); side++) {
+			size_t id;
+			if (side == 0)
+				id = CPU->id + dist;
+			else if (CPU->id >= dist)
+				id = CPU->id - dist;
+			else
+				continue;
+
+			if (id >= config.cpu_count)
+				continue;
+
+			cpu_t *cpu = &cpus[id];
+
+			/*
+			 * An idle CPU will run its ready threads itself
+			 * soon enough.
+			 */
+			if ((!cpu->active) || (cpu->idle) ||
+			    (atomic_load(&cpu->nrdy) == 0))
+				continue;
+
+			attempted = true;
+
+			unsigned int mask = atomic_load(&cpu->rq_mask);
+			while ((mask != 0) && (!thread)) {
+				int rq = fnzb32(mask);
+				mask &= ~(1U << rq);
+
+				thread = steal_thread(cpu, rq);
+			}
+		}
+	}
+
+	if (attempted) {
+		irq_spinlock_lock(&CPU->lock, false);
+		CPU->steal_attempts++;
+		if (thread)
+			CPU->steals++;
+		irq_spinlock_unlock(&CPU->lock, false);
+	}
+
+	if (!thread)
+		return false;
+
+	thread_ready(thread);
+	return true;
+}
+
+/** Wake up an idle CPU to steal work from a busy one
+ *
+ * Idle CPUs steal ready threads in find_best_thread(), but one which has
+ * stopped its periodic tick gets there only when something wakes it up.
+ * The idle CPU with the numerically closest ID is woken up, same as the
+ * order in which steal_for_idle() looks for work.
+ *
+ * @param busy CPU with more ready threads than it can run at once.
+ *
+ */
+void scheduler_kick_idle(cpu_t *busy)
+{
+	for (size_t dist = 1; dist < config.cpu_count; dist++) {
+		for (int side = 0; side < 2; side++) {
+			size_t id;
+			if (side == 0)
+				id = busy->id + dist;
+			else if (busy->id >= dist)
+				id = busy->id - dist;
+			else
+				continue;
+
+			if (id >= config.cpu_count)
+				continue;
+
+			cpu_t *cpu = &cpus[id];
+
+			if ((cpu->active) && (cpu->idle) &&
+			    (atomic_load(&cpu->tickless))) {
+				clock_tickless_kick(cpu);
+				return;
+			}
+		}
+	}
+}
+
+#endif /* CONFIG_SMP */
+
 /** Get thread to be scheduled
  *
  * Get the optimal thread to be scheduled
@@ -188,6 +369,11 @@ static thread_t *find_best_thread(void)
 loop:
 
 	if (atomic_load(&CPU->nrdy) == 0) {
+#ifdef CONFIG_SMP
+		if (steal_for_idle())
+			goto loop;
+#endif
+
 		/*
 		 * For there was nothing to run, the CPU goes to sleep
 		 * until a hardware interrupt or an IPI comes.
@@ -196,6 +382,12 @@ loop:
 		irq_spinlock_lock(&CPU->lock, false);
 		CPU->idle = true;
 		irq_spinlock_unlock(&CPU->lock, false);
+
+		/*
+		 * Stop the periodic tick until the next timeout
+		 * is due if the platform supports it.
+		 */
+		clock_tickless_enter();
 		interrupts_enable();
 
 		/*
@@ -205,50 +397,54 @@ loop:
 		 */
 		cpu_sleep();
 		interrupts_disable();
+		clock_tickless_leave();
 		goto loop;
 	}
 
 	assert(!CPU->idle);
 
-	unsigned int i;
-	for (i = 0; i < RQ_COUNT; i++) {
-		irq_spinlock_lock(&(CPU->rq[i].lock), false);
-		if (CPU->rq[i].n == 0) {
-			/*
-			 * If this queue is empty, try a lower-priority queue.
-			 */
-			irq_spinlock_unlock(&(CPU->rq[i].lock), false);
-			continue;
-		}
+	/*
+	 * Pick the highest-priority non-empty queue. The mask might be
+	 * stale by the time we get the lock, in which case just retry.
+	 */
+	unsigned int mask = atomic_load(&CPU->rq_mask);
+	if (mask == 0)
+		goto loop;
 
-		atomic_dec(&CPU->nrdy);
-		atomic_dec(&nrdy);
-		CPU->rq[i].n--;
+	unsigned int i = fnzb32(mask & -mask);
 
-		/*
-		 * Take the first thread from the queue.
-		 */
-		thread_t *thread = list_get_instance(
-		    list_first(&CPU->rq[i].rq), thread_t, rq_link);
-		list_remove(&thread->rq_link);
+	irq_spinlock_lock(&(CPU->rq[i].lock), false);
+	if (CPU->rq[i].n == 0) {
+		irq_spinlock_unlock(&(CPU->rq[i].lock), false);
+		goto loop;
+	}
 
-		irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
+	atomic_dec(&CPU->nrdy);
+	atomic_dec(&nrdy);
+	if (--CPU->rq[i].n == 0)
+		cpu_rq_unmark(CPU, i);
 
-		thread->cpu = CPU;
-		thread->ticks = us2ticks((i + 1) * 10000);
-		thread->priority = i;  /* Correct rq index */
+	/*
+	 * Take the first thread from the queue.
+	 */
+	thread_t *thread = list_get_instance(
+	    list_first(&CPU->rq[i].rq), thread_t, rq_link);
+	list_remove(&thread->rq_link);
 
-		/*
-		 * Clear the stolen flag so that it can be migrated
-		 * when load balancing needs emerge.
-		 */
-		thread->stolen = false;
-		irq_spinlock_unlock(&thread->lock, false);
+	irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
 
-		return thread;
-	}
+	thread->cpu = CPU;
+	thread->ticks = us2ticks((i + 1) * 10000);
+	thread->priority = i;  /* Correct rq index */
 
-	goto loop;
+	/*
+	 * Clear the stolen flag so that it can be migrated
+	 * when load balancing needs emerge.
+	 */
+	thread->stolen = false;
+	irq_spinlock_unlock(&thread->lock, false);
+
+	return thread;
 }
 
 /** Prevent rq starvation
@@ -272,19 +468,28 @@ static void relink_rq(int start)
 	if (CPU->needs_relink > NEEDS_RELINK_MAX) {
 		int i;
 		for (i = start; i < RQ_COUNT - 1; i++) {
+			/* Do not bother locking empty queues */
+			if ((atomic_load(&CPU->rq_mask) & (1U << (i + 1))) == 0)
+				continue;
+
 			/* Remember and empty rq[i + 1] */
 
 			irq_spinlock_lock(&CPU->rq[i + 1].lock, false);
 			list_concat(&list, &CPU->rq[i + 1].rq);
 			size_t n = CPU->rq[i + 1].n;
 			CPU->rq[i + 1].n = 0;
+			cpu_rq_unmark(CPU, i + 1);
 			irq_spinlock_unlock(&CPU->rq[i + 1].lock, false);
 
+			if (n == 0)
+				continue;
+
 			/* Append rq[i + 1] to rq[i] */
 
 			irq_spinlock_lock(&CPU->rq[i].lock, false);
 			list_concat(&CPU->rq[i].rq, &list);
 			CPU->rq[i].n += n;
+			cpu_rq_mark(CPU, i);
 			irq_spinlock_unlock(&CPU->rq[i].lock, false);
 		}
 
@@ -600,61 +805,14 @@ not_satisfied:
 			if (atomic_load(&cpu->nrdy) <= average)
 				continue;
 
-			irq_spinlock_lock(&(cpu->rq[rq].lock), true);
-			if (cpu->rq[rq].n == 0) {
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
+			if ((atomic_load(&cpu->rq_mask) & (1U << rq)) == 0)
 				continue;
-			}
-
-			thread_t *thread = NULL;
-
-			/* Search rq from the back */
-			link_t *link = list_last(&cpu->rq[rq].rq);
-
-			while (link != NULL) {
-				thread = (thread_t *) list_get_instance(link,
-				    thread_t, rq_link);
-
-				/*
-				 * Do not steal CPU-wired threads, threads
-				 * already stolen, threads for which migration
-				 * was temporarily disabled or threads whose
-				 * FPU context is still in the CPU.
-				 */
-				irq_spinlock_lock(&thread->lock, false);
-
-				if ((!thread->wired) && (!thread->stolen) &&
-				    (!thread->nomigrate) &&
-				    (!thread->fpu_context_engaged)) {
-					/*
-					 * Remove thread from ready queue.
-					 */
-					irq_spinlock_unlock(&thread->lock,
-					    false);
-
-					atomic_dec(&cpu->nrdy);
-					atomic_dec(&nrdy);
-
-					cpu->rq[rq].n--;
-					list_remove(&thread->rq_link);
 
-					break;
-				}
-
-				irq_spinlock_unlock(&thread->lock, false);
-
-				link = list_prev(link, &cpu->rq[rq].rq);
-				thread = NULL;
-			}
+			ipl_t ipl = interrupts_disable();
+			thread_t *thread = steal_thread(cpu, rq);
+			interrupts_restore(ipl);
 
 			if (thread) {
-				/*
-				 * Ready thread on local CPU
-				 */
-
-				irq_spinlock_pass(&(cpu->rq[rq].lock),
-				    &thread->lock);
-
 #ifdef KCPULB_VERBOSE
 				log(LF_OTHER, LVL_DEBUG,
 				    "kcpulb%u: TID %" PRIu64 " -> cpu%u, "
@@ -663,10 +821,9 @@ not_satisfied:
 				    atomic_load(&nrdy) / config.cpu_active);
 #endif
 
-				thread->stolen = true;
-				thread->state = Entering;
-
-				irq_spinlock_unlock(&thread->lock, true);
+				/*
+				 * Ready thread on local CPU
+				 */
 				thread_ready(thread);
 
 				if (--count == 0)
@@ -678,11 +835,7 @@ not_satisfied:
 				 *
 				 */
 				acpu_bias++;
-
-				continue;
-			} else
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
-
+			}
 		}
 	}
 
@@ -720,9 +873,10 @@ void sched_print_list(void)
 
 		irq_spinlock_lock(&cpus[cpu].lock, true);
 
-		printf("cpu%u: address=%p, nrdy=%zu, needs_relink=%zu\n",
-		    cpus[cpu].id, &cpus[cpu], atomic_load(&cpus[cpu].nrdy),
-		    cpus[cpu].needs_relink);
+		printf("cpu%u: address=%p, nrdy=%zu, needs_relink=%zu, "
+		    "rq_mask=%#x\n", cpus[cpu].id, &cpus[cpu],
+		    atomic_load(&cpus[cpu].nrdy), cpus[cpu].needs_relink,
+		    atomic_load(&cpus[cpu].rq_mask));
 
 		unsigned int i;
 		for (i = 0; i < RQ_COUNT; i++) {
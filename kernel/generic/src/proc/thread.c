@@ -317,10 +317,19 @@ void thread_ready(thread_t *thread)
 
 	list_append(&thread->rq_link, &cpu->rq[i].rq);
 	cpu->rq[i].n++;
+	cpu_rq_mark(cpu, i);
 	irq_spinlock_unlock(&(cpu->rq[i].lock), true);
 
 	atomic_inc(&nrdy);
 	atomic_inc(&cpu->nrdy);
+
+	clock_tickless_kick(cpu);
+
+#ifdef CONFIG_SMP
+	/* Let an idle CPU take over some of the backlog. */
+	if (atomic_load(&cpu->nrdy) > 1)
+		scheduler_kick_idle(cpu);
+#endif
 }
 
 /** Create new thread
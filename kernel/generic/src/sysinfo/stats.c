@@ -125,6 +125,8 @@ static void *get_stats_cpus(struct sysinfo_item *item, size_t *size,
 		stats_cpus[i].frequency_mhz = cpus[i].frequency_mhz;
 		stats_cpus[i].busy_cycles = cpus[i].busy_cycles;
 		stats_cpus[i].idle_cycles = cpus[i].idle_cycles;
+		stats_cpus[i].steal_attempts = cpus[i].steal_attempts;
+		stats_cpus[i].steals = cpus[i].steals;
 
 		irq_spinlock_unlock(&cpus[i].lock, true);
 	}
@@ -785,7 +787,9 @@ static void *get_stats_physmem(struct sysinfo_item *item, size_t *size,
 	}
 
 	zones_stats(&(stats_physmem->total), &(stats_physmem->unavail),
-	    &(stats_physmem->used), &(stats_physmem->free));
+	    &(stats_physmem->used), &(stats_physmem->free),
+	    &(stats_physmem->cached), &(stats_physmem->cache_hits),
+	    &(stats_physmem->cache_misses));
 
 	return ((void *) stats_physmem);
 }
@@ -61,6 +61,9 @@
 /* Pointer to variable with uptime */
 uptime_t *uptime;
 
+/** Local timer operations for tickless idle (if supported) */
+clock_tickless_ops_t *clock_tickless_ops = NULL;
+
 /** Physical memory area of the real time clock */
 static parea_t clock_parea;
 
@@ -136,6 +139,74 @@ static void cpu_update_accounting(void)
 	irq_spinlock_unlock(&CPU->lock, false);
 }
 
+/** Stop the periodic tick on an idle CPU
+ *
+ * Called by the scheduler with interrupts disabled right before the
+ * CPU goes to sleep. The local timer is reprogrammed to interrupt only
+ * when the earliest pending timeout of this CPU is due.
+ *
+ * The bootstrap CPU keeps ticking because it maintains the uptime
+ * counters.
+ *
+ */
+void clock_tickless_enter(void)
+{
+	if ((clock_tickless_ops == NULL) || (CPU->id == 0))
+		return;
+
+	irq_spinlock_lock(&CPU->timeoutlock, false);
+	uint64_t ticks = timeout_wheel_next(&CPU->timeout_wheel,
+	    CLOCK_TICKLESS_MAX);
+	irq_spinlock_unlock(&CPU->timeoutlock, false);
+
+	/* Not worth it if there is at most one tick to skip */
+	if (ticks < 2)
+		return;
+
+	atomic_store(&CPU->tickless, true);
+
+	/*
+	 * A thread might have been made ready by another CPU which did not
+	 * see the tickless flag yet, so it would not kick us.
+	 */
+	if (atomic_load(&CPU->nrdy) != 0) {
+		atomic_store(&CPU->tickless, false);
+		return;
+	}
+
+	clock_tickless_ops->stop(ticks + 1);
+}
+
+/** Restart the periodic tick after tickless idle
+ *
+ * The elapsed ticks are accounted as missed so that the next clock()
+ * catches up with them. Called with interrupts disabled.
+ *
+ */
+void clock_tickless_leave(void)
+{
+	if (!atomic_load(&CPU->tickless))
+		return;
+
+	atomic_store(&CPU->tickless, false);
+	CPU->missed_clock_ticks += clock_tickless_ops->restart();
+}
+
+/** Wake up a CPU in tickless idle
+ *
+ * Called after a thread was made ready on @a cpu. A CPU sleeping in
+ * tickless idle would otherwise notice the thread only on its next
+ * timeout.
+ *
+ * @param cpu CPU to be woken up.
+ *
+ */
+void clock_tickless_kick(cpu_t *cpu)
+{
+	if ((cpu != CPU) && (atomic_load(&cpu->tickless)))
+		clock_tickless_ops->kick(cpu);
+}
+
 /** Clock routine
  *
  * Clock routine executed from clock interrupt handler
@@ -145,6 +216,9 @@ static void cpu_update_accounting(void)
  */
 void clock(void)
 {
+	/* The tick might be the one requested by clock_tickless_enter(). */
+	clock_tickless_leave();
+
 	size_t missed_clock_ticks = CPU->missed_clock_ticks;
 
 	/* Account CPU usage */
@@ -163,18 +237,18 @@ void clock(void)
 
 		irq_spinlock_lock(&CPU->timeoutlock, false);
 
+		timeout_wheel_t *wheel = &CPU->timeout_wheel;
+		timeout_wheel_advance(wheel);
+
 		link_t *cur;
-		while ((cur = list_first(&CPU->timeout_active_list)) != NULL) {
+		while ((cur = list_first(&wheel->expired)) != NULL) {
 			timeout_t *timeout = list_get_instance(cur, timeout_t,
 			    link);
 
 			irq_spinlock_lock(&timeout->lock, false);
-			if (timeout->ticks-- != 0) {
-				irq_spinlock_unlock(&timeout->lock, false);
-				break;
-			}
 
 			list_remove(cur);
+			wheel->pending--;
 			timeout_handler_t handler = timeout->handler;
 			void *arg = timeout->arg;
 			timeout_reinitialize(timeout);
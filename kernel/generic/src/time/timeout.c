@@ -39,10 +39,12 @@
 #include <typedefs.h>
 #include <config.h>
 #include <panic.h>
+#include <stdio.h>
 #include <synch/spinlock.h>
 #include <halt.h>
 #include <cpu.h>
 #include <arch/asm.h>
+#include <arch/cycle.h>
 #include <arch.h>
 
 /** Initialize timeouts
@@ -53,7 +55,19 @@
 void timeout_init(void)
 {
 	irq_spinlock_initialize(&CPU->timeoutlock, "cpu.timeoutlock");
-	list_initialize(&CPU->timeout_active_list);
+
+	timeout_wheel_t *wheel = &CPU->timeout_wheel;
+	wheel->tick = 0;
+	wheel->pending = 0;
+	wheel->registered = 0;
+	wheel->insert_max_cycles = 0;
+
+	for (unsigned int level = 0; level < TIMEOUT_WHEEL_LEVELS; level++) {
+		for (unsigned int i = 0; i < TIMEOUT_WHEEL_SLOTS; i++)
+			list_initialize(&wheel->slot[level][i]);
+	}
+
+	list_initialize(&wheel->expired);
 }
 
 /** Reinitialize timeout
@@ -66,7 +80,7 @@ void timeout_init(void)
 void timeout_reinitialize(timeout_t *timeout)
 {
 	timeout->cpu = NULL;
-	timeout->ticks = 0;
+	timeout->deadline = 0;
 	timeout->handler = NULL;
 	timeout->arg = NULL;
 	link_initialize(&timeout->link);
@@ -85,10 +99,142 @@ void timeout_initialize(timeout_t *timeout)
 	timeout_reinitialize(timeout);
 }
 
+/** Put timeout into the wheel slot matching its deadline
+ *
+ * The level is chosen according to the distance of the deadline from
+ * the current tick of the wheel, so that the slot is cascaded (or
+ * expired) before the deadline passes and no sooner than one full
+ * revolution of the level below.
+ *
+ * @param wheel   Timing wheel (with the timeout lock held).
+ * @param timeout Timeout to insert.
+ *
+ */
+static void timeout_wheel_insert(timeout_wheel_t *wheel, timeout_t *timeout)
+{
+	uint64_t deadline = timeout->deadline;
+	uint64_t delta = deadline - wheel->tick;
+
+	if (deadline < wheel->tick) {
+		/* Already overdue, expire in the next tick. */
+		deadline = wheel->tick;
+		delta = 0;
+	} else if (delta > TIMEOUT_WHEEL_RANGE) {
+		/* Park in the last level, it will be cascaded again. */
+		deadline = wheel->tick + TIMEOUT_WHEEL_RANGE;
+		delta = TIMEOUT_WHEEL_RANGE;
+	}
+
+	unsigned int level = 0;
+	while ((delta >> (TIMEOUT_WHEEL_BITS * (level + 1))) != 0)
+		level++;
+
+	unsigned int idx = (deadline >> (TIMEOUT_WHEEL_BITS * level)) &
+	    TIMEOUT_WHEEL_MASK;
+	list_append(&timeout->link, &wheel->slot[level][idx]);
+}
+
+/** Move timeouts from an upper level slot down the wheel
+ *
+ * @param wheel Timing wheel (with the timeout lock held).
+ * @param level Wheel level to cascade from.
+ *
+ * @return Index of the cascaded slot.
+ *
+ */
+static unsigned int timeout_wheel_cascade(timeout_wheel_t *wheel,
+    unsigned int level)
+{
+	unsigned int idx = (wheel->tick >> (TIMEOUT_WHEEL_BITS * level)) &
+	    TIMEOUT_WHEEL_MASK;
+
+	list_t batch;
+	list_initialize(&batch);
+	list_concat(&batch, &wheel->slot[level][idx]);
+
+	link_t *cur;
+	while ((cur = list_first(&batch)) != NULL) {
+		timeout_t *timeout = list_get_instance(cur, timeout_t, link);
+
+		irq_spinlock_lock(&timeout->lock, false);
+		list_remove(cur);
+		timeout_wheel_insert(wheel, timeout);
+		irq_spinlock_unlock(&timeout->lock, false);
+	}
+
+	return idx;
+}
+
+/** Advance the timing wheel by one tick
+ *
+ * Cascade the upper levels if the lower levels wrapped around and
+ * move the timeouts expiring in the current tick to the list of
+ * expired timeouts. Running their handlers is left to the caller.
+ *
+ * @param wheel Timing wheel (with the timeout lock held).
+ *
+ */
+void timeout_wheel_advance(timeout_wheel_t *wheel)
+{
+	unsigned int idx = wheel->tick & TIMEOUT_WHEEL_MASK;
+
+	for (unsigned int level = 1;
+	    (idx == 0) && (level < TIMEOUT_WHEEL_LEVELS); level++)
+		idx = timeout_wheel_cascade(wheel, level);
+
+	list_concat(&wheel->expired,
+	    &wheel->slot[0][wheel->tick & TIMEOUT_WHEEL_MASK]);
+	wheel->tick++;
+}
+
+/** Find out how far the earliest pending timeout is
+ *
+ * The result is exact for the timeouts in the first level of the wheel.
+ * For the upper levels, the tick in which the slot is to be cascaded is
+ * taken as a lower bound of the expiration.
+ *
+ * @param wheel Timing wheel (with the timeout lock held).
+ * @param max   Upper bound of the result.
+ *
+ * @return Number of ticks that can be processed by the wheel before the
+ *         earliest pending timeout needs attention.
+ *
+ */
+uint64_t timeout_wheel_next(timeout_wheel_t *wheel, uint64_t max)
+{
+	if (wheel->pending == 0)
+		return max;
+
+	for (uint64_t i = 0; (i < TIMEOUT_WHEEL_SLOTS) && (i < max); i++) {
+		if (!list_empty(&wheel->slot[0][(wheel->tick + i) &
+		    TIMEOUT_WHEEL_MASK]))
+			return i;
+	}
+
+	uint64_t next = max;
+
+	for (unsigned int level = 1; level < TIMEOUT_WHEEL_LEVELS; level++) {
+		unsigned int shift = TIMEOUT_WHEEL_BITS * level;
+		uint64_t first = (wheel->tick + ((uint64_t) 1 << shift) - 1) >>
+		    shift;
+
+		for (uint64_t n = first; n < first + TIMEOUT_WHEEL_SLOTS; n++) {
+			if (!list_empty(&wheel->slot[level][n & TIMEOUT_WHEEL_MASK])) {
+				uint64_t delta = (n << shift) - wheel->tick;
+				if (delta < next)
+					next = delta;
+				break;
+			}
+		}
+	}
+
+	return next;
+}
+
 /** Register timeout
  *
  * Insert timeout handler f (with argument arg)
- * to timeout list and make it execute in
+ * to the timing wheel and make it execute in
  * time microseconds (or slightly more).
  *
  * @param timeout Timeout structure.
@@ -103,56 +249,26 @@ void timeout_register(timeout_t *timeout, uint64_t time,
 	irq_spinlock_lock(&CPU->timeoutlock, true);
 	irq_spinlock_lock(&timeout->lock, false);
 
+	uint64_t start = get_cycle();
+
 	if (timeout->cpu)
 		panic("Unexpected: timeout->cpu != 0.");
 
+	timeout_wheel_t *wheel = &CPU->timeout_wheel;
+
 	timeout->cpu = CPU;
-	timeout->ticks = us2ticks(time);
+	timeout->deadline = wheel->tick + us2ticks(time);
 
 	timeout->handler = handler;
 	timeout->arg = arg;
 
-	/*
-	 * Insert timeout into the active timeouts list according to timeout->ticks.
-	 */
-	uint64_t sum = 0;
-	timeout_t *target = NULL;
-	link_t *cur, *prev;
-	prev = NULL;
-	for (cur = list_first(&CPU->timeout_active_list);
-	    cur != NULL; cur = list_next(cur, &CPU->timeout_active_list)) {
-		target = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&target->lock, false);
-
-		if (timeout->ticks < sum + target->ticks) {
-			irq_spinlock_unlock(&target->lock, false);
-			break;
-		}
-
-		sum += target->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-		prev = cur;
-	}
+	timeout_wheel_insert(wheel, timeout);
+	wheel->pending++;
+	wheel->registered++;
 
-	if (prev == NULL)
-		list_prepend(&timeout->link, &CPU->timeout_active_list);
-	else
-		list_insert_after(&timeout->link, prev);
-
-	/*
-	 * Adjust timeout->ticks according to ticks
-	 * accumulated in target's predecessors.
-	 */
-	timeout->ticks -= sum;
-
-	/*
-	 * Decrease ticks of timeout's immediate succesor by timeout->ticks.
-	 */
-	if (cur != NULL) {
-		irq_spinlock_lock(&target->lock, false);
-		target->ticks -= timeout->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-	}
+	uint64_t cycles = get_cycle() - start;
+	if (cycles > wheel->insert_max_cycles)
+		wheel->insert_max_cycles = cycles;
 
 	irq_spinlock_unlock(&timeout->lock, false);
 	irq_spinlock_unlock(&CPU->timeoutlock, true);
@@ -160,7 +276,7 @@ void timeout_register(timeout_t *timeout, uint64_t time,
 
 /** Unregister timeout
  *
- * Remove timeout from timeout list.
+ * Remove timeout from the timing wheel.
  *
  * @param timeout Timeout to unregister.
  *
@@ -186,19 +302,11 @@ grab_locks:
 
 	/*
 	 * Now we know for sure that timeout hasn't been activated yet
-	 * and is lurking in timeout->cpu->timeout_active_list.
+	 * and is lurking in one of the timeout->cpu->timeout_wheel lists.
 	 */
 
-	link_t *cur = list_next(&timeout->link,
-	    &timeout->cpu->timeout_active_list);
-	if (cur != NULL) {
-		timeout_t *tmp = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&tmp->lock, false);
-		tmp->ticks += timeout->ticks;
-		irq_spinlock_unlock(&tmp->lock, false);
-	}
-
 	list_remove(&timeout->link);
+	timeout->cpu->timeout_wheel.pending--;
 	irq_spinlock_unlock(&timeout->cpu->timeoutlock, false);
 
 	timeout_reinitialize(timeout);
@@ -207,5 +315,35 @@ grab_locks:
 	return true;
 }
 
+/** Print timing wheel statistics of all active processors */
+void timeout_print_stats(void)
+{
+	size_t cpu;
+	for (cpu = 0; cpu < config.cpu_count; cpu++) {
+		if (!cpus[cpu].active)
+			continue;
+
+		irq_spinlock_lock(&cpus[cpu].timeoutlock, true);
+
+		timeout_wheel_t *wheel = &cpus[cpu].timeout_wheel;
+		printf("cpu%u: tick=%" PRIu64 ", pending=%zu, "
+		    "registered=%" PRIu64 ", max insert=%" PRIu64 " cycles\n",
+		    cpus[cpu].id, wheel->tick, wheel->pending,
+		    wheel->registered, wheel->insert_max_cycles);
+
+		for (unsigned int level = 0; level < TIMEOUT_WHEEL_LEVELS;
+		    level++) {
+			unsigned long count = 0;
+			for (unsigned int i = 0; i < TIMEOUT_WHEEL_SLOTS; i++)
+				count += list_count(&wheel->slot[level][i]);
+
+			if (count > 0)
+				printf("\tlevel[%u]: %lu\n", level, count);
+		}
+
+		irq_spinlock_unlock(&cpus[cpu].timeoutlock, true);
+	}
+}
+
 /** @}
  */
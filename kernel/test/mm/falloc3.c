@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+#include <adt/bitmap.h>
+#include <arch/cycle.h>
+#include <typedefs.h>
+#include <stdlib.h>
+
+/*
+ * Measure latency of contiguous range allocation in a fragmented frame
+ * bitmap, both by linear scanning and with the summary tree used by the
+ * frame zones. Both searches must find the same range.
+ */
+
+#define ELEMENTS   (256 * 1024)
+#define TEST_RUNS  16
+
+static const size_t counts[] = { 1, 8, 64, 512 };
+
+/** Fragment the bitmap.
+ *
+ * Every other bit is set, leaving no run longer than one bit, except
+ * for a few larger holes near the end of the bitmap.
+ *
+ */
+static void fragment(bitmap_t *bitmap)
+{
+	bitmap_clear_range(bitmap, 0, ELEMENTS);
+
+	for (size_t i = 0; i < ELEMENTS; i += 2)
+		bitmap_set(bitmap, i, 1);
+
+	bitmap_clear_range(bitmap, ELEMENTS - 4096, 16);
+	bitmap_clear_range(bitmap, ELEMENTS - 2048, 128);
+	bitmap_clear_range(bitmap, ELEMENTS - 1024, 1000);
+}
+
+/** Measure average cycles needed to find a range. */
+static uint64_t measure(bitmap_t *bitmap, size_t count, size_t constraint,
+    size_t *index)
+{
+	uint64_t start = get_cycle();
+
+	for (unsigned int run = 0; run < TEST_RUNS; run++) {
+		bitmap->next_fit = 0;
+
+		if (!bitmap_allocate_range(bitmap, count, 0, 0, constraint,
+		    NULL)) {
+			*index = (size_t) -1;
+			return (get_cycle() - start) / TEST_RUNS;
+		}
+	}
+
+	uint64_t cycles = (get_cycle() - start) / TEST_RUNS;
+
+	/* Allocate the range for real to learn the index. */
+	bitmap->next_fit = 0;
+	if (!bitmap_allocate_range(bitmap, count, 0, 0, constraint, index))
+		*index = (size_t) -1;
+
+	return cycles;
+}
+
+const char *test_falloc3(void)
+{
+	const char *result = NULL;
+
+	void *linear_bits = malloc(bitmap_size(ELEMENTS));
+	void *summary_bits = malloc(bitmap_size(ELEMENTS));
+	void *summary = malloc(bitmap_summary_size(ELEMENTS));
+
+	if ((linear_bits == NULL) || (summary_bits == NULL) ||
+	    (summary == NULL)) {
+		result = "Unable to allocate bitmaps";
+		goto out;
+	}
+
+	bitmap_t linear;
+	bitmap_t tree;
+
+	bitmap_initialize(&linear, ELEMENTS, linear_bits);
+	bitmap_initialize(&tree, ELEMENTS, summary_bits);
+	bitmap_summary_initialize(&tree, summary);
+
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		for (size_t constraint = 0; constraint <= 63;
+		    constraint = constraint * 8 + 7) {
+			fragment(&linear);
+			fragment(&tree);
+
+			size_t linear_index;
+			size_t tree_index;
+
+			uint64_t linear_cycles = measure(&linear, counts[c],
+			    constraint, &linear_index);
+			uint64_t tree_cycles = measure(&tree, counts[c],
+			    constraint, &tree_index);
+
+			TPRINTF("Range of %zu (constraint %#zx): linear %"
+			    PRIu64 " cycles, summary %" PRIu64 " cycles\n",
+			    counts[c], constraint, linear_cycles, tree_cycles);
+
+			if (linear_index != tree_index) {
+				result = "Summary search found another range";
+				goto out;
+			}
+		}
+	}
+
+out:
+	free(summary);
+	free(summary_bits);
+	free(linear_bits);
+
+	return result;
+}
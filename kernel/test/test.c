@@ -44,6 +44,7 @@ test_t tests[] = {
 #include <fault/fault1.def>
 #include <mm/falloc1.def>
 #include <mm/falloc2.def>
+#include <mm/falloc3.def>
 #include <mm/mapping1.def>
 #include <mm/slab1.def>
 #include <mm/slab2.def>
@@ -38,13 +38,19 @@
 #include "hbench.h"
 
 benchmark_t *benchmarks[] = {
+	&benchmark_block_cache,
+	&benchmark_crc,
 	&benchmark_dir_read,
 	&benchmark_fibril_mutex,
+	&benchmark_file_append,
 	&benchmark_file_read,
 	&benchmark_malloc1,
+	&benchmark_malloc1_mt,
 	&benchmark_malloc2,
+	&benchmark_malloc2_mt,
 	&benchmark_ns_ping,
-	&benchmark_ping_pong
+	&benchmark_ping_pong,
+	&benchmark_ping_pong_ring
 };
 
 size_t benchmark_count = sizeof(benchmarks) / sizeof(benchmarks[0]);
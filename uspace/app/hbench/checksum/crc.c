@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <adt/checksum.h>
+#include <stdlib.h>
+#include <str.h>
+#include "../hbench.h"
+
+/*
+ * Checksum benchmark. Repeatedly computes the CRC of a buffer of the
+ * given size (parameter "size", in bytes) using the given polynomial
+ * (parameter "poly", either "crc32" or "crc32c").
+ */
+
+#define DEFAULT_SIZE "65536"
+#define DEFAULT_POLY "crc32"
+
+static uint8_t *buffer = NULL;
+static size_t buffer_size;
+
+static bool setup(bench_env_t *env, bench_run_t *run)
+{
+	int size = atoi(bench_env_param_get(env, "size", DEFAULT_SIZE));
+	buffer_size = (size > 0) ? (size_t) size : 1;
+
+	buffer = malloc(buffer_size);
+	if (buffer == NULL) {
+		return bench_run_fail(run, "failed to allocate %zu bytes",
+		    buffer_size);
+	}
+
+	for (size_t i = 0; i < buffer_size; i++)
+		buffer[i] = (uint8_t) (i * 31 + 7);
+
+	return true;
+}
+
+static bool teardown(bench_env_t *env, bench_run_t *run)
+{
+	free(buffer);
+	buffer = NULL;
+	return true;
+}
+
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t niter)
+{
+	const char *poly = bench_env_param_get(env, "poly", DEFAULT_POLY);
+	bool castagnoli;
+
+	if (str_cmp(poly, "crc32") == 0)
+		castagnoli = false;
+	else if (str_cmp(poly, "crc32c") == 0)
+		castagnoli = true;
+	else
+		return bench_run_fail(run, "unknown polynomial %s", poly);
+
+	volatile uint32_t crc = 0;
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < niter; i++) {
+		if (castagnoli)
+			crc = compute_crc32c_seed(buffer, buffer_size, crc);
+		else
+			crc = compute_crc32_seed(buffer, buffer_size, crc);
+	}
+	bench_run_stop(run);
+
+	return true;
+}
+
+benchmark_t benchmark_crc = {
+	.name = "crc",
+	.desc = "CRC32/CRC32C throughput over a buffer (size, poly)",
+	.entry = &runner,
+	.setup = &setup,
+	.teardown = &teardown
+};
+
+/** @}
+ */
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <block.h>
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <loc.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * Block cache benchmark. Several fibrils running in parallel on separate
+ * runner threads repeatedly get and put blocks from a small working set
+ * (parameter "blocks") of a block device (parameter "device"), so that the
+ * blocks stay cached and the benchmark measures how well block_get() and
+ * block_put() scale with the number of threads (parameter "threads").
+ */
+
+#define DEFAULT_DEVICE "bd/initrd"
+#define DEFAULT_BLOCKS "64"
+#define DEFAULT_THREADS "4"
+
+/** Number of runner threads spawned so far (they are never terminated). */
+static int runners_spawned = 0;
+
+static service_id_t service_id;
+static bool block_ready = false;
+
+typedef struct {
+	uint64_t niter;
+	aoff64_t blocks;
+	atomic_uint next_worker;
+	atomic_bool failed;
+	fibril_semaphore_t done;
+} shared_t;
+
+static errno_t worker(void *arg)
+{
+	shared_t *shared = arg;
+	unsigned id = atomic_fetch_add(&shared->next_worker, 1);
+
+	for (uint64_t i = 0; i < shared->niter; i++) {
+		block_t *block;
+
+		/* Let the workers start at different blocks. */
+		aoff64_t ba = (i + id * 7) % shared->blocks;
+
+		errno_t rc = block_get(&block, service_id, ba,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			atomic_store(&shared->failed, true);
+			break;
+		}
+
+		(void) block_put(block);
+	}
+
+	fibril_semaphore_up(&shared->done);
+	return EOK;
+}
+
+static int get_threads(bench_env_t *env)
+{
+	int threads = atoi(bench_env_param_get(env, "threads", DEFAULT_THREADS));
+	return (threads > 0) ? threads : 1;
+}
+
+static aoff64_t get_blocks(bench_env_t *env)
+{
+	int blocks = atoi(bench_env_param_get(env, "blocks", DEFAULT_BLOCKS));
+	return (blocks > 0) ? (aoff64_t) blocks : 1;
+}
+
+static bool setup(bench_env_t *env, bench_run_t *run)
+{
+	int threads = get_threads(env);
+	const char *device = bench_env_param_get(env, "device", DEFAULT_DEVICE);
+
+	/* The main thread is a runner too. */
+	if (runners_spawned < threads - 1) {
+		int n = threads - 1 - runners_spawned;
+		runners_spawned += fibril_test_spawn_runners(n);
+		if (runners_spawned < threads - 1) {
+			return bench_run_fail(run,
+			    "failed to spawn %d runner threads", threads);
+		}
+	}
+
+	errno_t rc = loc_service_get_id(device, &service_id, 0);
+	if (rc != EOK) {
+		return bench_run_fail(run, "failed to find device %s: %s",
+		    device, str_error(rc));
+	}
+
+	rc = block_init(service_id, 2048);
+	if (rc != EOK) {
+		return bench_run_fail(run, "failed to open device %s: %s",
+		    device, str_error(rc));
+	}
+
+	size_t bsize;
+	aoff64_t nblocks;
+	rc = block_get_bsize(service_id, &bsize);
+	if (rc == EOK)
+		rc = block_get_nblocks(service_id, &nblocks);
+	if (rc == EOK && nblocks <= get_blocks(env))
+		rc = EINVAL;
+	if (rc == EOK) {
+		rc = block_cache_init(service_id, bsize, get_blocks(env),
+		    CACHE_MODE_WT);
+	}
+
+	if (rc != EOK) {
+		block_fini(service_id);
+		return bench_run_fail(run, "failed to set up cache of %s: %s",
+		    device, str_error(rc));
+	}
+
+	block_ready = true;
+	return true;
+}
+
+static bool teardown(bench_env_t *env, bench_run_t *run)
+{
+	if (block_ready) {
+		block_fini(service_id);
+		block_ready = false;
+	}
+
+	return true;
+}
+
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t niter)
+{
+	int threads = get_threads(env);
+
+	shared_t shared;
+	shared.niter = niter / threads;
+	shared.blocks = get_blocks(env);
+	atomic_store(&shared.next_worker, 0);
+	atomic_store(&shared.failed, false);
+	fibril_semaphore_initialize(&shared.done, 0);
+
+	bench_run_start(run);
+
+	for (int i = 0; i < threads; i++) {
+		fid_t fid = fibril_create(worker, &shared);
+		if (fid == 0) {
+			for (int j = 0; j < i; j++)
+				fibril_semaphore_down(&shared.done);
+
+			return bench_run_fail(run, "failed to create worker fibril");
+		}
+
+		fibril_detach(fid);
+		fibril_start(fid);
+	}
+
+	for (int i = 0; i < threads; i++)
+		fibril_semaphore_down(&shared.done);
+
+	bench_run_stop(run);
+
+	if (atomic_load(&shared.failed)) {
+		return bench_run_fail(run,
+		    "failed to get a block in one of %d threads", threads);
+	}
+
+	return true;
+}
+
+benchmark_t benchmark_block_cache = {
+	.name = "block_cache",
+	.desc = "Block cache benchmark, repeatedly get and put cached blocks in several threads",
+	.entry = &runner,
+	.setup = &setup,
+	.teardown = &teardown
+};
+
+/** @}
+ */
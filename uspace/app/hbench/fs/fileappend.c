@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include <vfs/vfs.h>
+#include "../hbench.h"
+
+/*
+ * File append benchmark. Several files (parameter "files") in a directory
+ * (parameter "dirname") are grown in turns, one block-sized write at a time,
+ * until each of them has the given number of blocks (parameter "blocks").
+ * Each write is a separate file system operation, so the allocator sees the
+ * appends to different files interleaved. Unless it keeps reserving blocks
+ * ahead of each file across the operations, the files end up interleaved on
+ * the disk block by block, with about as many extents as blocks.
+ */
+
+#define DEFAULT_DIRNAME "/tmp"
+#define DEFAULT_FILES "4"
+#define DEFAULT_BLOCKS "256"
+
+#define BLOCK_SIZE 4096
+#define MAX_FILES 64
+
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *dirname = bench_env_param_get(env, "dirname",
+	    DEFAULT_DIRNAME);
+	int nfiles = atoi(bench_env_param_get(env, "files", DEFAULT_FILES));
+	int nblocks = atoi(bench_env_param_get(env, "blocks", DEFAULT_BLOCKS));
+
+	if (nfiles <= 0 || nfiles > MAX_FILES || nblocks <= 0) {
+		return bench_run_fail(run, "files must be 1 to %d and blocks "
+		    "must be positive", MAX_FILES);
+	}
+
+	char *buf = malloc(BLOCK_SIZE);
+	if (buf == NULL) {
+		return bench_run_fail(run, "failed to allocate %dB buffer",
+		    BLOCK_SIZE);
+	}
+	memset(buf, 'x', BLOCK_SIZE);
+
+	char *paths[MAX_FILES];
+	int fds[MAX_FILES];
+	int opened = 0;
+	bool ret = true;
+
+	for (int i = 0; i < nfiles; i++) {
+		if (asprintf(&paths[i], "%s/hbench_append%d", dirname, i) < 0) {
+			for (int j = 0; j < i; j++)
+				free(paths[j]);
+			free(buf);
+			return bench_run_fail(run, "out of memory");
+		}
+	}
+
+	bench_run_start(run);
+	for (uint64_t it = 0; it < size; it++) {
+		for (opened = 0; opened < nfiles; opened++) {
+			errno_t rc = vfs_lookup_open(paths[opened],
+			    WALK_REGULAR | WALK_MUST_CREATE, MODE_WRITE,
+			    &fds[opened]);
+			if (rc != EOK) {
+				bench_run_fail(run, "failed to create %s: %s",
+				    paths[opened], str_error(rc));
+				ret = false;
+				goto leave_close;
+			}
+		}
+
+		for (int b = 0; b < nblocks; b++) {
+			for (int i = 0; i < nfiles; i++) {
+				aoff64_t pos = (aoff64_t) b * BLOCK_SIZE;
+				size_t nwr;
+
+				errno_t rc = vfs_write(fds[i], &pos, buf,
+				    BLOCK_SIZE, &nwr);
+				if (rc != EOK) {
+					bench_run_fail(run, "failed to write "
+					    "to %s: %s", paths[i],
+					    str_error(rc));
+					ret = false;
+					goto leave_close;
+				}
+			}
+		}
+
+leave_close:
+		for (int i = 0; i < opened; i++) {
+			vfs_put(fds[i]);
+			vfs_unlink_path(paths[i]);
+		}
+
+		if (!ret)
+			break;
+	}
+	bench_run_stop(run);
+
+	for (int i = 0; i < nfiles; i++)
+		free(paths[i]);
+	free(buf);
+
+	return ret;
+}
+
+benchmark_t benchmark_file_append = {
+	.name = "file_append",
+	.desc = "Grow several files in turns by block-sized appends (use "
+	    "'dirname', 'files' and 'blocks' params to alter the defaults).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
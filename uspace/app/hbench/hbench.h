@@ -131,13 +131,19 @@ extern benchmark_t *benchmarks[];
 extern size_t benchmark_count;
 
 /* Put your benchmark descriptors here (and also to benchlist.c). */
+extern benchmark_t benchmark_block_cache;
+extern benchmark_t benchmark_crc;
 extern benchmark_t benchmark_dir_read;
 extern benchmark_t benchmark_fibril_mutex;
+extern benchmark_t benchmark_file_append;
 extern benchmark_t benchmark_file_read;
 extern benchmark_t benchmark_malloc1;
+extern benchmark_t benchmark_malloc1_mt;
 extern benchmark_t benchmark_malloc2;
+extern benchmark_t benchmark_malloc2_mt;
 extern benchmark_t benchmark_ns_ping;
 extern benchmark_t benchmark_ping_pong;
+extern benchmark_t benchmark_ping_pong_ring;
 
 #endif
 
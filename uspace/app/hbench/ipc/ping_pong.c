@@ -31,6 +31,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <ipc_test.h>
 #include <async.h>
 #include <errno.h>
@@ -38,6 +39,7 @@
 #include "../hbench.h"
 
 static ipc_test_t *test = NULL;
+static async_ring_t *ring = NULL;
 
 static bool setup(bench_env_t *env, bench_run_t *run)
 {
@@ -83,5 +85,77 @@ benchmark_t benchmark_ping_pong = {
 	.teardown = &teardown
 };
 
+static bool ring_setup(bench_env_t *env, bench_run_t *run)
+{
+	if (!setup(env, run))
+		return false;
+
+	errno_t rc = ipc_test_ring_create(test, &ring);
+	if (rc != EOK) {
+		return bench_run_fail(run, "failed setting up the ring: %s (%d)",
+		    str_error(rc), rc);
+	}
+
+	return true;
+}
+
+static bool ring_teardown(bench_env_t *env, bench_run_t *run)
+{
+	async_ring_destroy(ring);
+	ring = NULL;
+	return teardown(env, run);
+}
+
+static bool ring_runner(bench_env_t *env, bench_run_t *run, uint64_t niter)
+{
+	uint64_t batch = strtoull(bench_env_param_get(env, "batch", "1"),
+	    NULL, 10);
+
+	if (batch < 1 || batch > ASYNC_RING_ENTRIES) {
+		return bench_run_fail(run, "batch must be between 1 and %d",
+		    ASYNC_RING_ENTRIES);
+	}
+
+	bench_run_start(run);
+
+	uint64_t count = 0;
+	while (count < niter) {
+		uint64_t n = niter - count < batch ? niter - count : batch;
+		errno_t rc;
+
+		for (uint64_t i = 0; i < n; i++) {
+			rc = ipc_test_ring_ping_submit(ring);
+			if (rc != EOK) {
+				return bench_run_fail(run,
+				    "failed submitting ping: %s (%d)",
+				    str_error(rc), rc);
+			}
+		}
+
+		for (uint64_t i = 0; i < n; i++) {
+			rc = ipc_test_ring_ping_reap(ring);
+			if (rc != EOK) {
+				return bench_run_fail(run,
+				    "failed receiving pong: %s (%d)",
+				    str_error(rc), rc);
+			}
+		}
+
+		count += n;
+	}
+
+	bench_run_stop(run);
+
+	return true;
+}
+
+benchmark_t benchmark_ping_pong_ring = {
+	.name = "ping_pong_ring",
+	.desc = "IPC ping-pong over a shared-memory ring (param batch)",
+	.entry = &ring_runner,
+	.setup = &ring_setup,
+	.teardown = &ring_teardown
+};
+
 /** @}
  */
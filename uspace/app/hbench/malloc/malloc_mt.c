@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../hbench.h"
+
+/*
+ * Multi-threaded variants of the malloc1 and malloc2 benchmarks. The
+ * iterations are split among several fibrils that run in parallel on
+ * separate runner threads, so that the benchmarks show how well the
+ * allocator scales with the number of threads (parameter "threads").
+ */
+
+#define DEFAULT_THREADS "4"
+
+/** Number of runner threads spawned so far (they are never terminated). */
+static int runners_spawned = 0;
+
+typedef struct {
+	uint64_t niter;
+	bool many;
+	atomic_bool failed;
+	fibril_semaphore_t done;
+} shared_t;
+
+static void worker_alloc_one(shared_t *shared)
+{
+	for (uint64_t i = 0; i < shared->niter; i++) {
+		void *p = malloc(1);
+		if (p == NULL) {
+			atomic_store(&shared->failed, true);
+			return;
+		}
+		free(p);
+	}
+}
+
+static void worker_alloc_many(shared_t *shared)
+{
+	void **p = malloc(shared->niter * sizeof(void *));
+	if (p == NULL) {
+		atomic_store(&shared->failed, true);
+		return;
+	}
+
+	uint64_t count;
+	for (count = 0; count < shared->niter; count++) {
+		p[count] = malloc(1);
+		if (p[count] == NULL) {
+			atomic_store(&shared->failed, true);
+			break;
+		}
+	}
+
+	for (uint64_t j = 0; j < count; j++)
+		free(p[j]);
+
+	free(p);
+}
+
+static errno_t worker(void *arg)
+{
+	shared_t *shared = arg;
+
+	if (shared->many)
+		worker_alloc_many(shared);
+	else
+		worker_alloc_one(shared);
+
+	fibril_semaphore_up(&shared->done);
+	return EOK;
+}
+
+static int get_threads(bench_env_t *env)
+{
+	int threads = atoi(bench_env_param_get(env, "threads", DEFAULT_THREADS));
+	return (threads > 0) ? threads : 1;
+}
+
+static bool setup(bench_env_t *env, bench_run_t *run)
+{
+	int threads = get_threads(env);
+
+	/* The main thread is a runner too. */
+	if (runners_spawned < threads - 1) {
+		int n = threads - 1 - runners_spawned;
+		runners_spawned += fibril_test_spawn_runners(n);
+		if (runners_spawned < threads - 1) {
+			return bench_run_fail(run,
+			    "failed to spawn %d runner threads", threads);
+		}
+	}
+
+	return true;
+}
+
+static bool run_workers(bench_env_t *env, bench_run_t *run, uint64_t niter,
+    bool many)
+{
+	int threads = get_threads(env);
+
+	shared_t shared;
+	shared.niter = niter / threads;
+	shared.many = many;
+	atomic_store(&shared.failed, false);
+	fibril_semaphore_initialize(&shared.done, 0);
+
+	bench_run_start(run);
+
+	for (int i = 0; i < threads; i++) {
+		fid_t fid = fibril_create(worker, &shared);
+		if (fid == 0) {
+			for (int j = 0; j < i; j++)
+				fibril_semaphore_down(&shared.done);
+
+			return bench_run_fail(run, "failed to create worker fibril");
+		}
+
+		fibril_detach(fid);
+		fibril_start(fid);
+	}
+
+	for (int i = 0; i < threads; i++)
+		fibril_semaphore_down(&shared.done);
+
+	bench_run_stop(run);
+
+	if (atomic_load(&shared.failed)) {
+		return bench_run_fail(run,
+		    "failed to allocate 1B in one of %d threads", threads);
+	}
+
+	return true;
+}
+
+static bool runner_one(bench_env_t *env, bench_run_t *run, uint64_t niter)
+{
+	return run_workers(env, run, niter, false);
+}
+
+static bool runner_many(bench_env_t *env, bench_run_t *run, uint64_t niter)
+{
+	return run_workers(env, run, niter, true);
+}
+
+benchmark_t benchmark_malloc1_mt = {
+	.name = "malloc1_mt",
+	.desc = "User-space memory allocator benchmark, repeatedly allocate one block in several threads",
+	.entry = &runner_one,
+	.setup = &setup,
+	.teardown = NULL
+};
+
+benchmark_t benchmark_malloc2_mt = {
+	.name = "malloc2_mt",
+	.desc = "User-space memory allocator benchmark, allocate many small blocks in several threads",
+	.entry = &runner_many,
+	.setup = &setup,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -32,6 +32,7 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <macros.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -50,16 +51,18 @@
 
 /*
  * VIRTIO_BLK requests need at least two descriptors so that device-read-only
- * buffers are separated from device-writable buffers. For convenience, we
- * always use three descriptors for the request header, buffer and footer.
- * We therefore organize the virtque so that first RQ_BUFFERS descriptors are
- * used for request headers, the following RQ_BUFFERS descriptors are used
- * for in/out buffers and the last RQ_BUFFERS descriptors are used for request
- * footers.
+ * buffers are separated from device-writable buffers. Each request consists
+ * of a header descriptor, a chain of up to rq_segments in/out buffer
+ * descriptors and a footer descriptor. We therefore organize the virtque so
+ * that first RQ_BUFFERS descriptors are used for request headers, the
+ * following RQ_BUFFERS descriptors are used for request footers and the rest
+ * is divided into groups of rq_segments buffer descriptors, one group for
+ * each request.
  */
 #define REQ_HEADER_DESC(descno)	(0 * RQ_BUFFERS + (descno))
-#define REQ_BUFFER_DESC(descno)	(1 * RQ_BUFFERS + (descno))
-#define REQ_FOOTER_DESC(descno)	(2 * RQ_BUFFERS + (descno))
+#define REQ_FOOTER_DESC(descno)	(1 * RQ_BUFFERS + (descno))
+#define REQ_BUFFER_DESC(vblk, descno, seg) \
+	(2 * RQ_BUFFERS + (descno) * (vblk)->rq_segments + (seg))
 
 static errno_t virtio_blk_dev_add(ddf_dev_t *dev);
 
@@ -83,6 +86,7 @@ static void virtio_blk_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
 	while (virtio_virtq_consume_used(vdev, RQ_QUEUE, &descno, &len)) {
 		assert(descno < RQ_BUFFERS);
 		fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+		virtio_blk->completion_done[descno] = true;
 		fibril_condvar_signal(&virtio_blk->completion_cv[descno]);
 		fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
 	}
@@ -157,22 +161,25 @@ static errno_t virtio_blk_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
-static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
-    aoff64_t ba, void *buf)
+/** Allocate a request descriptor
+ *
+ * The allocated descno will determine the header descriptor
+ * (REQ_HEADER_DESC), the buffer descriptors (REQ_BUFFER_DESC) and the
+ * footer (REQ_FOOTER_DESC) descriptor.
+ *
+ * @param virtio_blk	Virtio block device
+ * @param wait		Wait for a descriptor to become available
+ *
+ * @return Request descriptor number or -1 if none is available
+ */
+static uint16_t virtio_blk_rq_alloc(virtio_blk_t *virtio_blk, bool wait)
 {
 	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
 
-	/*
-	 * Allocate a descriptor.
-	 *
-	 * The allocated descno will determine the header descriptor
-	 * (REQ_HEADER_DESC), the buffer descriptor (REQ_BUFFER_DESC) and the
-	 * footer (REQ_FOOTER_DESC) descriptor.
-	 */
 	fibril_mutex_lock(&virtio_blk->free_lock);
 	uint16_t descno = virtio_alloc_desc(vdev, RQ_QUEUE,
 	    &virtio_blk->rq_free_head);
-	while (descno == (uint16_t) -1U) {
+	while (wait && descno == (uint16_t) -1U) {
 		fibril_condvar_wait(&virtio_blk->free_cv,
 		    &virtio_blk->free_lock);
 		descno = virtio_alloc_desc(vdev, RQ_QUEUE,
@@ -180,7 +187,119 @@ static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
 	}
 	fibril_mutex_unlock(&virtio_blk->free_lock);
 
-	assert(descno < RQ_BUFFERS);
+	assert(descno == (uint16_t) -1U || descno < RQ_BUFFERS);
+	return descno;
+}
+
+/** Free a request descriptor */
+static void virtio_blk_rq_free(virtio_blk_t *virtio_blk, uint16_t descno)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+
+	fibril_mutex_lock(&virtio_blk->free_lock);
+	virtio_free_desc(vdev, RQ_QUEUE, &virtio_blk->rq_free_head, descno);
+	fibril_condvar_signal(&virtio_blk->free_cv);
+	fibril_mutex_unlock(&virtio_blk->free_lock);
+}
+
+/** Set up buffer descriptors pointing directly to the caller's buffer
+ *
+ * Physically contiguous pages of the buffer are merged into a single
+ * descriptor. The mapped part of the buffer is limited by the number of
+ * buffer descriptors available to the request and by RQ_MAX_SIZE.
+ *
+ * @param virtio_blk	Virtio block device
+ * @param descno	Request descriptor number
+ * @param read		Device writes to the buffer
+ * @param buf		Caller's buffer
+ * @param size		Size of the buffer, multiple of the block size
+ *
+ * @return Number of bytes mapped, multiple of the block size, or zero
+ *         if the buffer cannot be used for DMA directly
+ */
+static size_t virtio_blk_rq_map(virtio_blk_t *virtio_blk, uint16_t descno,
+    bool read, void *buf, size_t size)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+	uintptr_t seg_p[RQ_SEGMENTS];
+	size_t seg_size[RQ_SEGMENTS];
+	unsigned segs = 0;
+	size_t mapped = 0;
+
+	while (mapped < size && mapped < RQ_MAX_SIZE) {
+		void *virt = buf + mapped;
+		size_t chunk = min(size - mapped,
+		    PAGE_SIZE - ((uintptr_t) virt % PAGE_SIZE));
+		chunk = min(chunk, RQ_MAX_SIZE - mapped);
+
+		/* Make sure the page is backed by a frame. */
+		(void) *((volatile uint8_t *) virt);
+
+		uintptr_t phys;
+		if (as_get_physical_mapping(virt, &phys) != EOK)
+			break;
+
+		if (segs > 0 && seg_p[segs - 1] + seg_size[segs - 1] == phys) {
+			seg_size[segs - 1] += chunk;
+		} else {
+			if (segs == virtio_blk->rq_segments)
+				break;
+			seg_p[segs] = phys;
+			seg_size[segs] = chunk;
+			segs++;
+		}
+
+		mapped += chunk;
+	}
+
+	/* The device transfers whole blocks only. */
+	size_t excess = mapped % VIRTIO_BLK_BLOCK_SIZE;
+	mapped -= excess;
+	while (excess > 0) {
+		if (seg_size[segs - 1] > excess) {
+			seg_size[segs - 1] -= excess;
+			excess = 0;
+		} else {
+			excess -= seg_size[segs - 1];
+			segs--;
+		}
+	}
+
+	if (mapped == 0)
+		return 0;
+
+	for (unsigned i = 0; i < segs; i++) {
+		virtio_virtq_desc_set(vdev, RQ_QUEUE,
+		    REQ_BUFFER_DESC(virtio_blk, descno, i), seg_p[i],
+		    seg_size[i], VIRTQ_DESC_F_NEXT |
+		    (read ? VIRTQ_DESC_F_WRITE : 0), (i + 1 < segs) ?
+		    REQ_BUFFER_DESC(virtio_blk, descno, i + 1) :
+		    REQ_FOOTER_DESC(descno));
+	}
+
+	return mapped;
+}
+
+/** Submit a request to the device
+ *
+ * The request transfers the largest possible prefix of the buffer. The
+ * data is transferred directly to or from the buffer if possible,
+ * otherwise the request bounce buffer is used.
+ *
+ * @param virtio_blk	Virtio block device
+ * @param descno	Request descriptor number
+ * @param read		Read from the device
+ * @param ba		Address of the first block
+ * @param buf		Buffer
+ * @param size		Size of the buffer, multiple of the block size
+ * @param bounce	Set to true if the bounce buffer is used
+ *
+ * @return Number of bytes transferred by the request
+ */
+static size_t virtio_blk_rq_submit(virtio_blk_t *virtio_blk, uint16_t descno,
+    bool read, aoff64_t ba, void *buf, size_t size, bool *bounce)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
 
 	/* Setup the request header */
 	virtio_blk_req_header_t *req_header =
@@ -190,33 +309,60 @@ static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
 	    read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT);
 	pio_write_le64(&req_header->sector, ba);
 
-	/* Copy write data to the request. */
-	if (!read)
-		memcpy(virtio_blk->rq_buf[descno], buf, VIRTIO_BLK_BLOCK_SIZE);
+	size_t xfer = virtio_blk_rq_map(virtio_blk, descno, read, buf, size);
+	*bounce = (xfer == 0);
+	if (*bounce) {
+		xfer = min(size, RQ_BOUNCE_SIZE);
+
+		/* Copy write data to the request. */
+		if (!read)
+			memcpy(virtio_blk->rq_buf[descno], buf, xfer);
+
+		virtio_virtq_desc_set(vdev, RQ_QUEUE,
+		    REQ_BUFFER_DESC(virtio_blk, descno, 0),
+		    virtio_blk->rq_buf_p[descno], xfer,
+		    VIRTQ_DESC_F_NEXT | (read ? VIRTQ_DESC_F_WRITE : 0),
+		    REQ_FOOTER_DESC(descno));
+	}
 
 	fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+	virtio_blk->completion_done[descno] = false;
+	fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
 
 	/*
-	 * Set the descriptors, chain them in the virtqueue and notify the
-	 * device.
+	 * Set the remaining descriptors, chain them in the virtqueue and
+	 * notify the device.
 	 */
 	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_HEADER_DESC(descno),
 	    virtio_blk->rq_header_p[descno], sizeof(virtio_blk_req_header_t),
-	    VIRTQ_DESC_F_NEXT, REQ_BUFFER_DESC(descno));
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_BUFFER_DESC(descno),
-	    virtio_blk->rq_buf_p[descno], VIRTIO_BLK_BLOCK_SIZE,
-	    VIRTQ_DESC_F_NEXT | (read ? VIRTQ_DESC_F_WRITE : 0),
-	    REQ_FOOTER_DESC(descno));
+	    VIRTQ_DESC_F_NEXT, REQ_BUFFER_DESC(virtio_blk, descno, 0));
 	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_FOOTER_DESC(descno),
 	    virtio_blk->rq_footer_p[descno], sizeof(virtio_blk_req_footer_t),
 	    VIRTQ_DESC_F_WRITE, 0);
 	virtio_virtq_produce_available(vdev, RQ_QUEUE, descno);
 
-	/*
-	 * Wait for the completion of the request.
-	 */
-	fibril_condvar_wait(&virtio_blk->completion_cv[descno],
-	    &virtio_blk->completion_lock[descno]);
+	return xfer;
+}
+
+/** Wait for the completion of a request and free its descriptor
+ *
+ * @param virtio_blk	Virtio block device
+ * @param descno	Request descriptor number
+ * @param read		The request was a read
+ * @param buf		Buffer of the request
+ * @param size		Number of bytes transferred by the request
+ * @param bounce	The request used the bounce buffer
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t virtio_blk_rq_complete(virtio_blk_t *virtio_blk,
+    uint16_t descno, bool read, void *buf, size_t size, bool bounce)
+{
+	fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+	while (!virtio_blk->completion_done[descno]) {
+		fibril_condvar_wait(&virtio_blk->completion_cv[descno],
+		    &virtio_blk->completion_lock[descno]);
+	}
 	fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
 
 	errno_t rc;
@@ -240,36 +386,72 @@ static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
 	}
 
 	/* Copy read data from the request */
-	if (rc == EOK && read)
-		memcpy(buf, virtio_blk->rq_buf[descno], VIRTIO_BLK_BLOCK_SIZE);
-
-	/* Free the descriptor and buffer */
-	fibril_mutex_lock(&virtio_blk->free_lock);
-	virtio_free_desc(vdev, RQ_QUEUE, &virtio_blk->rq_free_head, descno);
-	fibril_condvar_signal(&virtio_blk->free_cv);
-	fibril_mutex_unlock(&virtio_blk->free_lock);
+	if (rc == EOK && read && bounce)
+		memcpy(buf, virtio_blk->rq_buf[descno], size);
 
+	virtio_blk_rq_free(virtio_blk, descno);
 	return rc;
 }
 
+/** Request in flight, as tracked by virtio_blk_bd_rw_blocks() */
+typedef struct {
+	uint16_t descno;
+	void *buf;
+	size_t size;
+	bool bounce;
+} virtio_blk_inflight_t;
+
 static errno_t virtio_blk_bd_rw_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
     void *buf, size_t size, bool read)
 {
 	virtio_blk_t *virtio_blk = (virtio_blk_t *) bd->srvs->sarg;
-	aoff64_t i;
-	errno_t rc;
+	virtio_blk_inflight_t inflight[RQ_BUFFERS];
+	unsigned first = 0;
+	unsigned pending = 0;
+	size_t done = 0;
+	errno_t rc = EOK;
 
 	if (size != cnt * VIRTIO_BLK_BLOCK_SIZE)
 		return EINVAL;
 
-	for (i = 0; i < cnt; i++) {
-		rc = virtio_blk_rw_block(virtio_blk, read, ba + i,
-		    buf + i * VIRTIO_BLK_BLOCK_SIZE);
-		if (rc != EOK)
-			return rc;
+	/*
+	 * Split the transfer into requests and keep as many of them in
+	 * flight as there are request descriptors.
+	 */
+	while (done < size || pending > 0) {
+		uint16_t descno = (uint16_t) -1U;
+		if (done < size && rc == EOK)
+			descno = virtio_blk_rq_alloc(virtio_blk, pending == 0);
+
+		if (descno == (uint16_t) -1U) {
+			/* Retire the oldest request to make progress. */
+			virtio_blk_inflight_t *rq = &inflight[first];
+			errno_t rrc = virtio_blk_rq_complete(virtio_blk,
+			    rq->descno, read, rq->buf, rq->size, rq->bounce);
+			if (rc == EOK)
+				rc = rrc;
+
+			first = (first + 1) % RQ_BUFFERS;
+			pending--;
+
+			if (rc != EOK && pending == 0)
+				break;
+			continue;
+		}
+
+		virtio_blk_inflight_t *rq =
+		    &inflight[(first + pending) % RQ_BUFFERS];
+		rq->descno = descno;
+		rq->buf = buf + done;
+		rq->size = virtio_blk_rq_submit(virtio_blk, descno, read,
+		    ba + done / VIRTIO_BLK_BLOCK_SIZE, rq->buf, size - done,
+		    &rq->bounce);
+		pending++;
+
+		done += rq->size;
 	}
 
-	return EOK;
+	return rc;
 }
 
 static errno_t virtio_blk_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
@@ -341,7 +523,7 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 		goto fail;
 
 	/* Reset the device and negotiate the feature bits */
-	rc = virtio_device_setup_start(vdev, 0);
+	rc = virtio_device_setup_start(vdev, 0, 0);
 	if (rc != EOK)
 		goto fail;
 
@@ -358,14 +540,29 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 		goto fail;
 	}
 
+	/*
+	 * Give each request as many buffer descriptors as the virtqueue
+	 * allows, up to RQ_SEGMENTS.
+	 */
+	pio_write_le16(&cfg->queue_select, RQ_QUEUE);
+	uint16_t queue_size = pio_read_le16(&cfg->queue_size);
+	if (queue_size < 3 * RQ_BUFFERS) {
+		ddf_msg(LVL_NOTE, "Virtqueue too small: %u", queue_size);
+		rc = ELIMIT;
+		goto fail;
+	}
+	virtio_blk->rq_segments = min(RQ_SEGMENTS,
+	    queue_size / RQ_BUFFERS - 2);
+
 	vdev->queues = calloc(sizeof(virtq_t), num_queues);
 	if (!vdev->queues) {
 		rc = ENOMEM;
 		goto fail;
 	}
 
-	/* For each in/out request we need 3 descriptors */
-	rc = virtio_virtq_setup(vdev, RQ_QUEUE, 3 * RQ_BUFFERS);
+	/* Each request needs a header, a footer and the buffer descriptors */
+	rc = virtio_virtq_setup(vdev, RQ_QUEUE,
+	    (2 + virtio_blk->rq_segments) * RQ_BUFFERS);
 	if (rc != EOK)
 		goto fail;
 
@@ -376,7 +573,7 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 	    true, virtio_blk->rq_header, virtio_blk->rq_header_p);
 	if (rc != EOK)
 		goto fail;
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, VIRTIO_BLK_BLOCK_SIZE,
+	rc = virtio_setup_dma_bufs(RQ_BUFFERS, RQ_BOUNCE_SIZE,
 	    true, virtio_blk->rq_buf, virtio_blk->rq_buf_p);
 	if (rc != EOK)
 		goto fail;
@@ -30,6 +30,7 @@
 #define _VIRTIO_BLK_H_
 
 #include <virtio-pci.h>
+#include <as.h>
 #include <bd_srv.h>
 #include <abi/cap.h>
 
@@ -48,6 +49,15 @@
 
 #define RQ_BUFFERS	32
 
+/** Maximum number of buffer descriptors in one request. */
+#define RQ_SEGMENTS	6
+
+/** Size of the per-request bounce buffer. */
+#define RQ_BOUNCE_SIZE	PAGE_SIZE
+
+/** Maximum number of bytes transferred by one request. */
+#define RQ_MAX_SIZE	(256 * 1024)
+
 /** Device is read-only. */
 #define VIRTIO_BLK_F_RO		(1U << 5)
 
@@ -79,6 +89,9 @@ typedef struct {
 
 	uint16_t rq_free_head;
 
+	/** Number of buffer descriptors available to each request */
+	unsigned rq_segments;
+
 	int irq;
 	cap_irq_handle_t irq_handle;
 
@@ -89,6 +102,7 @@ typedef struct {
 
 	fibril_mutex_t completion_lock[RQ_BUFFERS];
 	fibril_condvar_t completion_cv[RQ_BUFFERS];
+	bool completion_done[RQ_BUFFERS];
 } virtio_blk_t;
 
 #endif
@@ -32,6 +32,9 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <fibril.h>
+#include <macros.h>
+#include <str_error.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
@@ -45,17 +48,26 @@
 
 #define NAME	"virtio-net"
 
-#define VIRTIO_NET_NUM_QUEUES	3
-
-#define RX_QUEUE_1	0
-#define TX_QUEUE_1	1
-#define CT_QUEUE_1	2
+#define RX_QUEUE(pair)	(2 * (pair))
+#define TX_QUEUE(pair)	(2 * (pair) + 1)
 
 #define BUFFER_SIZE	2048
 #define RX_BUF_SIZE	BUFFER_SIZE
 #define TX_BUF_SIZE	BUFFER_SIZE
 #define CT_BUF_SIZE	BUFFER_SIZE
 
+/* Frame fields used to select the TX queue pair */
+#define ETH_HDR_SIZE	14
+#define ETYPE_IPV4	0x0800
+#define ETYPE_IPV6	0x86dd
+#define IP_PROTO_TCP	6
+#define IP_PROTO_UDP	17
+
+/** Number of polls while waiting for a control command to complete */
+#define CT_POLLS	1000
+/** Delay between two polls of the control queue (microseconds) */
+#define CT_POLL_DELAY	1000
+
 static ddf_dev_ops_t virtio_net_dev_ops;
 
 static errno_t virtio_net_dev_add(ddf_dev_t *dev);
@@ -69,45 +81,111 @@ static driver_t virtio_net_driver = {
 	.driver_ops = &virtio_net_driver_ops
 };
 
-static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+/** Receive frames from the RX queue of a queue pair
+ *
+ * The received frames are appended to @a frames and the RX buffers are
+ * given back to the device with a single notification.
+ *
+ * @param nic		NIC
+ * @param pairno	Queue pair
+ * @param frames	List of received frames, allocated on first use
+ */
+static void virtio_net_rx(nic_t *nic, unsigned pairno,
+    nic_frame_list_t **frames)
 {
-	nic_t *nic = ddf_dev_data_get(dev);
 	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_net_pair_t *pair = &virtio_net->pair[pairno];
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	bool recycled = false;
 
 	uint16_t descno;
 	uint32_t len;
-	while (virtio_virtq_consume_used(vdev, RX_QUEUE_1, &descno, &len)) {
-		virtio_net_hdr_t *hdr =
-		    (virtio_net_hdr_t *) virtio_net->rx_buf[descno];
-		if (len <= sizeof(*hdr)) {
-			ddf_msg(LVL_WARN,
-			    "RX data length too short, packet dropped");
-			virtio_virtq_produce_available(vdev, RX_QUEUE_1,
-			    descno);
-			continue;
+	while (true) {
+		unsigned count = 0;
+
+		while (virtio_virtq_consume_used(vdev, RX_QUEUE(pairno),
+		    &descno, &len)) {
+			count++;
+
+			virtio_net_hdr_t *hdr =
+			    (virtio_net_hdr_t *) pair->rx_buf[descno];
+			if (len <= sizeof(*hdr)) {
+				ddf_msg(LVL_WARN,
+				    "RX data length too short, packet dropped");
+				virtio_virtq_produce_available_deferred(vdev,
+				    RX_QUEUE(pairno), descno);
+				continue;
+			}
+
+			nic_frame_t *frame = nic_alloc_frame(nic,
+			    len - sizeof(*hdr));
+			if (frame) {
+				memcpy(frame->data, &hdr[1],
+				    len - sizeof(*hdr));
+
+				if (*frames == NULL)
+					*frames = nic_alloc_frame_list();
+				if (*frames != NULL)
+					nic_frame_list_append(*frames, frame);
+				else
+					nic_received_frame(nic, frame);
+			} else {
+				ddf_msg(LVL_WARN,
+				    "Cannot allocate RX frame, packet dropped");
+			}
+
+			virtio_virtq_produce_available_deferred(vdev,
+			    RX_QUEUE(pairno), descno);
 		}
 
-		nic_frame_t *frame = nic_alloc_frame(nic, len - sizeof(*hdr));
-		if (frame) {
-			memcpy(frame->data, &hdr[1], len - sizeof(*hdr));
-			nic_received_frame(nic, frame);
-		} else {
-			ddf_msg(LVL_WARN,
-			    "Cannot allocate RX frame, packet dropped");
-		}
+		if (count == 0)
+			break;
 
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, descno);
+		/*
+		 * Re-arm the interrupt and look again so that no frame
+		 * arriving in the meantime is left behind.
+		 */
+		recycled = true;
+		virtio_virtq_request_interrupt(vdev, RX_QUEUE(pairno), 1);
 	}
 
-	while (virtio_virtq_consume_used(vdev, TX_QUEUE_1, &descno, &len)) {
-		virtio_free_desc(vdev, TX_QUEUE_1, &virtio_net->tx_free_head,
+	if (recycled)
+		virtio_virtq_notify(vdev, RX_QUEUE(pairno));
+}
+
+/** Reclaim the TX buffers the device is done with
+ *
+ * @param virtio_net	Virtio network device
+ * @param pairno	Queue pair
+ */
+static void virtio_net_tx_reclaim(virtio_net_t *virtio_net, unsigned pairno)
+{
+	virtio_net_pair_t *pair = &virtio_net->pair[pairno];
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	uint16_t descno;
+	uint32_t len;
+	while (virtio_virtq_consume_used(vdev, TX_QUEUE(pairno), &descno,
+	    &len)) {
+		virtio_free_desc(vdev, TX_QUEUE(pairno), &pair->tx_free_head,
 		    descno);
 	}
-	while (virtio_virtq_consume_used(vdev, CT_QUEUE_1, &descno, &len)) {
-		virtio_free_desc(vdev, CT_QUEUE_1, &virtio_net->ct_free_head,
-		    descno);
+}
+
+static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	nic_t *nic = ddf_dev_data_get(dev);
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	nic_frame_list_t *frames = NULL;
+
+	for (unsigned i = 0; i < virtio_net->pairs_setup; i++) {
+		virtio_net_rx(nic, i, &frames);
+		virtio_net_tx_reclaim(virtio_net, i);
 	}
+
+	/* Deliver all frames received by this interrupt at once. */
+	if (frames != NULL)
+		nic_received_frame_list(nic, frames);
 }
 
 static errno_t virtio_net_register_interrupt(ddf_dev_t *dev)
@@ -166,6 +244,134 @@ static errno_t virtio_net_register_interrupt(ddf_dev_t *dev)
 	    virtio_net_irq_handler, &irq_code, &virtio_net->irq_handle);
 }
 
+/** Set the number of RX/TX queue pairs used by the device
+ *
+ * Must be called after the device went live. The control queue is polled
+ * for the completion of the command.
+ *
+ * @param virtio_net	Virtio network device
+ * @param pairs		Number of queue pairs
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t virtio_net_ctrl_mq(virtio_net_t *virtio_net, uint16_t pairs)
+{
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t ctq = virtio_net->ct_queue;
+
+	uint16_t cmd = virtio_alloc_desc(vdev, ctq, &virtio_net->ct_free_head);
+	uint16_t ack = virtio_alloc_desc(vdev, ctq, &virtio_net->ct_free_head);
+	if (cmd == (uint16_t) -1U || ack == (uint16_t) -1U) {
+		if (cmd != (uint16_t) -1U)
+			virtio_free_desc(vdev, ctq, &virtio_net->ct_free_head,
+			    cmd);
+		return ENOMEM;
+	}
+
+	virtio_net_ctrl_hdr_t *hdr = virtio_net->ct_buf[cmd];
+	virtio_net_ctrl_mq_t *mq = (virtio_net_ctrl_mq_t *) &hdr[1];
+	uint8_t *status = virtio_net->ct_buf[ack];
+
+	hdr->class = VIRTIO_NET_CTRL_MQ;
+	hdr->command = VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET;
+	pio_write_le16(&mq->virtqueue_pairs, pairs);
+	pio_write_8(status, VIRTIO_NET_ERR);
+
+	virtio_virtq_desc_set(vdev, ctq, cmd, virtio_net->ct_buf_p[cmd],
+	    sizeof(*hdr) + sizeof(*mq), VIRTQ_DESC_F_NEXT, ack);
+	virtio_virtq_desc_set(vdev, ctq, ack, virtio_net->ct_buf_p[ack],
+	    sizeof(*status), VIRTQ_DESC_F_WRITE, 0);
+	virtio_virtq_produce_available(vdev, ctq, cmd);
+
+	uint16_t descno;
+	uint32_t len;
+	unsigned polls = 0;
+	while (!virtio_virtq_consume_used(vdev, ctq, &descno, &len)) {
+		/* The descriptors stay with the device on timeout. */
+		if (++polls == CT_POLLS)
+			return ETIMEOUT;
+		fibril_usleep(CT_POLL_DELAY);
+	}
+
+	errno_t rc = (pio_read_8(status) == VIRTIO_NET_OK) ? EOK : EIO;
+
+	virtio_free_desc(vdev, ctq, &virtio_net->ct_free_head, ack);
+	virtio_free_desc(vdev, ctq, &virtio_net->ct_free_head, cmd);
+
+	return rc;
+}
+
+/** Set up the RX/TX queues and buffers of a queue pair
+ *
+ * @param virtio_net	Virtio network device
+ * @param pairno	Queue pair
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t virtio_net_pair_setup(virtio_net_t *virtio_net, unsigned pairno)
+{
+	virtio_net_pair_t *pair = &virtio_net->pair[pairno];
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	errno_t rc = virtio_virtq_setup(vdev, RX_QUEUE(pairno), RX_BUFFERS);
+	if (rc != EOK)
+		return rc;
+	rc = virtio_virtq_setup(vdev, TX_QUEUE(pairno), TX_BUFFERS);
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * Setup DMA buffers
+	 */
+	rc = virtio_setup_dma_bufs(RX_BUFFERS, RX_BUF_SIZE, false,
+	    pair->rx_buf, pair->rx_buf_p);
+	if (rc != EOK)
+		return rc;
+	rc = virtio_setup_dma_bufs(TX_BUFFERS, TX_BUF_SIZE, true,
+	    pair->tx_buf, pair->tx_buf_p);
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * Give all RX buffers to the NIC
+	 */
+	for (unsigned i = 0; i < RX_BUFFERS; i++) {
+		/*
+		 * Associtate the buffer with the descriptor, set length and
+		 * flags.
+		 */
+		virtio_virtq_desc_set(vdev, RX_QUEUE(pairno), i,
+		    pair->rx_buf_p[i], RX_BUF_SIZE, VIRTQ_DESC_F_WRITE, 0);
+		/*
+		 * Put the set descriptor into the available ring of the RX
+		 * queue.
+		 */
+		virtio_virtq_produce_available_deferred(vdev, RX_QUEUE(pairno),
+		    i);
+	}
+
+	/* Interrupt on each received frame, never on sent frames. */
+	virtio_virtq_request_interrupt(vdev, RX_QUEUE(pairno), 1);
+	virtio_virtq_suppress_interrupt(vdev, TX_QUEUE(pairno));
+
+	/*
+	 * Put all TX buffers on a free list
+	 */
+	virtio_create_desc_free_list(vdev, TX_QUEUE(pairno), TX_BUFFERS,
+	    &pair->tx_free_head);
+
+	return EOK;
+}
+
+static void virtio_net_teardown_bufs(virtio_net_t *virtio_net)
+{
+	for (unsigned i = 0; i < VIRTIO_NET_MAX_PAIRS; i++) {
+		virtio_teardown_dma_bufs(virtio_net->pair[i].rx_buf);
+		virtio_teardown_dma_bufs(virtio_net->pair[i].tx_buf);
+	}
+	virtio_teardown_dma_bufs(virtio_net->ct_buf);
+}
+
 static errno_t virtio_net_initialize(ddf_dev_t *dev)
 {
 	nic_t *nic = nic_create_and_bind(dev);
@@ -197,7 +403,8 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	/* Reset the device and negotiate the feature bits */
 	rc = virtio_device_setup_start(vdev,
-	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ);
+	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ,
+	    VIRTIO_NET_F_MQ | VIRTIO_F_RING_EVENT_IDX);
 	if (rc != EOK)
 		goto fail;
 
@@ -206,8 +413,12 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 	/*
 	 * Discover and configure the virtqueues
 	 */
+	unsigned max_pairs = 1;
+	if (vdev->features & VIRTIO_NET_F_MQ)
+		max_pairs = pio_read_le16(&netcfg->max_virtqueue_pairs);
+
 	uint16_t num_queues = pio_read_le16(&cfg->num_queues);
-	if (num_queues != VIRTIO_NET_NUM_QUEUES) {
+	if (max_pairs == 0 || num_queues != 2 * max_pairs + 1) {
 		ddf_msg(LVL_NOTE, "Unsupported number of virtqueues: %u",
 		    num_queues);
 		rc = ELIMIT;
@@ -220,25 +431,17 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 		goto fail;
 	}
 
-	rc = virtio_virtq_setup(vdev, RX_QUEUE_1, RX_BUFFERS);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_virtq_setup(vdev, TX_QUEUE_1, TX_BUFFERS);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_virtq_setup(vdev, CT_QUEUE_1, CT_BUFFERS);
-	if (rc != EOK)
-		goto fail;
+	virtio_net->ct_queue = 2 * max_pairs;
+	virtio_net->pairs_setup = min(max_pairs, VIRTIO_NET_MAX_PAIRS);
+	virtio_net->pairs = 1;
 
-	/*
-	 * Setup DMA buffers
-	 */
-	rc = virtio_setup_dma_bufs(RX_BUFFERS, RX_BUF_SIZE, false,
-	    virtio_net->rx_buf, virtio_net->rx_buf_p);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_setup_dma_bufs(TX_BUFFERS, TX_BUF_SIZE, true,
-	    virtio_net->tx_buf, virtio_net->tx_buf_p);
+	for (unsigned i = 0; i < virtio_net->pairs_setup; i++) {
+		rc = virtio_net_pair_setup(virtio_net, i);
+		if (rc != EOK)
+			goto fail;
+	}
+
+	rc = virtio_virtq_setup(vdev, virtio_net->ct_queue, CT_BUFFERS);
 	if (rc != EOK)
 		goto fail;
 	rc = virtio_setup_dma_bufs(CT_BUFFERS, CT_BUF_SIZE, true,
@@ -247,29 +450,9 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 		goto fail;
 
 	/*
-	 * Give all RX buffers to the NIC
-	 */
-	for (unsigned i = 0; i < RX_BUFFERS; i++) {
-		/*
-		 * Associtate the buffer with the descriptor, set length and
-		 * flags.
-		 */
-		virtio_virtq_desc_set(vdev, RX_QUEUE_1, i,
-		    virtio_net->rx_buf_p[i], RX_BUF_SIZE, VIRTQ_DESC_F_WRITE,
-		    0);
-		/*
-		 * Put the set descriptor into the available ring of the RX
-		 * queue.
-		 */
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, i);
-	}
-
-	/*
-	 * Put all TX and CT buffers on a free list
+	 * Put all CT buffers on a free list
 	 */
-	virtio_create_desc_free_list(vdev, TX_QUEUE_1, TX_BUFFERS,
-	    &virtio_net->tx_free_head);
-	virtio_create_desc_free_list(vdev, CT_QUEUE_1, CT_BUFFERS,
+	virtio_create_desc_free_list(vdev, virtio_net->ct_queue, CT_BUFFERS,
 	    &virtio_net->ct_free_head);
 
 	/*
@@ -299,12 +482,30 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 	/* Go live */
 	virtio_device_setup_finalize(vdev);
 
+	/* Kick the RX queues now that the device is live */
+	for (unsigned i = 0; i < virtio_net->pairs_setup; i++)
+		virtio_virtq_notify(vdev, RX_QUEUE(i));
+
+	/*
+	 * Spread the traffic over all queue pairs. The device keeps using
+	 * the first pair only if this fails.
+	 */
+	if (virtio_net->pairs_setup > 1) {
+		rc = virtio_net_ctrl_mq(virtio_net, virtio_net->pairs_setup);
+		if (rc == EOK) {
+			virtio_net->pairs = virtio_net->pairs_setup;
+		} else {
+			ddf_msg(LVL_NOTE, "Failed to enable multiqueue: %s",
+			    str_error(rc));
+		}
+	}
+
+	ddf_msg(LVL_NOTE, "Using %u queue pair(s)", virtio_net->pairs);
+
 	return EOK;
 
 fail:
-	virtio_teardown_dma_bufs(virtio_net->rx_buf);
-	virtio_teardown_dma_bufs(virtio_net->tx_buf);
-	virtio_teardown_dma_bufs(virtio_net->ct_buf);
+	virtio_net_teardown_bufs(virtio_net);
 
 	virtio_device_setup_fail(vdev);
 	virtio_pci_dev_cleanup(vdev);
@@ -316,26 +517,89 @@ static void virtio_net_uninitialize(ddf_dev_t *dev)
 	nic_t *nic = ddf_dev_data_get(dev);
 	virtio_net_t *virtio_net = (virtio_net_t *) nic_get_specific(nic);
 
-	virtio_teardown_dma_bufs(virtio_net->rx_buf);
-	virtio_teardown_dma_bufs(virtio_net->tx_buf);
-	virtio_teardown_dma_bufs(virtio_net->ct_buf);
+	virtio_net_teardown_bufs(virtio_net);
 
 	virtio_device_setup_fail(&virtio_net->virtio_dev);
 	virtio_pci_dev_cleanup(&virtio_net->virtio_dev);
 }
 
+/** Hash a byte range into a flow hash (FNV-1a) */
+static uint32_t virtio_net_hash(uint32_t hash, const uint8_t *data,
+    size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+/** Select the queue pair for sending a frame
+ *
+ * Frames of one IP flow always use the same queue pair so that they
+ * are not reordered.
+ *
+ * @param virtio_net	Virtio network device
+ * @param frame		Ethernet frame
+ * @param size		Size of the frame
+ *
+ * @return Queue pair
+ */
+static unsigned virtio_net_tx_pair(virtio_net_t *virtio_net,
+    const uint8_t *frame, size_t size)
+{
+	if (virtio_net->pairs == 1 || size < ETH_HDR_SIZE)
+		return 0;
+
+	uint32_t hash = 2166136261;
+	uint16_t etype = (frame[12] << 8) | frame[13];
+	const uint8_t *l3 = frame + ETH_HDR_SIZE;
+	size_t l3_size = size - ETH_HDR_SIZE;
+	size_t l4_offset = 0;
+	uint8_t proto = 0;
+
+	if (etype == ETYPE_IPV4 && l3_size >= 20) {
+		/* Source and destination address */
+		hash = virtio_net_hash(hash, l3 + 12, 8);
+		l4_offset = (l3[0] & 0x0f) * 4;
+		proto = l3[9];
+	} else if (etype == ETYPE_IPV6 && l3_size >= 40) {
+		/* Source and destination address */
+		hash = virtio_net_hash(hash, l3 + 8, 32);
+		l4_offset = 40;
+		proto = l3[6];
+	}
+
+	/* Source and destination port */
+	if ((proto == IP_PROTO_TCP || proto == IP_PROTO_UDP) &&
+	    l3_size >= l4_offset + 4)
+		hash = virtio_net_hash(hash, l3 + l4_offset, 4);
+
+	return hash % virtio_net->pairs;
+}
+
 static void virtio_net_send(nic_t *nic, void *data, size_t size)
 {
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
 
-	if (size > sizeof(virtio_net) + TX_BUF_SIZE) {
+	if (size > TX_BUF_SIZE - sizeof(virtio_net_hdr_t)) {
 		ddf_msg(LVL_WARN, "TX data too big, frame dropped");
 		return;
 	}
 
-	uint16_t descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
-	    &virtio_net->tx_free_head);
+	unsigned pairno = virtio_net_tx_pair(virtio_net, data, size);
+	virtio_net_pair_t *pair = &virtio_net->pair[pairno];
+
+	/*
+	 * TX interrupts are suppressed, reclaim the buffers sent so far
+	 * before taking a new one.
+	 */
+	virtio_net_tx_reclaim(virtio_net, pairno);
+
+	uint16_t descno = virtio_alloc_desc(vdev, TX_QUEUE(pairno),
+	    &pair->tx_free_head);
 	if (descno == (uint16_t) -1U) {
 		ddf_msg(LVL_WARN, "No TX buffers available, frame dropped");
 		return;
@@ -343,7 +607,7 @@ static void virtio_net_send(nic_t *nic, void *data, size_t size)
 	assert(descno < TX_BUFFERS);
 
 	/* Setup the packet header */
-	virtio_net_hdr_t *hdr = (virtio_net_hdr_t *) virtio_net->tx_buf[descno];
+	virtio_net_hdr_t *hdr = (virtio_net_hdr_t *) pair->tx_buf[descno];
 	memset(hdr, 0, sizeof(virtio_net_hdr_t));
 	hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
 	hdr->num_buffers = 0;
@@ -353,10 +617,11 @@ static void virtio_net_send(nic_t *nic, void *data, size_t size)
 
 	/*
 	 * Set the descriptor, put it into the virtqueue and notify the device
+	 * unless it is still busy with the previous frames.
 	 */
-	virtio_virtq_desc_set(vdev, TX_QUEUE_1, descno,
-	    virtio_net->tx_buf_p[descno], sizeof(virtio_net_hdr_t) + size, 0, 0);
-	virtio_virtq_produce_available(vdev, TX_QUEUE_1, descno);
+	virtio_virtq_desc_set(vdev, TX_QUEUE(pairno), descno,
+	    pair->tx_buf_p[descno], sizeof(virtio_net_hdr_t) + size, 0, 0);
+	virtio_virtq_produce_available(vdev, TX_QUEUE(pairno), descno);
 }
 
 static errno_t virtio_net_on_multicast_mode_change(nic_t *nic,
@@ -33,10 +33,13 @@
 #include <abi/cap.h>
 #include <nic/nic.h>
 
-#define RX_BUFFERS	8
-#define TX_BUFFERS	8
+#define RX_BUFFERS	32
+#define TX_BUFFERS	32
 #define CT_BUFFERS	4
 
+/** Maximum number of RX/TX queue pairs used by the driver */
+#define VIRTIO_NET_MAX_PAIRS	4
+
 /** Device handles packets with partial checksum. */
 #define VIRTIO_NET_F_CSUM		(1U << 0)
 /** Driver handles packets with partial checksum. */
@@ -45,6 +48,8 @@
 #define VIRTIO_NET_F_MAC		(1U << 5)
 /** Control channel is available */
 #define VIRTIO_NET_F_CTRL_VQ		(1U << 17)
+/** Device supports multiqueue with automatic receive steering */
+#define VIRTIO_NET_F_MQ			(1U << 22)
 
 #define VIRTIO_NET_HDR_GSO_NONE 0
 typedef struct {
@@ -57,20 +62,52 @@ typedef struct {
 	uint16_t num_buffers;
 } virtio_net_hdr_t;
 
+/* Control queue commands. */
+#define VIRTIO_NET_CTRL_MQ			4
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET		0
+
+/* Control queue command status. */
+#define VIRTIO_NET_OK		0
+#define VIRTIO_NET_ERR		1
+
+typedef struct {
+	uint8_t class;
+	uint8_t command;
+} virtio_net_ctrl_hdr_t;
+
+typedef struct {
+	uint16_t virtqueue_pairs;
+} virtio_net_ctrl_mq_t;
+
 typedef struct {
 	uint8_t mac[ETH_ADDR];
+	ioport16_t status;
+	ioport16_t max_virtqueue_pairs;
 } virtio_net_cfg_t;
 
+/** RX/TX queue pair */
 typedef struct {
-	virtio_dev_t virtio_dev;
 	void *rx_buf[RX_BUFFERS];
 	uintptr_t rx_buf_p[RX_BUFFERS];
 	void *tx_buf[TX_BUFFERS];
 	uintptr_t tx_buf_p[TX_BUFFERS];
+
+	uint16_t tx_free_head;
+} virtio_net_pair_t;
+
+typedef struct {
+	virtio_dev_t virtio_dev;
+	virtio_net_pair_t pair[VIRTIO_NET_MAX_PAIRS];
 	void *ct_buf[CT_BUFFERS];
 	uintptr_t ct_buf_p[CT_BUFFERS];
 
-	uint16_t tx_free_head;
+	/** Number of RX/TX queue pairs in use */
+	unsigned pairs;
+	/** Number of RX/TX queue pairs set up */
+	unsigned pairs_setup;
+	/** Index of the control queue */
+	uint16_t ct_queue;
+
 	uint16_t ct_free_head;
 
 	int irq;
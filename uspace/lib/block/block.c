@@ -54,24 +54,96 @@
 #include <str_error.h>
 #include <offset.h>
 #include <inttypes.h>
+#include <stdatomic.h>
 #include "block.h"
 
 #define MAX_WRITE_RETRIES 10
 
+/** Initial read-ahead window (in blocks) */
+#define READAHEAD_MIN_WINDOW  4
+/** Default maximum read-ahead window (in blocks) */
+#define READAHEAD_MAX_WINDOW  32
+
+/** Period of the write-back flusher (in microseconds) */
+#define FLUSH_PERIOD  1000000
+/** Number of flusher periods after which an unused dirty block is written */
+#define FLUSH_DIRTY_AGE  5
+/** Percentage of dirty unused blocks which triggers an immediate flush */
+#define FLUSH_DIRTY_RATIO  40
+/** Maximum number of blocks written back by one flusher pass */
+#define FLUSH_BATCH  64
+
+#define CACHE_LO_WATERMARK	10
+#define CACHE_HI_WATERMARK	20
+
+/** Number of shards of a block cache (a power of two) */
+#define CACHE_SHARDS  8
+
 /** Lock protecting the device connection list */
 static FIBRIL_MUTEX_INITIALIZE(dcl_lock);
 /** Device connection list head. */
 static LIST_INITIALIZE(dcl);
 
+/** Shard of a block cache
+ *
+ * Blocks are distributed among the shards by their logical address. Each
+ * shard has its own lock, so that fibrils working with different blocks do
+ * not serialize on a single cache lock.
+ */
 typedef struct {
 	fibril_mutex_t lock;
-	size_t lblock_size;       /**< Logical block size. */
-	unsigned blocks_cluster;  /**< Physical blocks per block_t */
-	unsigned block_count;     /**< Total number of blocks. */
-	unsigned blocks_cached;   /**< Number of cached blocks. */
 	hash_table_t block_hash;
 	list_t free_list;
+
+	/*
+	 * Statistics of the shard.
+	 */
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t ra_hits;
+} cache_shard_t;
+
+typedef struct {
+	/** Lock protecting the read-ahead, flusher and statistics state. */
+	fibril_mutex_t lock;
+	size_t lblock_size;       /**< Logical block size. */
+	unsigned blocks_cluster;  /**< Physical blocks per block_t */
+	unsigned block_count;     /**< Number of preallocated blocks. */
+	atomic_uint blocks_cached;  /**< Number of cached blocks. */
 	enum cache_mode mode;
+	cache_shard_t shard[CACHE_SHARDS];
+
+	/*
+	 * Pool of preallocated blocks.
+	 */
+	fibril_mutex_t pool_lock;
+	list_t pool;              /**< Unused preallocated blocks. */
+	block_t *pool_blocks;     /**< Preallocated block structures. */
+	uint8_t *pool_data;       /**< Preallocated block buffers. */
+
+	/*
+	 * Sequential read-ahead state. The atomic hints hold the low bits of
+	 * block addresses and let readahead_access() follow a stream without
+	 * the cache lock until the next window is due.
+	 */
+	atomic_uint ra_next;      /**< Next block of a sequential stream. */
+	atomic_uint ra_trigger;   /**< Block which issues the next window. */
+	atomic_bool ra_open;      /**< The read-ahead window is open. */
+	aoff64_t ra_end;          /**< First block not read ahead yet. */
+	unsigned ra_window;       /**< Current read-ahead window. */
+	unsigned ra_max_window;   /**< Maximum read-ahead window. */
+	unsigned ra_inflight;     /**< Pending asynchronous read-aheads. */
+	fibril_condvar_t ra_cv;   /**< Signalled when ra_inflight drops. */
+
+	/*
+	 * Write-back flusher state.
+	 */
+	fibril_condvar_t flush_cv;  /**< Wakes up the flusher. */
+	bool flusher_running;       /**< Flusher fibril is running. */
+	bool flusher_stop;          /**< Flusher fibril should terminate. */
+	atomic_uint dirty_free;     /**< Dirty unused blocks (a hint). */
+
+	block_cache_stats_t stats;
 } cache_t;
 
 typedef struct {
@@ -89,6 +161,8 @@ typedef struct {
 static errno_t read_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static errno_t write_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
 static aoff64_t ba_ltop(devcon_t *, aoff64_t);
+static unsigned cache_flush(devcon_t *, bool);
+static errno_t flusher_fibril(void *);
 
 static devcon_t *devcon_search(service_id_t service_id)
 {
@@ -267,6 +341,67 @@ static hash_table_ops_t cache_ops = {
 	.remove_callback = NULL
 };
 
+/** Get the cache shard of a block. */
+static cache_shard_t *cache_shard(cache_t *cache, aoff64_t lba)
+{
+	return &cache->shard[lba & (CACHE_SHARDS - 1)];
+}
+
+/** Allocate a block structure together with its buffer.
+ *
+ * Blocks are taken from the preallocated pool if possible. Only when the
+ * pool is exhausted, e.g. because all of its blocks are in use, is the
+ * block allocated from the heap.
+ *
+ * @return Uninitialized block or NULL if there is not enough memory.
+ */
+static block_t *cache_block_alloc(cache_t *cache)
+{
+	fibril_mutex_lock(&cache->pool_lock);
+	block_t *b = list_pop(&cache->pool, block_t, free_link);
+	fibril_mutex_unlock(&cache->pool_lock);
+	if (b)
+		return b;
+
+	b = malloc(sizeof(block_t));
+	if (!b)
+		return NULL;
+
+	b->data = malloc(cache->lblock_size);
+	if (!b->data) {
+		free(b);
+		return NULL;
+	}
+
+	return b;
+}
+
+/** Free a block allocated by cache_block_alloc(). */
+static void cache_block_free(cache_t *cache, block_t *b)
+{
+	if (b >= cache->pool_blocks &&
+	    b < cache->pool_blocks + cache->block_count) {
+		fibril_mutex_lock(&cache->pool_lock);
+		list_append(&b->free_link, &cache->pool);
+		fibril_mutex_unlock(&cache->pool_lock);
+		return;
+	}
+
+	free(b->data);
+	free(b);
+}
+
+/** Destroy the shards and the pool of a cache. */
+static void cache_destroy(cache_t *cache, unsigned shards)
+{
+	for (unsigned i = 0; i < shards; i++)
+		hash_table_destroy(&cache->shard[i].block_hash);
+
+	free(cache->pool_blocks);
+	free(cache->pool_data);
+	free(cache);
+}
+
 errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
     enum cache_mode mode)
 {
@@ -280,12 +415,35 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 	if (!cache)
 		return ENOMEM;
 
+	/*
+	 * Unless the caller asks for more, preallocate enough blocks for the
+	 * cache to reach its high watermark with read-ahead enabled.
+	 */
+	if (blocks < CACHE_HI_WATERMARK + 2 * READAHEAD_MAX_WINDOW)
+		blocks = CACHE_HI_WATERMARK + 2 * READAHEAD_MAX_WINDOW;
+
 	fibril_mutex_initialize(&cache->lock);
-	list_initialize(&cache->free_list);
 	cache->lblock_size = size;
 	cache->block_count = blocks;
-	cache->blocks_cached = 0;
+	atomic_init(&cache->blocks_cached, 0);
 	cache->mode = mode;
+	atomic_init(&cache->ra_next, 0);
+	atomic_init(&cache->ra_trigger, 0);
+	atomic_init(&cache->ra_open, false);
+	cache->ra_end = 0;
+	cache->ra_window = 0;
+	cache->ra_max_window = READAHEAD_MAX_WINDOW;
+	cache->ra_inflight = 0;
+	fibril_condvar_initialize(&cache->ra_cv);
+	fibril_condvar_initialize(&cache->flush_cv);
+	cache->flusher_running = false;
+	cache->flusher_stop = false;
+	atomic_init(&cache->dirty_free, 0);
+	memset(&cache->stats, 0, sizeof(cache->stats));
+	fibril_mutex_initialize(&cache->pool_lock);
+	list_initialize(&cache->pool);
+	cache->pool_blocks = NULL;
+	cache->pool_data = NULL;
 
 	/* Allow 1:1 or small-to-large block size translation */
 	if (cache->lblock_size % devcon->pblock_size != 0) {
@@ -295,12 +453,51 @@ errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
 
 	cache->blocks_cluster = cache->lblock_size / devcon->pblock_size;
 
-	if (!hash_table_create(&cache->block_hash, 0, 0, &cache_ops)) {
-		free(cache);
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shard[i];
+
+		fibril_mutex_initialize(&shard->lock);
+		list_initialize(&shard->free_list);
+		shard->hits = 0;
+		shard->misses = 0;
+		shard->ra_hits = 0;
+
+		if (!hash_table_create(&shard->block_hash, 0, 0, &cache_ops)) {
+			cache_destroy(cache, i);
+			return ENOMEM;
+		}
+	}
+
+	cache->pool_blocks = calloc(blocks, sizeof(block_t));
+	cache->pool_data = malloc(blocks * size);
+	if (!cache->pool_blocks || !cache->pool_data) {
+		cache_destroy(cache, CACHE_SHARDS);
 		return ENOMEM;
 	}
 
+	for (unsigned i = 0; i < blocks; i++) {
+		block_t *b = &cache->pool_blocks[i];
+
+		b->data = cache->pool_data + i * size;
+		link_initialize(&b->free_link);
+		list_append(&b->free_link, &cache->pool);
+	}
+
 	devcon->cache = cache;
+
+	/*
+	 * In write-back mode, dirty blocks are written back in the
+	 * background. Should the flusher fail to start, they are still
+	 * written back when recycled.
+	 */
+	if (mode == CACHE_MODE_WB) {
+		fid_t fid = fibril_create(flusher_fibril, devcon);
+		if (fid != 0) {
+			cache->flusher_running = true;
+			fibril_add_ready(fid);
+		}
+	}
+
 	return EOK;
 }
 
@@ -316,43 +513,147 @@ errno_t block_cache_fini(service_id_t service_id)
 		return EOK;
 	cache = devcon->cache;
 
+	/*
+	 * Disable read-ahead, stop the flusher and wait for the pending
+	 * read-aheads and the flusher to finish.
+	 */
+	fibril_mutex_lock(&cache->lock);
+	cache->ra_max_window = 0;
+	while (cache->ra_inflight > 0)
+		fibril_condvar_wait(&cache->ra_cv, &cache->lock);
+	cache->flusher_stop = true;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	while (cache->flusher_running)
+		fibril_condvar_wait(&cache->flush_cv, &cache->lock);
+	fibril_mutex_unlock(&cache->lock);
+
+	/* Write back as many dirty blocks as possible in large requests. */
+	while (cache_flush(devcon, true) == FLUSH_BATCH)
+		;
+
 	/*
 	 * We are expecting to find all blocks for this device handle on the
-	 * free list, i.e. the block reference count should be zero. Do not
+	 * free lists, i.e. the block reference count should be zero. Do not
 	 * bother with the cache and block locks because we are single-threaded.
 	 */
-	while (!list_empty(&cache->free_list)) {
-		block_t *b = list_get_instance(list_first(&cache->free_list),
-		    block_t, free_link);
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shard[i];
 
-		list_remove(&b->free_link);
-		if (b->dirty) {
-			rc = write_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, b->size);
-			if (rc != EOK)
-				return rc;
-		}
+		while (!list_empty(&shard->free_list)) {
+			block_t *b = list_get_instance(
+			    list_first(&shard->free_list), block_t, free_link);
 
-		hash_table_remove_item(&cache->block_hash, &b->hash_link);
+			list_remove(&b->free_link);
+			if (b->dirty) {
+				rc = write_blocks(devcon, b->pba,
+				    cache->blocks_cluster, b->data, b->size);
+				if (rc != EOK)
+					return rc;
+			}
 
-		free(b->data);
-		free(b);
+			hash_table_remove_item(&shard->block_hash,
+			    &b->hash_link);
+			cache_block_free(cache, b);
+		}
 	}
 
-	hash_table_destroy(&cache->block_hash);
 	devcon->cache = NULL;
-	free(cache);
+	cache_destroy(cache, CACHE_SHARDS);
 
 	return EOK;
 }
 
-#define CACHE_LO_WATERMARK	10
-#define CACHE_HI_WATERMARK	20
-static bool cache_can_grow(cache_t *cache)
+/** Set the maximum read-ahead window of a block cache.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param max_window	Maximum number of blocks read ahead at once. Zero
+ *			disables read-ahead. Larger values than
+ *			READAHEAD_MAX_WINDOW are cut down to it.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t block_cache_readahead_set(service_id_t service_id, unsigned max_window)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	if (!devcon)
+		return ENOENT;
+	if (!devcon->cache)
+		return EINVAL;
+
+	/* readahead_run() cannot read more blocks at once */
+	max_window = min(max_window, READAHEAD_MAX_WINDOW);
+
+	cache_t *cache = devcon->cache;
+	fibril_mutex_lock(&cache->lock);
+	cache->ra_max_window = max_window;
+	cache->ra_window = min(cache->ra_window, max_window);
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
+/** Get block cache statistics.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param stats		Place to store the statistics.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t block_cache_stats_get(service_id_t service_id,
+    block_cache_stats_t *stats)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	if (!devcon)
+		return ENOENT;
+	if (!devcon->cache)
+		return EINVAL;
+
+	cache_t *cache = devcon->cache;
+	fibril_mutex_lock(&cache->lock);
+	*stats = cache->stats;
+	stats->ra_window = cache->ra_window;
+	stats->ra_max_window = cache->ra_max_window;
+	fibril_mutex_unlock(&cache->lock);
+
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shard[i];
+
+		fibril_mutex_lock(&shard->lock);
+		stats->hits += shard->hits;
+		stats->misses += shard->misses;
+		stats->ra_hits += shard->ra_hits;
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	return EOK;
+}
+
+/** Number of cached blocks above which unused blocks are freed.
+ *
+ * Leave room for the blocks read ahead, otherwise they would be freed as
+ * soon as the read-ahead drops its references to them.
+ */
+static unsigned cache_hi_watermark(cache_t *cache)
+{
+	return max(cache->block_count,
+	    CACHE_HI_WATERMARK + 2 * cache->ra_max_window);
+}
+
+/** Account for a dirty block leaving the free list. */
+static void cache_dirty_dec(cache_t *cache)
+{
+	unsigned dirty = atomic_load(&cache->dirty_free);
+
+	while (dirty > 0 && !atomic_compare_exchange_weak(&cache->dirty_free,
+	    &dirty, dirty - 1))
+		;
+}
+
+static bool cache_can_grow(cache_t *cache, cache_shard_t *shard)
 {
-	if (cache->blocks_cached < CACHE_LO_WATERMARK)
+	if (atomic_load(&cache->blocks_cached) < CACHE_LO_WATERMARK)
 		return true;
-	if (!list_empty(&cache->free_list))
+	if (!list_empty(&shard->free_list))
 		return false;
 	return true;
 }
@@ -364,10 +665,550 @@ static void block_initialize(block_t *b)
 	b->write_failures = 0;
 	b->dirty = false;
 	b->toxic = false;
+	b->readahead = false;
+	b->dirty_age = 0;
 	fibril_rwlock_initialize(&b->contents_lock);
 	link_initialize(&b->free_link);
 }
 
+/** Read-ahead request */
+typedef struct {
+	devcon_t *devcon;
+	aoff64_t ba;
+	unsigned cnt;
+} readahead_t;
+
+/** Get a block for read-ahead.
+ *
+ * Read-ahead must not stall on writing back dirty blocks, so it either
+ * grows the cache or takes over the least recently used clean block of the
+ * shard. Must be called with the shard lock held.
+ *
+ * @return Block removed from the cache or NULL if there is none.
+ */
+static block_t *readahead_block_alloc(cache_t *cache, cache_shard_t *shard)
+{
+	if (atomic_load(&cache->blocks_cached) < cache_hi_watermark(cache)) {
+		block_t *b = cache_block_alloc(cache);
+		if (b) {
+			atomic_fetch_add(&cache->blocks_cached, 1);
+			return b;
+		}
+	}
+
+	list_foreach(shard->free_list, free_link, block_t, b) {
+		if (!fibril_mutex_trylock(&b->lock))
+			continue;
+		bool dirty = b->dirty;
+		fibril_mutex_unlock(&b->lock);
+		if (dirty)
+			continue;
+
+		list_remove(&b->free_link);
+		hash_table_remove_item(&shard->block_hash, &b->hash_link);
+		return b;
+	}
+
+	return NULL;
+}
+
+/** Read the contents of blocks instantiated by read-ahead.
+ *
+ * The blocks are expected to be consecutive. They are read using as few
+ * requests as possible. Should that fail, each block is read individually
+ * so that an error reading one block does not affect the others.
+ */
+static void readahead_read(devcon_t *devcon, block_t **blocks, unsigned cnt)
+{
+	cache_t *cache = devcon->cache;
+	size_t lsize = cache->lblock_size;
+	unsigned chunk = max(DATA_XFER_LIMIT / lsize, 1);
+	void *buf = NULL;
+
+	if (cnt > 1)
+		buf = malloc(min(cnt, chunk) * lsize);
+
+	for (unsigned i = 0; i < cnt; i += chunk) {
+		unsigned n = min(cnt - i, chunk);
+		errno_t rc = ENOMEM;
+
+		if (buf && n > 1) {
+			rc = read_blocks(devcon, blocks[i]->pba,
+			    n * cache->blocks_cluster, buf, n * lsize);
+			if (rc == EOK) {
+				for (unsigned j = 0; j < n; j++) {
+					memcpy(blocks[i + j]->data,
+					    buf + j * lsize, lsize);
+				}
+			}
+		}
+
+		if (rc == EOK)
+			continue;
+
+		for (unsigned j = i; j < i + n; j++) {
+			rc = read_blocks(devcon, blocks[j]->pba,
+			    cache->blocks_cluster, blocks[j]->data, lsize);
+			if (rc != EOK)
+				blocks[j]->toxic = true;
+		}
+	}
+
+	free(buf);
+}
+
+/** Read and release blocks instantiated by read-ahead.
+ *
+ * @param devcon	Device connection.
+ * @param blocks	Consecutive blocks, locked by the caller.
+ * @param cnt		Number of blocks.
+ */
+static void readahead_finish(devcon_t *devcon, block_t **blocks, unsigned cnt)
+{
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+	cache->stats.ra_blocks += cnt;
+	fibril_mutex_unlock(&cache->lock);
+
+	readahead_read(devcon, blocks, cnt);
+
+	/*
+	 * Unlock all the blocks before dropping the references. block_put()
+	 * needs the shard lock, which block_get() may be holding while
+	 * waiting for one of the blocks.
+	 */
+	for (unsigned i = 0; i < cnt; i++) {
+		blocks[i]->readahead = !blocks[i]->toxic;
+		fibril_mutex_unlock(&blocks[i]->lock);
+	}
+
+	for (unsigned i = 0; i < cnt; i++)
+		(void) block_put(blocks[i]);
+}
+
+/** Read consecutive blocks ahead into the cache.
+ *
+ * Blocks which are already cached are skipped. The read-ahead stops at the
+ * end of the device or at the first block which cannot be allocated.
+ *
+ * @param devcon	Device connection.
+ * @param ba		First block to read ahead (logical).
+ * @param cnt		Number of blocks to read ahead.
+ */
+static void readahead_run(devcon_t *devcon, aoff64_t ba, unsigned cnt)
+{
+	cache_t *cache = devcon->cache;
+	block_t *blocks[READAHEAD_MAX_WINDOW];
+	unsigned n = 0;
+
+	cnt = min(cnt, READAHEAD_MAX_WINDOW);
+
+	for (unsigned i = 0; i < cnt; i++) {
+		aoff64_t lba = ba + i;
+		cache_shard_t *shard = cache_shard(cache, lba);
+
+		if (ba_ltop(devcon, lba) + cache->blocks_cluster >
+		    devcon->pblocks)
+			break;
+
+		/*
+		 * block_get() may be holding the shard lock while waiting for
+		 * one of the blocks locked by us. Rather than waiting for the
+		 * shard lock, read the blocks gathered so far first.
+		 */
+		if (n == 0 || !fibril_mutex_trylock(&shard->lock)) {
+			if (n > 0) {
+				readahead_finish(devcon, blocks, n);
+				n = 0;
+			}
+			fibril_mutex_lock(&shard->lock);
+		}
+
+		if (hash_table_find(&shard->block_hash, &lba)) {
+			/* The blocks gathered so far end here. */
+			fibril_mutex_unlock(&shard->lock);
+			if (n > 0) {
+				readahead_finish(devcon, blocks, n);
+				n = 0;
+			}
+			continue;
+		}
+
+		block_t *b = readahead_block_alloc(cache, shard);
+		if (!b) {
+			fibril_mutex_unlock(&shard->lock);
+			break;
+		}
+
+		block_initialize(b);
+		b->service_id = devcon->service_id;
+		b->size = cache->lblock_size;
+		b->lba = lba;
+		b->pba = ba_ltop(devcon, lba);
+		hash_table_insert(&shard->block_hash, &b->hash_link);
+
+		/*
+		 * Keep the block locked until its contents is read so that
+		 * block_get() of this block waits for the read-ahead.
+		 */
+		fibril_mutex_lock(&b->lock);
+		fibril_mutex_unlock(&shard->lock);
+		blocks[n++] = b;
+	}
+
+	if (n > 0)
+		readahead_finish(devcon, blocks, n);
+}
+
+static errno_t readahead_fibril(void *arg)
+{
+	readahead_t *ra = (readahead_t *) arg;
+	cache_t *cache = ra->devcon->cache;
+
+	readahead_run(ra->devcon, ra->ba, ra->cnt);
+	free(ra);
+
+	fibril_mutex_lock(&cache->lock);
+	if (--cache->ra_inflight == 0)
+		fibril_condvar_broadcast(&cache->ra_cv);
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
+/** Track sequential access to the cache and read ahead if appropriate.
+ *
+ * A block requested right after its predecessor continues a sequential
+ * stream. The first such request opens a small read-ahead window; each
+ * time the stream consumes half of the blocks read ahead, the next window
+ * is read asynchronously and the window doubles up to its maximum. Any
+ * other request collapses the window.
+ *
+ * Only the requests which open, grow or collapse the window take the cache
+ * lock, the others just advance the atomic hints.
+ *
+ * @param devcon	Device connection.
+ * @param ba		Requested block (logical).
+ */
+static void readahead_access(devcon_t *devcon, aoff64_t ba)
+{
+	cache_t *cache = devcon->cache;
+	unsigned next = atomic_load(&cache->ra_next);
+	unsigned cnt = 0;
+	aoff64_t start;
+
+	if ((unsigned) ba == next) {
+		if ((unsigned) ba != atomic_load(&cache->ra_trigger)) {
+			atomic_compare_exchange_strong(&cache->ra_next, &next,
+			    next + 1);
+			return;
+		}
+	} else if (!atomic_load(&cache->ra_open)) {
+		atomic_store(&cache->ra_next, ba + 1);
+		atomic_store(&cache->ra_trigger, ba + 1);
+		return;
+	}
+
+	fibril_mutex_lock(&cache->lock);
+
+	if (cache->ra_max_window == 0 ||
+	    (unsigned) ba != atomic_load(&cache->ra_next)) {
+		cache->ra_window = 0;
+		atomic_store(&cache->ra_open, false);
+		atomic_store(&cache->ra_next, ba + 1);
+		/* With read-ahead disabled, no request needs the lock. */
+		atomic_store(&cache->ra_trigger,
+		    cache->ra_max_window == 0 ? ba : ba + 1);
+		fibril_mutex_unlock(&cache->lock);
+		return;
+	}
+
+	atomic_store(&cache->ra_next, ba + 1);
+
+	if (cache->ra_window == 0) {
+		/* The stream starts here */
+		cache->ra_end = ba + 1;
+		cache->ra_window = min(READAHEAD_MIN_WINDOW,
+		    cache->ra_max_window);
+		cnt = cache->ra_window;
+	} else {
+		if (cache->ra_end <= ba)
+			cache->ra_end = ba + 1;
+
+		if (cache->ra_end - ba <= cache->ra_window / 2) {
+			cache->ra_window = min(2 * cache->ra_window,
+			    cache->ra_max_window);
+			cnt = cache->ra_window;
+		}
+	}
+
+	start = cache->ra_end;
+	cache->ra_end += cnt;
+
+	atomic_store(&cache->ra_open, true);
+	if (cache->ra_end - ba > cache->ra_window / 2) {
+		atomic_store(&cache->ra_trigger,
+		    cache->ra_end - cache->ra_window / 2);
+	} else {
+		atomic_store(&cache->ra_trigger, ba + 1);
+	}
+
+	if (cnt == 0) {
+		fibril_mutex_unlock(&cache->lock);
+		return;
+	}
+
+	readahead_t *ra = malloc(sizeof(readahead_t));
+	fid_t fid = 0;
+	if (ra) {
+		ra->devcon = devcon;
+		ra->ba = start;
+		ra->cnt = cnt;
+		fid = fibril_create(readahead_fibril, ra);
+	}
+
+	if (fid == 0) {
+		free(ra);
+		fibril_mutex_unlock(&cache->lock);
+		return;
+	}
+
+	cache->ra_inflight++;
+	fibril_mutex_unlock(&cache->lock);
+
+	fibril_add_ready(fid);
+}
+
+/** Choose a block to recycle.
+ *
+ * Prefer the least recently used clean block so that block_get() does not
+ * have to wait for a write-back. If there is no clean block, wake up the
+ * flusher and fall back to the least recently used block.
+ * Must be called with the shard lock held and a non-empty free list.
+ */
+static block_t *cache_recycle_candidate(cache_t *cache, cache_shard_t *shard)
+{
+	list_foreach(shard->free_list, free_link, block_t, b) {
+		if (!fibril_mutex_trylock(&b->lock))
+			continue;
+		bool dirty = b->dirty;
+		fibril_mutex_unlock(&b->lock);
+		if (!dirty)
+			return b;
+	}
+
+	if (cache->flusher_running)
+		fibril_condvar_signal(&cache->flush_cv);
+
+	return list_get_instance(list_first(&shard->free_list), block_t,
+	    free_link);
+}
+
+static int block_pba_cmp(const void *a, const void *b)
+{
+	const block_t *ba = *(block_t *const *) a;
+	const block_t *bb = *(block_t *const *) b;
+
+	if (ba->pba < bb->pba)
+		return -1;
+	if (ba->pba > bb->pba)
+		return 1;
+	return 0;
+}
+
+/** Write back locked dirty blocks.
+ *
+ * The blocks are sorted by their address and runs of contiguous blocks are
+ * written using as few requests as possible. Should that fail, each block of
+ * the run is written individually.
+ *
+ * @param devcon	Device connection.
+ * @param blocks	Locked dirty blocks.
+ * @param cnt		Number of blocks.
+ *
+ * @return		Number of write requests issued.
+ */
+static unsigned cache_write_back(devcon_t *devcon, block_t **blocks,
+    unsigned cnt)
+{
+	cache_t *cache = devcon->cache;
+	size_t lsize = cache->lblock_size;
+	unsigned chunk = max(DATA_XFER_LIMIT / lsize, 1);
+	unsigned writes = 0;
+	void *buf = NULL;
+
+	qsort(blocks, cnt, sizeof(block_t *), block_pba_cmp);
+
+	if (cnt > 1)
+		buf = malloc(min(cnt, chunk) * lsize);
+
+	unsigned i = 0;
+	while (i < cnt) {
+		/* Find the run of contiguous blocks starting at i. */
+		unsigned n = 1;
+		while (i + n < cnt && n < chunk && blocks[i + n]->pba ==
+		    blocks[i + n - 1]->pba + cache->blocks_cluster)
+			n++;
+
+		errno_t rc = ENOMEM;
+		if (n == 1) {
+			rc = write_blocks(devcon, blocks[i]->pba,
+			    cache->blocks_cluster, blocks[i]->data, lsize);
+			writes++;
+		} else if (buf) {
+			for (unsigned j = 0; j < n; j++) {
+				memcpy(buf + j * lsize, blocks[i + j]->data,
+				    lsize);
+			}
+			rc = write_blocks(devcon, blocks[i]->pba,
+			    n * cache->blocks_cluster, buf, n * lsize);
+			writes++;
+		}
+
+		for (unsigned j = i; j < i + n; j++) {
+			block_t *b = blocks[j];
+			errno_t brc = rc;
+
+			if (brc != EOK && n > 1) {
+				brc = write_blocks(devcon, b->pba,
+				    cache->blocks_cluster, b->data, lsize);
+				writes++;
+			}
+
+			if (brc == EOK) {
+				b->write_failures = 0;
+				b->dirty = false;
+				b->dirty_age = 0;
+			} else if (++b->write_failures >= MAX_WRITE_RETRIES) {
+				printf("Too many errors writing block %"
+				    PRIuOFF64 "from device handle %" PRIun "\n"
+				    "SEVERE DATA LOSS POSSIBLE\n",
+				    b->lba, devcon->service_id);
+				b->dirty = false;
+			}
+		}
+
+		i += n;
+	}
+
+	free(buf);
+	return writes;
+}
+
+/** Write back dirty unused blocks.
+ *
+ * Only blocks on the free list are considered, so that the flusher never
+ * competes with the file system for blocks in use.
+ *
+ * @param devcon	Device connection.
+ * @param all		If true, write back all dirty unused blocks.
+ *			Otherwise, age the dirty unused blocks and write back
+ *			those that have been dirty for FLUSH_DIRTY_AGE
+ *			periods.
+ *
+ * @return		Number of blocks selected for write-back. This is
+ *			FLUSH_BATCH if there may be more blocks to write back.
+ */
+static unsigned cache_flush(devcon_t *devcon, bool all)
+{
+	cache_t *cache = devcon->cache;
+	block_t *blocks[FLUSH_BATCH];
+	unsigned dirty = 0;
+	unsigned n = 0;
+
+	/*
+	 * The shards are always visited in the same order and the blocks of a
+	 * shard are only locked while holding its lock, so holding blocks of
+	 * the previous shards cannot deadlock with block_get().
+	 */
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shard[i];
+
+		fibril_mutex_lock(&shard->lock);
+		list_foreach(shard->free_list, free_link, block_t, b) {
+			if (!fibril_mutex_trylock(&b->lock))
+				continue;
+
+			if (b->dirty) {
+				dirty++;
+				if (!all)
+					b->dirty_age++;
+
+				if (n < FLUSH_BATCH &&
+				    (all || b->dirty_age >= FLUSH_DIRTY_AGE)) {
+					/*
+					 * Keep the block locked while it is
+					 * being written back. This keeps
+					 * block_get() from recycling or
+					 * handing it out meanwhile.
+					 */
+					blocks[n++] = b;
+					continue;
+				}
+			}
+
+			fibril_mutex_unlock(&b->lock);
+		}
+		fibril_mutex_unlock(&shard->lock);
+	}
+	atomic_store(&cache->dirty_free, dirty - n);
+
+	if (n == 0)
+		return 0;
+
+	unsigned writes = cache_write_back(devcon, blocks, n);
+
+	/*
+	 * Unlock the blocks before taking any lock again as block_get()
+	 * may be holding a shard lock while waiting for one of them.
+	 */
+	for (unsigned i = 0; i < n; i++)
+		fibril_mutex_unlock(&blocks[i]->lock);
+
+	fibril_mutex_lock(&cache->lock);
+	cache->stats.wb_blocks += n;
+	cache->stats.wb_writes += writes;
+	fibril_mutex_unlock(&cache->lock);
+
+	return n;
+}
+
+/** Write-back flusher fibril.
+ *
+ * Periodically writes back unused blocks which have been dirty for too
+ * long and writes back all unused dirty blocks when woken up because too
+ * many of them have accumulated or block_get() had no clean block to
+ * recycle.
+ */
+static errno_t flusher_fibril(void *arg)
+{
+	devcon_t *devcon = (devcon_t *) arg;
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->lock);
+	while (!cache->flusher_stop) {
+		errno_t rc = fibril_condvar_wait_timeout(&cache->flush_cv,
+		    &cache->lock, FLUSH_PERIOD);
+		if (cache->flusher_stop)
+			break;
+
+		bool all = (rc != ETIMEOUT);
+		fibril_mutex_unlock(&cache->lock);
+
+		while (cache_flush(devcon, all) == FLUSH_BATCH)
+			;
+
+		fibril_mutex_lock(&cache->lock);
+	}
+
+	cache->flusher_running = false;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	fibril_mutex_unlock(&cache->lock);
+
+	return EOK;
+}
+
 /** Instantiate a block in memory and get a reference to it.
  *
  * @param block			Pointer to where the function will store the
@@ -384,8 +1225,8 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 {
 	devcon_t *devcon;
 	cache_t *cache;
+	cache_shard_t *shard;
 	block_t *b;
-	link_t *link;
 	aoff64_t p_ba;
 	errno_t rc;
 
@@ -395,6 +1236,7 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 	assert(devcon->cache);
 
 	cache = devcon->cache;
+	shard = cache_shard(cache, ba);
 
 	/*
 	 * Check whether the logical block (or part of it) is beyond
@@ -407,12 +1249,15 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 		return EIO;
 	}
 
+	if (!(flags & BLOCK_FLAGS_NOREAD))
+		readahead_access(devcon, ba);
+
 retry:
 	rc = EOK;
 	b = NULL;
 
-	fibril_mutex_lock(&cache->lock);
-	ht_link_t *hlink = hash_table_find(&cache->block_hash, &ba);
+	fibril_mutex_lock(&shard->lock);
+	ht_link_t *hlink = hash_table_find(&shard->block_hash, &ba);
 	if (hlink) {
 	found:
 		/*
@@ -420,59 +1265,61 @@ retry:
 		 */
 		b = hash_table_get_inst(hlink, block_t, hash_link);
 		fibril_mutex_lock(&b->lock);
-		if (b->refcnt++ == 0)
+		if (b->refcnt++ == 0) {
 			list_remove(&b->free_link);
+			if (b->dirty)
+				cache_dirty_dec(cache);
+		}
 		if (b->toxic)
 			rc = EIO;
+		if (b->readahead) {
+			b->readahead = false;
+			shard->ra_hits++;
+		}
+		shard->hits++;
 		fibril_mutex_unlock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+		fibril_mutex_unlock(&shard->lock);
 	} else {
 		/*
 		 * The block was not found in the cache.
 		 */
-		if (cache_can_grow(cache)) {
+		shard->misses++;
+		if (cache_can_grow(cache, shard)) {
 			/*
 			 * We can grow the cache by allocating new blocks.
 			 * Should the allocation fail, we fail over and try to
 			 * recycle a block from the cache.
 			 */
-			b = malloc(sizeof(block_t));
+			b = cache_block_alloc(cache);
 			if (!b)
 				goto recycle;
-			b->data = malloc(cache->lblock_size);
-			if (!b->data) {
-				free(b);
-				b = NULL;
-				goto recycle;
-			}
-			cache->blocks_cached++;
+			atomic_fetch_add(&cache->blocks_cached, 1);
 		} else {
 			/*
 			 * Try to recycle a block from the free list.
 			 */
 		recycle:
-			if (list_empty(&cache->free_list)) {
-				fibril_mutex_unlock(&cache->lock);
+			if (list_empty(&shard->free_list)) {
+				fibril_mutex_unlock(&shard->lock);
 				rc = ENOMEM;
 				goto out;
 			}
-			link = list_first(&cache->free_list);
-			b = list_get_instance(link, block_t, free_link);
+			b = cache_recycle_candidate(cache, shard);
 
 			fibril_mutex_lock(&b->lock);
 			if (b->dirty) {
 				/*
 				 * The block needs to be written back to the
 				 * device before it changes identity. Do this
-				 * while not holding the cache lock so that
+				 * while not holding the shard lock so that
 				 * concurrency is not impeded. Also move the
 				 * block to the end of the free list so that we
 				 * do not slow down other instances of
 				 * block_get() draining the free list.
 				 */
 				list_remove(&b->free_link);
-				list_append(&b->free_link, &cache->free_list);
-				fibril_mutex_unlock(&cache->lock);
+				list_append(&b->free_link, &shard->free_list);
+				fibril_mutex_unlock(&shard->lock);
 				rc = write_blocks(devcon, b->pba,
 				    cache->blocks_cluster, b->data, b->size);
 				if (rc != EOK) {
@@ -496,7 +1343,7 @@ retry:
 					b->write_failures = 0;
 
 				b->dirty = false;
-				if (!fibril_mutex_trylock(&cache->lock)) {
+				if (!fibril_mutex_trylock(&shard->lock)) {
 					/*
 					 * Somebody is probably racing with us.
 					 * Unlock the block and retry.
@@ -504,12 +1351,13 @@ retry:
 					fibril_mutex_unlock(&b->lock);
 					goto retry;
 				}
-				hlink = hash_table_find(&cache->block_hash, &ba);
+				cache_dirty_dec(cache);
+				hlink = hash_table_find(&shard->block_hash, &ba);
 				if (hlink) {
 					/*
 					 * Someone else must have already
 					 * instantiated the block while we were
-					 * not holding the cache lock.
+					 * not holding the shard lock.
 					 * Leave the recycled block on the
 					 * freelist and continue as if we
 					 * found the block of interest during
@@ -527,7 +1375,7 @@ retry:
 			 * table.
 			 */
 			list_remove(&b->free_link);
-			hash_table_remove_item(&cache->block_hash, &b->hash_link);
+			hash_table_remove_item(&shard->block_hash, &b->hash_link);
 		}
 
 		block_initialize(b);
@@ -535,15 +1383,15 @@ retry:
 		b->size = cache->lblock_size;
 		b->lba = ba;
 		b->pba = ba_ltop(devcon, b->lba);
-		hash_table_insert(&cache->block_hash, &b->hash_link);
+		hash_table_insert(&shard->block_hash, &b->hash_link);
 
 		/*
-		 * Lock the block before releasing the cache lock. Thus we don't
+		 * Lock the block before releasing the shard lock. Thus we don't
 		 * kill concurrent operations on the cache while doing I/O on
 		 * the block.
 		 */
 		fibril_mutex_lock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+		fibril_mutex_unlock(&shard->lock);
 
 		if (!(flags & BLOCK_FLAGS_NOREAD)) {
 			/*
@@ -581,6 +1429,7 @@ errno_t block_put(block_t *block)
 {
 	devcon_t *devcon = devcon_search(block->service_id);
 	cache_t *cache;
+	cache_shard_t *shard;
 	unsigned blocks_cached;
 	enum cache_mode mode;
 	errno_t rc = EOK;
@@ -590,25 +1439,25 @@ errno_t block_put(block_t *block)
 	assert(block->refcnt >= 1);
 
 	cache = devcon->cache;
+	shard = cache_shard(cache, block->lba);
+	mode = cache->mode;
 
 retry:
-	fibril_mutex_lock(&cache->lock);
-	blocks_cached = cache->blocks_cached;
-	mode = cache->mode;
-	fibril_mutex_unlock(&cache->lock);
+	blocks_cached = atomic_load(&cache->blocks_cached);
 
 	/*
 	 * Determine whether to sync the block. Syncing the block is best done
-	 * when not holding the cache lock as it does not impede concurrency.
-	 * Since the situation may have changed when we unlocked the cache, the
-	 * blocks_cached and mode variables are mere hints. We will recheck the
-	 * conditions later when the cache lock is held again.
+	 * when not holding the shard lock as it does not impede concurrency.
+	 * Since the situation may change in the meantime, blocks_cached is a
+	 * mere hint. We will recheck the conditions later when the shard lock
+	 * is held.
 	 */
 	fibril_mutex_lock(&block->lock);
 	if (block->toxic)
 		block->dirty = false;	/* will not write back toxic block */
 	if (block->dirty && (block->refcnt == 1) &&
-	    (blocks_cached > CACHE_HI_WATERMARK || mode != CACHE_MODE_WB)) {
+	    (blocks_cached > cache_hi_watermark(cache) ||
+	    mode != CACHE_MODE_WB)) {
 		rc = write_blocks(devcon, block->pba, cache->blocks_cluster,
 		    block->data, block->size);
 		if (rc == EOK)
@@ -617,7 +1466,7 @@ retry:
 	}
 	fibril_mutex_unlock(&block->lock);
 
-	fibril_mutex_lock(&cache->lock);
+	fibril_mutex_lock(&shard->lock);
 	fibril_mutex_lock(&block->lock);
 	if (!--block->refcnt) {
 		/*
@@ -625,7 +1474,8 @@ retry:
 		 * block or put it on the free list. In case of an I/O error,
 		 * free the block.
 		 */
-		if ((cache->blocks_cached > CACHE_HI_WATERMARK) ||
+		if ((atomic_load(&cache->blocks_cached) >
+		    cache_hi_watermark(cache)) ||
 		    (rc != EOK)) {
 			/*
 			 * Currently there are too many cached blocks or there
@@ -635,14 +1485,14 @@ retry:
 			if (block->dirty) {
 				/*
 				 * We cannot sync the block while holding the
-				 * cache lock. Release everything and retry.
+				 * shard lock. Release everything and retry.
 				 */
 				block->refcnt++;
 
 				if (block->write_failures < MAX_WRITE_RETRIES) {
 					block->write_failures++;
 					fibril_mutex_unlock(&block->lock);
-					fibril_mutex_unlock(&cache->lock);
+					fibril_mutex_unlock(&shard->lock);
 					goto retry;
 				} else {
 					printf("Too many errors writing block %"
@@ -654,12 +1504,11 @@ retry:
 			/*
 			 * Take the block out of the cache and free it.
 			 */
-			hash_table_remove_item(&cache->block_hash, &block->hash_link);
+			hash_table_remove_item(&shard->block_hash, &block->hash_link);
 			fibril_mutex_unlock(&block->lock);
-			free(block->data);
-			free(block);
-			cache->blocks_cached--;
-			fibril_mutex_unlock(&cache->lock);
+			cache_block_free(cache, block);
+			atomic_fetch_sub(&cache->blocks_cached, 1);
+			fibril_mutex_unlock(&shard->lock);
 			return rc;
 		}
 		/*
@@ -667,18 +1516,30 @@ retry:
 		 */
 		if (cache->mode != CACHE_MODE_WB && block->dirty) {
 			/*
-			 * We cannot sync the block while holding the cache
+			 * We cannot sync the block while holding the shard
 			 * lock. Release everything and retry.
 			 */
 			block->refcnt++;
 			fibril_mutex_unlock(&block->lock);
-			fibril_mutex_unlock(&cache->lock);
+			fibril_mutex_unlock(&shard->lock);
 			goto retry;
 		}
-		list_append(&block->free_link, &cache->free_list);
+		list_append(&block->free_link, &shard->free_list);
+		if (block->dirty) {
+			/*
+			 * Wake up the flusher if dirty blocks make up too
+			 * large a part of the cache.
+			 */
+			unsigned dirty = atomic_fetch_add(&cache->dirty_free,
+			    1) + 1;
+			if (cache->flusher_running && dirty * 100 >
+			    atomic_load(&cache->blocks_cached) *
+			    FLUSH_DIRTY_RATIO)
+				fibril_condvar_signal(&cache->flush_cv);
+		}
 	}
 	fibril_mutex_unlock(&block->lock);
-	fibril_mutex_unlock(&cache->lock);
+	fibril_mutex_unlock(&shard->lock);
 
 	return rc;
 }
@@ -82,6 +82,10 @@ typedef struct block {
 	size_t size;
 	/** Number of write failures. */
 	int write_failures;
+	/** If true, the block was read ahead and has not been used yet. */
+	bool readahead;
+	/** Number of flusher periods the block has spent dirty and unused. */
+	unsigned dirty_age;
 	/** Link for placing the block into the free block list. */
 	link_t free_link;
 	/** Link for placing the block into the block hash table. */
@@ -98,6 +102,26 @@ enum cache_mode {
 	CACHE_MODE_WB
 };
 
+/** Block cache statistics */
+typedef struct {
+	/** Number of block_get() requests satisfied from the cache. */
+	uint64_t hits;
+	/** Number of block_get() requests not satisfied from the cache. */
+	uint64_t misses;
+	/** Number of blocks read ahead. */
+	uint64_t ra_blocks;
+	/** Number of blocks read ahead which were subsequently requested. */
+	uint64_t ra_hits;
+	/** Current read-ahead window (in blocks). */
+	unsigned ra_window;
+	/** Maximum read-ahead window (in blocks), zero if disabled. */
+	unsigned ra_max_window;
+	/** Number of blocks written back by the flusher. */
+	uint64_t wb_blocks;
+	/** Number of write requests issued by the flusher. */
+	uint64_t wb_writes;
+} block_cache_stats_t;
+
 extern errno_t block_init(service_id_t, size_t);
 extern void block_fini(service_id_t);
 
@@ -106,6 +130,8 @@ extern void *block_bb_get(service_id_t);
 
 extern errno_t block_cache_init(service_id_t, size_t, unsigned, enum cache_mode);
 extern errno_t block_cache_fini(service_id_t);
+extern errno_t block_cache_readahead_set(service_id_t, unsigned);
+extern errno_t block_cache_stats_get(service_id_t, block_cache_stats_t *);
 
 extern errno_t block_get(block_t **, service_id_t, aoff64_t, int);
 extern errno_t block_put(block_t *);
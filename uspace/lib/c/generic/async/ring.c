@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Shared-memory request/completion rings.
+ *
+ * A ring takes over a connection of an existing session. The client shares
+ * a memory area with the server which holds a submission ring of requests
+ * and a completion ring of their answers. While both sides are running,
+ * requests and answers are passed through the area without any syscalls.
+ * Kernel IPC is only used as a doorbell: when the client runs out of
+ * completions to reap, it sends ASYNC_RING_WAIT, which the server answers
+ * once it has processed everything submitted so far. The server checks
+ * for the doorbell only after it has found the submission ring empty for
+ * a while.
+ *
+ * Answers are posted in the order of submission. A ring is meant to be
+ * used by a single fibril at a time.
+ */
+
+#include <as.h>
+#include <async.h>
+#include <async_ring.h>
+#include <errno.h>
+#include <fibril.h>
+#include <ipc/async_ring.h>
+#include <mem.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/** Number of polling rounds before a side resorts to kernel IPC */
+#define ASYNC_RING_POLL  64
+
+#define ASYNC_RING_AREA_FLAGS \
+	(AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE)
+
+/** Switch a session to shared-memory ring mode.
+ *
+ * The server is expected to call async_ring_serve() in response to
+ * @a imethod. One exchange of the session is held by the ring until it is
+ * destroyed, so with a serialized session the session cannot be used for
+ * anything else in the meantime.
+ *
+ * @param sess    Session to the server.
+ * @param imethod Interface method which makes the server enter ring mode.
+ * @param rring   Place to store pointer to the new ring.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t async_ring_create(async_sess_t *sess, sysarg_t imethod,
+    async_ring_t **rring)
+{
+	async_ring_t *ring;
+	errno_t rc;
+
+	ring = calloc(1, sizeof(async_ring_t));
+	if (ring == NULL)
+		return ENOMEM;
+
+	ring->shared = as_area_create(AS_AREA_ANY, sizeof(async_ring_shared_t),
+	    ASYNC_RING_AREA_FLAGS, AS_AREA_UNPAGED);
+	if (ring->shared == AS_MAP_FAILED) {
+		free(ring);
+		return ENOMEM;
+	}
+
+	atomic_init(&ring->shared->sq.head, 0);
+	atomic_init(&ring->shared->sq.tail, 0);
+	atomic_init(&ring->shared->cq.head, 0);
+	atomic_init(&ring->shared->cq.tail, 0);
+	atomic_init(&ring->shared->sleeping, false);
+
+	ring->exch = async_exchange_begin(sess);
+	if (ring->exch == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	ipc_call_t answer;
+	aid_t req = async_send_0(ring->exch, imethod, &answer);
+	rc = async_share_out_start(ring->exch, ring->shared,
+	    ASYNC_RING_AREA_FLAGS);
+	if (rc != EOK) {
+		async_forget(req);
+		goto error;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	if (retval != EOK) {
+		rc = retval;
+		goto error;
+	}
+
+	*rring = ring;
+	return EOK;
+error:
+	if (ring->exch != NULL)
+		async_exchange_end(ring->exch);
+	as_area_destroy(ring->shared);
+	free(ring);
+	return rc;
+}
+
+/** Leave ring mode and destroy the ring.
+ *
+ * Answers which have not been reaped are discarded.
+ *
+ * @param ring Ring.
+ */
+void async_ring_destroy(async_ring_t *ring)
+{
+	if (ring == NULL)
+		return;
+
+	(void) async_req_0_0(ring->exch, ASYNC_RING_CLOSE);
+	async_exchange_end(ring->exch);
+	as_area_destroy(ring->shared);
+	free(ring);
+}
+
+/** Submit a request to the ring.
+ *
+ * The request is picked up by the server without further notification if
+ * it is running, or once the client asks for the answer otherwise.
+ *
+ * @param ring Ring.
+ * @param req  Request, only the method and arguments are used.
+ *
+ * @return EOK on success.
+ * @return EBUSY if there are ASYNC_RING_ENTRIES requests whose answers have
+ *         not been reaped yet.
+ */
+errno_t async_ring_submit(async_ring_t *ring, const ipc_call_t *req)
+{
+	async_ring_shared_t *shared = ring->shared;
+
+	/*
+	 * Limiting the number of requests in flight keeps both the submission
+	 * and the completion rings from overflowing.
+	 */
+	if (ring->inflight >= ASYNC_RING_ENTRIES)
+		return EBUSY;
+
+	unsigned int head = atomic_load_explicit(&shared->sq.head,
+	    memory_order_relaxed);
+
+	memcpy(shared->sqe[head % ASYNC_RING_ENTRIES].args, req->args,
+	    sizeof(req->args));
+	atomic_store_explicit(&shared->sq.head, head + 1,
+	    memory_order_release);
+
+	ring->inflight++;
+	return EOK;
+}
+
+/** Reap the answer to the oldest outstanding request.
+ *
+ * @param ring   Ring.
+ * @param answer Place to store the answer.
+ *
+ * @return EOK on success.
+ * @return ENOENT if there is no outstanding request.
+ * @return Error code if the doorbell could not be delivered or the server
+ *         stopped processing the ring.
+ */
+errno_t async_ring_reap(async_ring_t *ring, ipc_call_t *answer)
+{
+	async_ring_shared_t *shared = ring->shared;
+
+	if (ring->inflight == 0)
+		return ENOENT;
+
+	unsigned int tail = atomic_load_explicit(&shared->cq.tail,
+	    memory_order_relaxed);
+	unsigned int polls = 0;
+
+	while (atomic_load_explicit(&shared->cq.head,
+	    memory_order_acquire) == tail) {
+		/*
+		 * Poll for a while if the server is running. Otherwise ring
+		 * the doorbell, the server answers it only after it has
+		 * processed all the requests submitted so far.
+		 */
+		if (polls < ASYNC_RING_POLL && !atomic_load(&shared->sleeping)) {
+			polls++;
+			fibril_yield();
+			continue;
+		}
+
+		errno_t rc = async_req_0_0(ring->exch, ASYNC_RING_WAIT);
+		if (rc != EOK)
+			return rc;
+
+		polls = 0;
+	}
+
+	memset(answer, 0, sizeof(*answer));
+	memcpy(answer->args, shared->cqe[tail % ASYNC_RING_ENTRIES].args,
+	    sizeof(answer->args));
+	atomic_store_explicit(&shared->cq.tail, tail + 1,
+	    memory_order_release);
+
+	ring->inflight--;
+	return EOK;
+}
+
+/** Submit a request and wait for its answer.
+ *
+ * @param ring   Ring.
+ * @param req    Request, only the method and arguments are used.
+ * @param answer Place to store the answer.
+ *
+ * @return EOK on success or an error code.
+ */
+errno_t async_ring_req(async_ring_t *ring, const ipc_call_t *req,
+    ipc_call_t *answer)
+{
+	errno_t rc = async_ring_submit(ring, req);
+	if (rc != EOK)
+		return rc;
+
+	/* Answers come in order, make sure we get ours. */
+	do {
+		rc = async_ring_reap(ring, answer);
+	} while (rc == EOK && ring->inflight > 0);
+
+	return rc;
+}
+
+/** Process the requests found in the submission ring.
+ *
+ * @param shared  Shared area.
+ * @param handler Request handler.
+ * @param arg     Argument for the handler.
+ * @param count   Place to store the number of processed requests.
+ *
+ * @return EOK on success or EINVAL if the client corrupted the ring.
+ */
+static errno_t async_ring_drain(async_ring_shared_t *shared,
+    async_ring_handler_t handler, void *arg, size_t *count)
+{
+	unsigned int tail = atomic_load_explicit(&shared->sq.tail,
+	    memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&shared->sq.head,
+	    memory_order_acquire);
+	size_t processed = 0;
+
+	*count = 0;
+
+	if (head - tail > ASYNC_RING_ENTRIES)
+		return EINVAL;
+
+	while (tail != head) {
+		unsigned int chead = atomic_load_explicit(&shared->cq.head,
+		    memory_order_relaxed);
+		unsigned int ctail = atomic_load_explicit(&shared->cq.tail,
+		    memory_order_acquire);
+
+		/* No room for the answer, let the client reap first. */
+		if (chead - ctail >= ASYNC_RING_ENTRIES)
+			break;
+
+		/* Copy the request out so that the client cannot change it. */
+		ipc_call_t req;
+		memset(&req, 0, sizeof(req));
+		memcpy(req.args, shared->sqe[tail % ASYNC_RING_ENTRIES].args,
+		    sizeof(req.args));
+
+		tail++;
+		atomic_store_explicit(&shared->sq.tail, tail,
+		    memory_order_release);
+
+		ipc_call_t answer;
+		memset(&answer, 0, sizeof(answer));
+		handler(&req, &answer, arg);
+
+		memcpy(shared->cqe[chead % ASYNC_RING_ENTRIES].args,
+		    answer.args, sizeof(answer.args));
+		atomic_store_explicit(&shared->cq.head, chead + 1,
+		    memory_order_release);
+
+		processed++;
+	}
+
+	*count = processed;
+	return EOK;
+}
+
+/** Serve a connection in shared-memory ring mode.
+ *
+ * To be called by the server in response to the method the client passed
+ * to async_ring_create(). Returns when the client leaves ring mode, after
+ * which the connection continues with the regular protocol, or when the
+ * client hangs up.
+ *
+ * @param icall   Call which requested ring mode.
+ * @param handler Handler of the requests submitted to the ring.
+ * @param arg     Argument for the handler.
+ *
+ * @return EOK if the client left ring mode.
+ * @return EHANGUP if the client hung up.
+ * @return Other error code if ring mode could not be set up.
+ */
+errno_t async_ring_serve(ipc_call_t *icall, async_ring_handler_t handler,
+    void *arg)
+{
+	async_ring_shared_t *shared;
+	ipc_call_t call;
+	unsigned int flags;
+	size_t size;
+	errno_t rc;
+
+	if (!async_share_out_receive(&call, &size, &flags)) {
+		async_answer_0(icall, EINVAL);
+		return EINVAL;
+	}
+
+	if (size < sizeof(async_ring_shared_t) ||
+	    (flags & ASYNC_RING_AREA_FLAGS) != ASYNC_RING_AREA_FLAGS) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return EINVAL;
+	}
+
+	rc = async_share_out_finalize(&call, (void **) &shared);
+	if (rc != EOK || shared == AS_MAP_FAILED) {
+		async_answer_0(icall, ENOMEM);
+		return ENOMEM;
+	}
+
+	async_answer_0(icall, EOK);
+
+	bool broken = false;
+	unsigned int polls = 0;
+
+	while (true) {
+		size_t count = 0;
+
+		if (!broken &&
+		    async_ring_drain(shared, handler, arg, &count) != EOK)
+			broken = true;
+
+		if (count > 0) {
+			polls = 0;
+			continue;
+		}
+
+		if (!broken && polls < ASYNC_RING_POLL) {
+			polls++;
+			fibril_yield();
+			continue;
+		}
+
+		/*
+		 * Announce that we are going to sleep and look at the
+		 * submission ring once more, so that a request submitted in
+		 * the meantime is not left waiting for the doorbell.
+		 */
+		atomic_store(&shared->sleeping, true);
+		if (!broken && atomic_load(&shared->sq.head) !=
+		    atomic_load(&shared->sq.tail)) {
+			atomic_store(&shared->sleeping, false);
+			continue;
+		}
+
+		async_get_call(&call);
+		atomic_store(&shared->sleeping, false);
+		polls = 0;
+
+		if (!ipc_get_imethod(&call)) {
+			async_answer_0(&call, EOK);
+			rc = EHANGUP;
+			break;
+		}
+
+		if (ipc_get_imethod(&call) == ASYNC_RING_CLOSE) {
+			async_answer_0(&call, EOK);
+			rc = EOK;
+			break;
+		}
+
+		if (ipc_get_imethod(&call) != ASYNC_RING_WAIT) {
+			async_answer_0(&call, ENOTSUP);
+			continue;
+		}
+
+		/*
+		 * The doorbell. Everything the client submitted before
+		 * ringing it has been processed once the ring is drained.
+		 */
+		while (!broken) {
+			if (async_ring_drain(shared, handler, arg, &count) != EOK)
+				broken = true;
+			else if (count == 0)
+				break;
+		}
+
+		async_answer_0(&call, broken ? EIO : EOK);
+	}
+
+	as_area_destroy(shared);
+	return rc;
+}
+
+/** @}
+ */
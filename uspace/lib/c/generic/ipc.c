@@ -176,6 +176,29 @@ errno_t ipc_wait(ipc_call_t *call, sysarg_t usec, unsigned int flags)
 	return __SYSCALL3(SYS_IPC_WAIT, (sysarg_t) call, usec, flags);
 }
 
+/** Wait for IPC calls and answers, receiving all that are pending.
+ *
+ * The timeout and flags apply to the first received item. Once there is one,
+ * the items already pending are received without blocking.
+ *
+ * @param calls    Array of buffers for the received items.
+ * @param count    Number of buffers in the array, at most IPC_WAIT_BATCH_MAX
+ *                 of them are used.
+ * @param received Place to store the number of received items.
+ * @param usec     Timeout in microseconds.
+ * @param flags    Flags passed to SYS_IPC_WAIT_BATCH.
+ *
+ * @return EOK on success, in which case at least one item was received.
+ * @return An error code as in ipc_wait() otherwise.
+ *
+ */
+errno_t ipc_wait_batch(ipc_call_t *calls, size_t count, size_t *received,
+    sysarg_t usec, unsigned int flags)
+{
+	return __SYSCALL5(SYS_IPC_WAIT_BATCH, (sysarg_t) calls, count,
+	    (sysarg_t) received, usec, flags);
+}
+
 /** Hang up a phone.
  *
  * @param phandle  Handle of the phone to be hung up.
@@ -38,6 +38,7 @@
 #include <ipc/services.h>
 #include <ipc/ipc_test.h>
 #include <loc.h>
+#include <mem.h>
 #include <stdlib.h>
 #include <ipc_test.h>
 
@@ -220,5 +221,50 @@ errno_t ipc_test_share_in_rw(ipc_test_t *test, size_t size, void **rptr)
 	return EOK;
 }
 
+/** Switch the IPC test service session to shared-memory ring mode.
+ *
+ * The session cannot be used for other requests until the ring is
+ * destroyed with async_ring_destroy().
+ *
+ * @param test IPC test service
+ * @param rring Place to store pointer to the ring
+ * @return EOK on success or an error code
+ */
+errno_t ipc_test_ring_create(ipc_test_t *test, async_ring_t **rring)
+{
+	return async_ring_create(test->sess, IPC_TEST_RING, rring);
+}
+
+/** Submit ping to the ring.
+ *
+ * @param ring Ring created by ipc_test_ring_create()
+ * @return EOK on success or an error code
+ */
+errno_t ipc_test_ring_ping_submit(async_ring_t *ring)
+{
+	ipc_call_t req;
+
+	memset(&req, 0, sizeof(req));
+	ipc_set_imethod(&req, IPC_TEST_PING);
+	return async_ring_submit(ring, &req);
+}
+
+/** Reap answer to a ping submitted to the ring.
+ *
+ * @param ring Ring created by ipc_test_ring_create()
+ * @return EOK on success or an error code
+ */
+errno_t ipc_test_ring_ping_reap(async_ring_t *ring)
+{
+	ipc_call_t answer;
+	errno_t rc;
+
+	rc = async_ring_reap(ring, &answer);
+	if (rc != EOK)
+		return rc;
+
+	return ipc_get_retval(&answer);
+}
+
 /** @}
  */
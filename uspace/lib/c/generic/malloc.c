@@ -46,6 +46,7 @@
 #include <mem.h>
 #include <stdlib.h>
 #include <adt/gcdlcm.h>
+#include <adt/list.h>
 
 #include "private/malloc.h"
 #include "private/fibril.h"
@@ -77,6 +78,51 @@
  */
 #define SHRINK_GRANULARITY  (64 * PAGE_SIZE)
 
+/** Number of size classes served by the slabs
+ *
+ * Class i holds objects of (i + 1) * BASE_ALIGN bytes.
+ *
+ */
+#define CACHE_CLASS_COUNT  32
+
+/** Largest allocation served by the slabs. */
+#define CACHE_CLASS_MAX  (CACHE_CLASS_COUNT * BASE_ALIGN)
+
+/** Number of independently locked allocation caches. */
+#define CACHE_COUNT  8
+
+/** Approximate number of bytes kept in one cache bin. */
+#define CACHE_BIN_SIZE  1024
+
+/** Minimal number of blocks kept in one cache bin. */
+#define CACHE_BIN_MIN  4
+
+/** Magic used in slab headers. */
+#define SLAB_MAGIC  UINT32_C(0xBEEF0303)
+
+/** Size of one slab
+ *
+ * Each slab holds objects of a single size class.
+ *
+ */
+#define SLAB_SIZE  PAGE_SIZE
+
+/** Size of the address space region reserved for slabs
+ *
+ * The region is reserved lazily, i.e. only the slabs
+ * actually used consume physical memory. Once the region
+ * is exhausted, small allocations fall back to the heap.
+ *
+ */
+#define SLAB_REGION_SIZE  (32 * 1024 * 1024)
+
+/** Offset of the first object in a slab. */
+#define SLAB_OBJECTS_OFFSET  ALIGN_UP(sizeof(slab_t), BASE_ALIGN)
+
+/** Get slab containing an object. */
+#define SLAB_OF(obj) \
+	((slab_t *) ALIGN_DOWN((uintptr_t) (obj), SLAB_SIZE))
+
 /** Overhead of each heap block. */
 #define STRUCT_OVERHEAD \
 	(sizeof(heap_block_head_t) + sizeof(heap_block_foot_t))
@@ -197,6 +243,73 @@ static heap_block_head_t *next_fit = NULL;
 /** Futex for thread-safe heap manipulation */
 static fibril_rmutex_t malloc_mutex;
 
+/** Header of a slab
+ *
+ * Slabs hold small objects of a single size class without
+ * any per-object overhead. Free objects are linked through
+ * their first word.
+ *
+ */
+typedef struct {
+	/* A magic value to detect overwrite of slab header */
+	uint32_t magic;
+
+	/* Size class of the objects */
+	unsigned int cls;
+
+	/* Number of allocated objects */
+	size_t used;
+
+	/* First free object */
+	void *free;
+
+	/* Link to the list of partial slabs of the class or of empty slabs */
+	link_t link;
+} slab_t;
+
+/** Region of the address space holding the slabs */
+static void *slab_region = NULL;
+
+/** End of the slab region */
+static void *slab_region_end = NULL;
+
+/** First slab in the region which has never been used */
+static void *slab_region_top = NULL;
+
+/** Slabs with at least one free object, per size class */
+static list_t slab_partial[CACHE_CLASS_COUNT];
+
+/** Slabs with no allocated objects */
+static list_t slab_empty;
+
+/** Futex for thread-safe slab manipulation */
+static fibril_rmutex_t slab_mutex;
+
+/** Bin of cached blocks of one size class
+ *
+ * The blocks are linked through their first word.
+ *
+ */
+typedef struct {
+	void *head;
+	size_t count;
+} cache_bin_t;
+
+/** Allocation cache
+ *
+ * Small objects are recycled through the caches. The slab lock is
+ * only taken to refill or flush a whole batch of objects. Several
+ * caches are used so that threads running in parallel do not contend
+ * on a single lock.
+ *
+ */
+typedef struct {
+	fibril_rmutex_t lock;
+	cache_bin_t bin[CACHE_CLASS_COUNT];
+} malloc_cache_t;
+
+static malloc_cache_t malloc_caches[CACHE_COUNT];
+
 #define malloc_assert(expr) safe_assert(expr)
 
 /*
@@ -483,6 +596,30 @@ static void heap_shrink(heap_area_t *area)
 	next_fit = NULL;
 }
 
+/** Create the slab region
+ *
+ * Failure is not fatal, all allocations are then
+ * served by the heap.
+ *
+ */
+static void slab_region_create(void)
+{
+	for (unsigned int i = 0; i < CACHE_CLASS_COUNT; i++)
+		list_initialize(&slab_partial[i]);
+
+	list_initialize(&slab_empty);
+
+	void *region = as_area_create(AS_AREA_ANY, SLAB_REGION_SIZE,
+	    AS_AREA_WRITE | AS_AREA_READ | AS_AREA_CACHEABLE |
+	    AS_AREA_LATE_RESERVE, AS_AREA_UNPAGED);
+	if (region == AS_MAP_FAILED)
+		return;
+
+	slab_region = region;
+	slab_region_end = region + SLAB_REGION_SIZE;
+	slab_region_top = region;
+}
+
 /** Initialize the heap allocator
  *
  * Create initial heap memory area. This routine is
@@ -495,12 +632,26 @@ void __malloc_init(void)
 	if (fibril_rmutex_initialize(&malloc_mutex) != EOK)
 		abort();
 
+	for (unsigned int i = 0; i < CACHE_COUNT; i++) {
+		if (fibril_rmutex_initialize(&malloc_caches[i].lock) != EOK)
+			abort();
+	}
+
+	if (fibril_rmutex_initialize(&slab_mutex) != EOK)
+		abort();
+
 	if (!area_create(PAGE_SIZE))
 		abort();
+
+	slab_region_create();
 }
 
 void __malloc_fini(void)
 {
+	for (unsigned int i = 0; i < CACHE_COUNT; i++)
+		fibril_rmutex_destroy(&malloc_caches[i].lock);
+
+	fibril_rmutex_destroy(&slab_mutex);
 	fibril_rmutex_destroy(&malloc_mutex);
 }
 
@@ -772,6 +923,348 @@ static void *malloc_internal(const size_t size, const size_t align)
 	return heap_grow_and_alloc(gross_size, falign);
 }
 
+/** Free a memory block
+ *
+ * Should be called only inside the critical section.
+ *
+ * @param addr The address of the block.
+ *
+ */
+static void free_internal(void *const addr)
+{
+	/* Calculate the position of the header. */
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+
+	block_check(head);
+	malloc_assert(!head->free);
+
+	heap_area_t *area = head->area;
+
+	area_check(area);
+	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
+	malloc_assert((void *) head < area->end);
+
+	/* Mark the block itself as free. */
+	head->free = true;
+
+	/* Look at the next block. If it is free, merge the two. */
+	heap_block_head_t *next_head =
+	    (heap_block_head_t *) (((void *) head) + head->size);
+
+	if ((void *) next_head < area->end) {
+		block_check(next_head);
+		if (next_head->free)
+			block_init(head, head->size + next_head->size, true, area);
+	}
+
+	/* Look at the previous block. If it is free, merge the two. */
+	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
+		heap_block_foot_t *prev_foot =
+		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
+
+		heap_block_head_t *prev_head =
+		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
+
+		block_check(prev_head);
+
+		if (prev_head->free)
+			block_init(prev_head, prev_head->size + head->size, true,
+			    area);
+	}
+
+	heap_shrink(area);
+}
+
+/** Get size class of an allocation request
+ *
+ * @param size Number of bytes requested (at most CACHE_CLASS_MAX).
+ *
+ * @return Size class serving the request.
+ *
+ */
+static inline unsigned int cache_class(size_t size)
+{
+	if (size == 0)
+		return 0;
+
+	return (size - 1) / BASE_ALIGN;
+}
+
+/** Get net size of blocks in a size class */
+static inline size_t cache_class_size(unsigned int cls)
+{
+	return (cls + 1) * BASE_ALIGN;
+}
+
+/** Get maximum number of blocks kept in a bin of a size class */
+static inline size_t cache_bin_limit(unsigned int cls)
+{
+	return max(CACHE_BIN_MIN, CACHE_BIN_SIZE / cache_class_size(cls));
+}
+
+/** Check whether an object belongs to the slab region */
+static inline bool slab_contains(const void *obj)
+{
+	return (obj >= slab_region) && (obj < slab_region_end);
+}
+
+/** Check that a slab header is valid
+ *
+ * @param slab Slab header to check.
+ *
+ */
+static void slab_check(slab_t *slab)
+{
+	malloc_assert(slab->magic == SLAB_MAGIC);
+	malloc_assert(slab->cls < CACHE_CLASS_COUNT);
+}
+
+/** Set up a slab for a size class
+ *
+ * Should be called only with the slab lock held.
+ *
+ * @param cls Size class of the new slab.
+ *
+ * @return New slab with all objects free or NULL if
+ *         the slab region is exhausted.
+ *
+ */
+static slab_t *slab_create(unsigned int cls)
+{
+	slab_t *slab;
+
+	if (!list_empty(&slab_empty)) {
+		slab = list_get_instance(list_first(&slab_empty), slab_t, link);
+		list_remove(&slab->link);
+	} else {
+		if (slab_region_top == slab_region_end)
+			return NULL;
+
+		slab = (slab_t *) slab_region_top;
+		slab_region_top += SLAB_SIZE;
+	}
+
+	size_t size = cache_class_size(cls);
+	size_t count = (SLAB_SIZE - SLAB_OBJECTS_OFFSET) / size;
+	void *objects = ((void *) slab) + SLAB_OBJECTS_OFFSET;
+
+	slab->magic = SLAB_MAGIC;
+	slab->cls = cls;
+	slab->used = 0;
+	slab->free = NULL;
+	link_initialize(&slab->link);
+
+	/* Link the objects so that they are handed out in address order. */
+	for (size_t i = count; i > 0; i--) {
+		void *obj = objects + (i - 1) * size;
+
+		*((void **) obj) = slab->free;
+		slab->free = obj;
+	}
+
+	return slab;
+}
+
+/** Allocate an object from the slabs of a size class
+ *
+ * Should be called only with the slab lock held.
+ *
+ * @param cls Size class of the object.
+ *
+ * @return Allocated object or NULL.
+ *
+ */
+static void *slab_alloc(unsigned int cls)
+{
+	list_t *partial = &slab_partial[cls];
+
+	if (list_empty(partial)) {
+		slab_t *slab = slab_create(cls);
+		if (slab == NULL)
+			return NULL;
+
+		list_append(&slab->link, partial);
+	}
+
+	slab_t *slab = list_get_instance(list_first(partial), slab_t, link);
+	slab_check(slab);
+
+	void *obj = slab->free;
+	slab->free = *((void **) obj);
+	slab->used++;
+
+	/* Full slabs are not kept on any list. */
+	if (slab->free == NULL)
+		list_remove(&slab->link);
+
+	return obj;
+}
+
+/** Return an object to its slab
+ *
+ * Should be called only with the slab lock held.
+ *
+ * @param obj Object to free.
+ *
+ */
+static void slab_free(void *obj)
+{
+	slab_t *slab = SLAB_OF(obj);
+	slab_check(slab);
+	malloc_assert(slab->used > 0);
+
+	if (slab->free == NULL)
+		list_prepend(&slab->link, &slab_partial[slab->cls]);
+
+	*((void **) obj) = slab->free;
+	slab->free = obj;
+	slab->used--;
+
+	/* Empty slabs can be reused by any size class. */
+	if (slab->used == 0) {
+		list_remove(&slab->link);
+		list_prepend(&slab->link, &slab_empty);
+	}
+}
+
+/** Lock an allocation cache
+ *
+ * The fibril sticks to the cache it used last as long as it is not
+ * contended. Otherwise it moves on to the next uncontended cache. This
+ * way, single-threaded tasks only ever use the first cache.
+ *
+ * @return Locked allocation cache.
+ *
+ */
+static malloc_cache_t *cache_lock(void)
+{
+	fibril_t *fibril = fibril_self();
+	unsigned int home = fibril->malloc_cache;
+
+	for (unsigned int i = 0; i < CACHE_COUNT; i++) {
+		unsigned int idx = (home + i) % CACHE_COUNT;
+
+		if (fibril_rmutex_trylock(&malloc_caches[idx].lock)) {
+			fibril->malloc_cache = idx;
+			return &malloc_caches[idx];
+		}
+	}
+
+	fibril_rmutex_lock(&malloc_caches[home].lock);
+	return &malloc_caches[home];
+}
+
+static inline void cache_unlock(malloc_cache_t *cache)
+{
+	fibril_rmutex_unlock(&cache->lock);
+}
+
+/** Refill a cache bin from the slabs
+ *
+ * Should be called only with the cache locked.
+ *
+ * @param bin Cache bin to refill.
+ * @param cls Size class of the bin.
+ *
+ */
+static void cache_refill(cache_bin_t *bin, unsigned int cls)
+{
+	size_t batch = cache_bin_limit(cls) / 2;
+
+	fibril_rmutex_lock(&slab_mutex);
+
+	while (bin->count < batch) {
+		void *block = slab_alloc(cls);
+		if (block == NULL)
+			break;
+
+		*((void **) block) = bin->head;
+		bin->head = block;
+		bin->count++;
+	}
+
+	fibril_rmutex_unlock(&slab_mutex);
+}
+
+/** Return half of a cache bin to the slabs
+ *
+ * Should be called only with the cache locked.
+ *
+ * @param bin Cache bin to flush.
+ * @param cls Size class of the bin.
+ *
+ */
+static void cache_flush(cache_bin_t *bin, unsigned int cls)
+{
+	size_t keep = cache_bin_limit(cls) / 2;
+
+	fibril_rmutex_lock(&slab_mutex);
+
+	while (bin->count > keep) {
+		void *block = bin->head;
+
+		bin->head = *((void **) block);
+		bin->count--;
+
+		slab_free(block);
+	}
+
+	fibril_rmutex_unlock(&slab_mutex);
+}
+
+/** Allocate a small object through the allocation caches
+ *
+ * @param size Number of bytes to allocate (at most CACHE_CLASS_MAX).
+ *
+ * @return Allocated memory or NULL if the slab region is exhausted.
+ *
+ */
+static void *cache_alloc(size_t size)
+{
+	unsigned int cls = cache_class(size);
+
+	malloc_cache_t *cache = cache_lock();
+	cache_bin_t *bin = &cache->bin[cls];
+
+	if (bin->count == 0)
+		cache_refill(bin, cls);
+
+	void *block = bin->head;
+	if (block != NULL) {
+		bin->head = *((void **) block);
+		bin->count--;
+	}
+
+	cache_unlock(cache);
+	return block;
+}
+
+/** Free a small object to the allocation caches
+ *
+ * @param block Object to free (from the slab region).
+ *
+ */
+static void cache_free(void *block)
+{
+	slab_t *slab = SLAB_OF(block);
+	slab_check(slab);
+
+	unsigned int cls = slab->cls;
+
+	malloc_cache_t *cache = cache_lock();
+	cache_bin_t *bin = &cache->bin[cls];
+
+	*((void **) block) = bin->head;
+	bin->head = block;
+	bin->count++;
+
+	if (bin->count > cache_bin_limit(cls))
+		cache_flush(bin, cls);
+
+	cache_unlock(cache);
+}
+
 /** Allocate memory by number of elements
  *
  * @param nmemb Number of members to allocate.
@@ -801,6 +1294,12 @@ void *calloc(const size_t nmemb, const size_t size)
  */
 void *malloc(const size_t size)
 {
+	if (size <= CACHE_CLASS_MAX) {
+		void *block = cache_alloc(size);
+		if (block != NULL)
+			return block;
+	}
+
 	heap_lock();
 	void *block = malloc_internal(size, BASE_ALIGN);
 	heap_unlock();
@@ -824,6 +1323,10 @@ void *memalign(const size_t align, const size_t size)
 	size_t palign =
 	    1 << (fnzb(max(sizeof(void *), align) - 1) + 1);
 
+	/* Slab objects are aligned on BASE_ALIGN. */
+	if (palign <= BASE_ALIGN)
+		return malloc(size);
+
 	heap_lock();
 	void *block = malloc_internal(size, palign);
 	heap_unlock();
@@ -849,6 +1352,23 @@ void *realloc(void *const addr, const size_t size)
 	if (addr == NULL)
 		return malloc(size);
 
+	if (slab_contains(addr)) {
+		slab_t *slab = SLAB_OF(addr);
+		slab_check(slab);
+
+		size_t orig_size = cache_class_size(slab->cls);
+		if (size <= orig_size)
+			return addr;
+
+		void *ptr = malloc(size);
+		if (ptr != NULL) {
+			memcpy(ptr, addr, orig_size);
+			free(addr);
+		}
+
+		return ptr;
+	}
+
 	heap_lock();
 
 	/* Calculate the position of the header. */
@@ -958,56 +1478,54 @@ void free(void *const addr)
 	if (addr == NULL)
 		return;
 
-	heap_lock();
-
-	/* Calculate the position of the header. */
-	heap_block_head_t *head =
-	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
-
-	block_check(head);
-	malloc_assert(!head->free);
-
-	heap_area_t *area = head->area;
-
-	area_check(area);
-	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
-	malloc_assert((void *) head < area->end);
+	if (slab_contains(addr)) {
+		cache_free(addr);
+		return;
+	}
 
-	/* Mark the block itself as free. */
-	head->free = true;
+	heap_lock();
+	free_internal(addr);
+	heap_unlock();
+}
 
-	/* Look at the next block. If it is free, merge the two. */
-	heap_block_head_t *next_head =
-	    (heap_block_head_t *) (((void *) head) + head->size);
+void *heap_check(void)
+{
+	/* Check the objects held by the allocation caches */
+	for (unsigned int i = 0; i < CACHE_COUNT; i++) {
+		fibril_rmutex_lock(&malloc_caches[i].lock);
+
+		for (unsigned int cls = 0; cls < CACHE_CLASS_COUNT; cls++) {
+			for (void *block = malloc_caches[i].bin[cls].head;
+			    block != NULL; block = *((void **) block)) {
+				slab_t *slab = SLAB_OF(block);
+
+				if ((!slab_contains(block)) ||
+				    (slab->magic != SLAB_MAGIC) ||
+				    (slab->cls != cls)) {
+					fibril_rmutex_unlock(&malloc_caches[i].lock);
+					return block;
+				}
+			}
+		}
 
-	if ((void *) next_head < area->end) {
-		block_check(next_head);
-		if (next_head->free)
-			block_init(head, head->size + next_head->size, true, area);
+		fibril_rmutex_unlock(&malloc_caches[i].lock);
 	}
 
-	/* Look at the previous block. If it is free, merge the two. */
-	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
-		heap_block_foot_t *prev_foot =
-		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
-
-		heap_block_head_t *prev_head =
-		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
-
-		block_check(prev_head);
+	/* Check the slabs with free objects */
+	fibril_rmutex_lock(&slab_mutex);
 
-		if (prev_head->free)
-			block_init(prev_head, prev_head->size + head->size, true,
-			    area);
+	for (unsigned int cls = 0; cls < CACHE_CLASS_COUNT; cls++) {
+		list_foreach(slab_partial[cls], link, slab_t, slab) {
+			if ((slab->magic != SLAB_MAGIC) || (slab->cls != cls) ||
+			    (slab->free == NULL)) {
+				fibril_rmutex_unlock(&slab_mutex);
+				return (void *) slab;
+			}
+		}
 	}
 
-	heap_shrink(area);
+	fibril_rmutex_unlock(&slab_mutex);
 
-	heap_unlock();
-}
-
-void *heap_check(void)
-{
 	heap_lock();
 
 	if (first_heap_area == NULL) {
@@ -67,6 +67,9 @@ struct fibril {
 	/* In some places, we use fibril structs that can't be freed. */
 	bool is_freeable : 1;
 
+	/* Index of the malloc cache the fibril used last. */
+	unsigned int malloc_cache;
+
 	/* Debugging stuff. */
 	int rmutex_locks;
 	fibril_owner_info_t *waits_for;
@@ -126,6 +126,17 @@ static inline void _ready_up(void)
 	}
 }
 
+static inline void _ready_up_n(size_t n)
+{
+	if (multithreaded) {
+		for (size_t i = 0; i < n; i++)
+			futex_up(&ready_semaphore);
+	} else {
+		ready_st_count += n;
+		_ready_debug_check();
+	}
+}
+
 static inline errno_t _ready_down(const struct timespec *expires)
 {
 	if (multithreaded)
@@ -136,8 +147,28 @@ static inline errno_t _ready_down(const struct timespec *expires)
 	return EOK;
 }
 
+/*
+ * Takes an additional token without blocking. Used by the thread which has
+ * already taken one token and is reserving call buffers in
+ * _ipc_buffer_reserve(), so the debug check does not apply here.
+ */
+static inline bool _ready_try_down(void)
+{
+	if (multithreaded)
+		return futex_trydown(&ready_semaphore);
+
+	if (ready_st_count <= 0)
+		return false;
+
+	ready_st_count--;
+	return true;
+}
+
 static atomic_int threads_in_ipc_wait;
 
+/** Maximum number of IPC items received by a thread in one syscall. */
+#define IPC_WAIT_BATCH 16
+
 /** Function that spans the whole life-cycle of a fibril.
  *
  * Each fibril begins execution in this function. Then the function implementing
@@ -237,22 +268,76 @@ static fibril_t *_fibril_trigger_internal(fibril_event_t *event, fibril_t *reaso
 	return f;
 }
 
-static errno_t _ipc_wait(ipc_call_t *call, const struct timespec *expires)
+static errno_t _ipc_wait(ipc_call_t *calls, size_t count, size_t *received,
+    const struct timespec *expires)
 {
-	if (!expires)
-		return ipc_wait(call, SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NONE);
+	if (!expires) {
+		return ipc_wait_batch(calls, count, received, SYNCH_NO_TIMEOUT,
+		    SYNCH_FLAGS_NONE);
+	}
 
-	if (expires->tv_sec == 0)
-		return ipc_wait(call, SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NON_BLOCKING);
+	if (expires->tv_sec == 0) {
+		return ipc_wait_batch(calls, count, received, SYNCH_NO_TIMEOUT,
+		    SYNCH_FLAGS_NON_BLOCKING);
+	}
 
 	struct timespec now;
 	getuptime(&now);
 
-	if (ts_gteq(&now, expires))
-		return ipc_wait(call, SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NON_BLOCKING);
+	if (ts_gteq(&now, expires)) {
+		return ipc_wait_batch(calls, count, received, SYNCH_NO_TIMEOUT,
+		    SYNCH_FLAGS_NON_BLOCKING);
+	}
+
+	return ipc_wait_batch(calls, count, received,
+	    NSEC2USEC(ts_sub_diff(expires, &now)), SYNCH_FLAGS_NONE);
+}
+
+/*
+ * Reserves call buffers for an IPC wait, one for the token the caller has
+ * already taken and one for each additional token it manages to take, up to
+ * IPC_WAIT_BATCH. Must be called after finding ready_list empty while still
+ * holding fibril_futex, which _ready_list_push() takes as well, so none of
+ * the tokens left in ready_semaphore belongs to a ready fibril.
+ */
+static size_t _ipc_buffer_reserve(list_t *reserved)
+{
+	futex_assert_is_locked(&fibril_futex);
+
+	futex_lock(&ipc_lists_futex);
+
+	size_t count = 0;
+
+	do {
+		_ipc_buffer_t *buf = list_pop(&ipc_buffer_free_list,
+		    _ipc_buffer_t, link);
+		assert(buf);
+		list_append(&buf->link, reserved);
+		count++;
+	} while (count < IPC_WAIT_BATCH &&
+	    !list_empty(&ipc_buffer_free_list) && _ready_try_down());
+
+	futex_unlock(&ipc_lists_futex);
+
+	return count;
+}
+
+static void _ready_list_push(fibril_t *f)
+{
+	if (!f)
+		return;
+
+	futex_assert_is_locked(&fibril_futex);
+
+	/* Enqueue in ready_list. */
+	list_append(&f->link, &ready_list);
+	_ready_up();
 
-	return ipc_wait(call, NSEC2USEC(ts_sub_diff(expires, &now)),
-	    SYNCH_FLAGS_NONE);
+	if (atomic_load_explicit(&threads_in_ipc_wait, memory_order_relaxed)) {
+		DPRINTF("Poking.\n");
+		/* Wakeup one thread sleeping in SYS_IPC_WAIT. */
+		ipc_poke();
+	}
 }
 
 /*
@@ -282,12 +367,25 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 	 * for each entry of the call buffer.
 	 */
 
+	/*
+	 * If no fibril is ready, IPC wait it is. Besides our token, try to
+	 * take a few more so that everything which is already pending in the
+	 * answerbox can be received with a single syscall. Each token comes
+	 * with a reserved call buffer. Each item we receive consumes one
+	 * token and buffer, the rest is returned below.
+	 */
+	list_t reserved;
+	list_initialize(&reserved);
+	size_t tokens = 0;
+
 	if (!locked)
 		futex_lock(&fibril_futex);
 	fibril_t *f = list_pop(&ready_list, fibril_t, link);
-	if (!f)
+	if (!f) {
 		atomic_fetch_add_explicit(&threads_in_ipc_wait, 1,
 		    memory_order_relaxed);
+		tokens = _ipc_buffer_reserve(&reserved);
+	}
 	if (!locked)
 		futex_unlock(&fibril_futex);
 
@@ -297,16 +395,19 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 	if (!multithreaded)
 		assert(list_empty(&ipc_buffer_list));
 
-	/* No fibril is ready, IPC wait it is. */
-	ipc_call_t call = { 0 };
-	rc = _ipc_wait(&call, expires);
+	ipc_call_t calls[IPC_WAIT_BATCH];
+	size_t received = 0;
+	rc = _ipc_wait(calls, tokens, &received, expires);
 
 	atomic_fetch_sub_explicit(&threads_in_ipc_wait, 1,
 	    memory_order_relaxed);
 
 	if (rc != EOK && rc != ENOENT) {
-		/* Return token. */
-		_ready_up();
+		/* Return buffers and tokens. */
+		futex_lock(&ipc_lists_futex);
+		list_concat(&ipc_buffer_free_list, &reserved);
+		_ready_up_n(tokens);
+		futex_unlock(&ipc_lists_futex);
 		return NULL;
 	}
 
@@ -315,12 +416,18 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 	 * In that case, we propagate the null call out of fibril_ipc_wait(),
 	 * because poke must result in that call returning.
 	 */
+	if (rc == ENOENT) {
+		calls[0] = (ipc_call_t) { 0 };
+		received = 1;
+	}
+
+	assert(received > 0 && received <= tokens);
 
 	/*
-	 * If a fibril is already waiting for IPC, we wake up the fibril,
-	 * and return the token to ready_semaphore.
-	 * If there is no fibril waiting, we pop a buffer bucket and
-	 * put our call there. The token then returns when the bucket is
+	 * For each received item, if a fibril is already waiting for IPC, we
+	 * wake up the fibril, and return the token to ready_semaphore.
+	 * If there is no fibril waiting, we take a reserved buffer bucket and
+	 * put the item there. The token then returns when the bucket is
 	 * returned.
 	 */
 
@@ -329,24 +436,48 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 
 	futex_lock(&ipc_lists_futex);
 
-	_ipc_waiter_t *w = list_pop(&ipc_waiter_list, _ipc_waiter_t, link);
-	if (w) {
-		*w->call = call;
-		w->rc = rc;
-		/* We switch to the woken up fibril immediately if possible. */
-		f = _fibril_trigger_internal(&w->event, _EVENT_TRIGGERED);
-
-		/* Return token. */
-		_ready_up();
-	} else {
-		_ipc_buffer_t *buf = list_pop(&ipc_buffer_free_list, _ipc_buffer_t, link);
-		assert(buf);
-		*buf = (_ipc_buffer_t) { .call = call, .rc = rc };
-		list_append(&buf->link, &ipc_buffer_list);
+	fibril_t *woken[IPC_WAIT_BATCH];
+	size_t nwoken = 0;
+	size_t unused = tokens;
+
+	for (size_t i = 0; i < received; i++) {
+		_ipc_waiter_t *w = list_pop(&ipc_waiter_list, _ipc_waiter_t,
+		    link);
+		if (w) {
+			*w->call = calls[i];
+			w->rc = rc;
+			woken[nwoken++] = _fibril_trigger_internal(&w->event,
+			    _EVENT_TRIGGERED);
+		} else {
+			_ipc_buffer_t *buf = list_pop(&reserved,
+			    _ipc_buffer_t, link);
+			assert(buf);
+			*buf = (_ipc_buffer_t) { .call = calls[i], .rc = rc };
+			list_append(&buf->link, &ipc_buffer_list);
+			unused--;
+		}
 	}
 
+	/*
+	 * Return buffers and tokens of items passed directly and of unused
+	 * entries.
+	 */
+	list_concat(&ipc_buffer_free_list, &reserved);
+	_ready_up_n(unused);
+
 	futex_unlock(&ipc_lists_futex);
 
+	/*
+	 * We switch to the first woken up fibril immediately if possible,
+	 * the others are made ready.
+	 */
+	for (size_t i = 0; i < nwoken; i++) {
+		if (!f)
+			f = woken[i];
+		else
+			_ready_list_push(woken[i]);
+	}
+
 	if (!locked)
 		futex_unlock(&fibril_futex);
 
@@ -359,24 +490,6 @@ static fibril_t *_ready_list_pop_nonblocking(bool locked)
 	return _ready_list_pop(&tv, locked);
 }
 
-static void _ready_list_push(fibril_t *f)
-{
-	if (!f)
-		return;
-
-	futex_assert_is_locked(&fibril_futex);
-
-	/* Enqueue in ready_list. */
-	list_append(&f->link, &ready_list);
-	_ready_up();
-
-	if (atomic_load_explicit(&threads_in_ipc_wait, memory_order_relaxed)) {
-		DPRINTF("Poking.\n");
-		/* Wakeup one thread sleeping in SYS_IPC_WAIT. */
-		ipc_poke();
-	}
-}
-
 /* Blocks the current fibril until an IPC call arrives. */
 static errno_t _wait_ipc(ipc_call_t *call, const struct timespec *expires)
 {
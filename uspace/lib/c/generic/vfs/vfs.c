@@ -883,8 +883,8 @@ errno_t vfs_read_short(int file, aoff64_t pos, void *buf, size_t nbyte,
 	ipc_call_t answer;
 	aid_t req;
 
-	if (nbyte > DATA_XFER_LIMIT)
-		nbyte = DATA_XFER_LIMIT;
+	if (nbyte > DATA_XFER_LIMIT_PINNED)
+		nbyte = DATA_XFER_LIMIT_PINNED;
 
 	async_exch_t *exch = vfs_exchange_begin();
 
@@ -1347,6 +1347,10 @@ errno_t vfs_write_short(int file, aoff64_t pos, const void *buf, size_t nbyte,
 	ipc_call_t answer;
 	aid_t req;
 
+	/*
+	 * The kernel checks the whole source buffer when the request is sent,
+	 * keep that bounded as the file system may accept much less.
+	 */
 	if (nbyte > DATA_XFER_LIMIT)
 		nbyte = DATA_XFER_LIMIT;
 
@@ -40,6 +40,10 @@
 
 extern uint32_t compute_crc32(uint8_t *, size_t);
 extern uint32_t compute_crc32_seed(uint8_t *, size_t, uint32_t);
+extern uint32_t compute_crc32c(const void *, size_t);
+extern uint32_t compute_crc32c_seed(const void *, size_t, uint32_t);
+extern uint32_t crc32_combine(uint32_t, uint32_t, uint64_t);
+extern uint32_t crc32c_combine(uint32_t, uint32_t, uint64_t);
 
 #endif
 
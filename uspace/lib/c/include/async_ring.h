@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Shared-memory request/completion rings
+ */
+
+#ifndef _LIBC_ASYNC_RING_H_
+#define _LIBC_ASYNC_RING_H_
+
+#include <async.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/** Number of entries in each of the submission and completion rings */
+#define ASYNC_RING_ENTRIES  32
+
+/** Ring entry carrying a request or its answer
+ *
+ * Requests carry the interface method and its arguments, answers carry
+ * the return value and return arguments, both laid out as in ipc_call_t.
+ *
+ */
+typedef struct {
+	sysarg_t args[IPC_CALL_LEN];
+} async_ring_entry_t;
+
+/** Producer and consumer positions of one ring
+ *
+ * The positions are free-running, the entry index is obtained by taking
+ * them modulo ASYNC_RING_ENTRIES.
+ *
+ */
+typedef struct {
+	atomic_uint head;
+	atomic_uint tail;
+} async_ring_pos_t;
+
+/** Layout of the memory area shared between the client and the server */
+typedef struct {
+	/** Submission ring, produced by the client. */
+	async_ring_pos_t sq;
+	/** Completion ring, produced by the server. */
+	async_ring_pos_t cq;
+	/** The server is blocked or about to block waiting for a doorbell. */
+	atomic_bool sleeping;
+
+	async_ring_entry_t sqe[ASYNC_RING_ENTRIES];
+	async_ring_entry_t cqe[ASYNC_RING_ENTRIES];
+} async_ring_shared_t;
+
+/** Client side of a ring */
+typedef struct {
+	/** Exchange held for the lifetime of the ring. */
+	async_exch_t *exch;
+	/** Shared memory area. */
+	async_ring_shared_t *shared;
+	/** Number of submitted requests whose answer has not been reaped. */
+	unsigned int inflight;
+} async_ring_t;
+
+/** Server-side handler of ring requests
+ *
+ * @param req    Request taken from the submission ring.
+ * @param answer Answer to be posted to the completion ring. It is zeroed
+ *               before the handler is called.
+ * @param arg    Argument passed to async_ring_serve().
+ *
+ */
+typedef void (*async_ring_handler_t)(ipc_call_t *, ipc_call_t *, void *);
+
+extern errno_t async_ring_create(async_sess_t *, sysarg_t, async_ring_t **);
+extern void async_ring_destroy(async_ring_t *);
+extern errno_t async_ring_submit(async_ring_t *, const ipc_call_t *);
+extern errno_t async_ring_reap(async_ring_t *, ipc_call_t *);
+extern errno_t async_ring_req(async_ring_t *, const ipc_call_t *,
+    ipc_call_t *);
+
+extern errno_t async_ring_serve(ipc_call_t *, async_ring_handler_t, void *);
+
+#endif
+
+/** @}
+ */
@@ -61,6 +61,11 @@ typedef struct {
 	unsigned int instance;
 	bool concurrent_read_write;
 	bool write_retains_size;
+	/**
+	 * Contents of regular files may be kept in the VFS page cache. Only
+	 * set by file systems whose files change exclusively through VFS.
+	 */
+	bool page_cache;
 } vfs_info_t;
 
 /** Data returned by filesystem probe regarding a specific volume. */
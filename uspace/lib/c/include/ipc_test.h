@@ -36,6 +36,7 @@
 #define _LIBC_IPC_TEST_H_
 
 #include <async.h>
+#include <async_ring.h>
 #include <errno.h>
 
 typedef struct {
@@ -49,6 +50,9 @@ extern errno_t ipc_test_get_ro_area_size(ipc_test_t *, size_t *);
 extern errno_t ipc_test_get_rw_area_size(ipc_test_t *, size_t *);
 extern errno_t ipc_test_share_in_ro(ipc_test_t *, size_t, const void **);
 extern errno_t ipc_test_share_in_rw(ipc_test_t *, size_t, void **);
+extern errno_t ipc_test_ring_create(ipc_test_t *, async_ring_t **);
+extern errno_t ipc_test_ring_ping_submit(async_ring_t *);
+extern errno_t ipc_test_ring_ping_reap(async_ring_t *);
 
 #endif
 
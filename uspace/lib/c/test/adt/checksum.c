@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <adt/checksum.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(checksum);
+
+enum {
+	buffer_size = 4096
+};
+
+static uint8_t buffer[buffer_size];
+
+static uint8_t check_string[] = "123456789";
+
+/** Bit-by-bit reference implementation. */
+static uint32_t crc_reference(uint32_t poly, const uint8_t *data,
+    size_t length)
+{
+	uint32_t crc = ~UINT32_C(0);
+
+	while (length > 0) {
+		crc ^= *data;
+		for (unsigned int i = 0; i < 8; i++)
+			crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+
+		data++;
+		length--;
+	}
+
+	return ~crc;
+}
+
+static void buffer_fill(void)
+{
+	uint32_t state = 1;
+
+	for (size_t i = 0; i < buffer_size; i++) {
+		state = state * 1103515245 + 12345;
+		buffer[i] = state >> 16;
+	}
+}
+
+/** Standard check values of both polynomials. */
+PCUT_TEST(check_value)
+{
+	PCUT_ASSERT_INT_EQUALS(0xcbf43926,
+	    compute_crc32(check_string, sizeof(check_string) - 1));
+	PCUT_ASSERT_INT_EQUALS(0xe3069283,
+	    compute_crc32c(check_string, sizeof(check_string) - 1));
+	PCUT_ASSERT_INT_EQUALS(0, compute_crc32(buffer, 0));
+	PCUT_ASSERT_INT_EQUALS(0, compute_crc32c(buffer, 0));
+}
+
+/** All code paths agree with the reference for any length and alignment. */
+PCUT_TEST(reference)
+{
+	buffer_fill();
+
+	for (size_t length = 0; length < 300; length++) {
+		for (size_t off = 0; off < 16; off += 5) {
+			PCUT_ASSERT_INT_EQUALS(
+			    crc_reference(0xedb88320, buffer + off, length),
+			    compute_crc32(buffer + off, length));
+			PCUT_ASSERT_INT_EQUALS(
+			    crc_reference(0x82f63b78, buffer + off, length),
+			    compute_crc32c(buffer + off, length));
+		}
+	}
+
+	PCUT_ASSERT_INT_EQUALS(crc_reference(0xedb88320, buffer, buffer_size),
+	    compute_crc32(buffer, buffer_size));
+	PCUT_ASSERT_INT_EQUALS(crc_reference(0x82f63b78, buffer, buffer_size),
+	    compute_crc32c(buffer, buffer_size));
+}
+
+/** Checksumming in pieces gives the same result as in one go. */
+PCUT_TEST(streaming)
+{
+	buffer_fill();
+
+	uint32_t crc32 = compute_crc32(buffer, buffer_size);
+	uint32_t crc32c = compute_crc32c(buffer, buffer_size);
+
+	for (size_t split = 0; split <= buffer_size; split += 97) {
+		uint32_t part = compute_crc32(buffer, split);
+		PCUT_ASSERT_INT_EQUALS(crc32, compute_crc32_seed(buffer + split,
+		    buffer_size - split, part));
+
+		part = compute_crc32c(buffer, split);
+		PCUT_ASSERT_INT_EQUALS(crc32c, compute_crc32c_seed(
+		    buffer + split, buffer_size - split, part));
+	}
+}
+
+/** Checksums of adjacent blocks can be combined. */
+PCUT_TEST(combine)
+{
+	buffer_fill();
+
+	uint32_t crc32 = compute_crc32(buffer, buffer_size);
+	uint32_t crc32c = compute_crc32c(buffer, buffer_size);
+
+	for (size_t split = 0; split <= buffer_size; split += 97) {
+		size_t len2 = buffer_size - split;
+
+		PCUT_ASSERT_INT_EQUALS(crc32, crc32_combine(
+		    compute_crc32(buffer, split),
+		    compute_crc32(buffer + split, len2), len2));
+		PCUT_ASSERT_INT_EQUALS(crc32c, crc32c_combine(
+		    compute_crc32c(buffer, split),
+		    compute_crc32c(buffer + split, len2), len2));
+	}
+}
+
+PCUT_EXPORT(checksum);
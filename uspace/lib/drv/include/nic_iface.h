@@ -42,9 +42,23 @@
 typedef enum {
 	NIC_EV_ADDR_CHANGED = IPC_FIRST_USER_METHOD,
 	NIC_EV_RECEIVED,
-	NIC_EV_DEVICE_STATE
+	NIC_EV_DEVICE_STATE,
+	NIC_EV_RECEIVED_BATCH
 } nic_event_t;
 
+/** Alignment of frames in NIC_EV_RECEIVED_BATCH data */
+#define NIC_BATCH_ALIGN  4
+
+/** Header of a frame in NIC_EV_RECEIVED_BATCH data
+ *
+ * The header is followed by the frame data. The next header starts
+ * at the next multiple of NIC_BATCH_ALIGN.
+ */
+typedef struct {
+	/** Size of the frame data */
+	uint32_t size;
+} nic_batch_frame_t;
+
 extern errno_t nic_send_frame(async_sess_t *, void *, size_t);
 extern errno_t nic_callback_create(async_sess_t *, async_port_handler_t, void *);
 extern errno_t nic_get_state(async_sess_t *, nic_device_state_t *);
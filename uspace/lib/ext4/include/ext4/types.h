@@ -35,7 +35,9 @@
 #ifndef LIBEXT4_TYPES_H_
 #define LIBEXT4_TYPES_H_
 
+#include <adt/list.h>
 #include <block.h>
+#include <fibril_synch.h>
 
 /*
  * Structure of the super block
@@ -227,11 +229,29 @@ typedef struct ext4_superblock {
 	EXT4_FEATURE_RO_COMPAT_GDT_CSUM | \
 	EXT4_FEATURE_RO_COMPAT_EXTRA_ISIZE)
 
+/** Free space summary of a block group kept by the block allocator */
+typedef struct ext4_balloc_summary {
+	bool valid;        /* Summary matches the block bitmap */
+	uint32_t max_run;  /* Longest run of free blocks in the group */
+} ext4_balloc_summary_t;
+
+/** Blocks reserved by the block allocator for the next appends to a file */
+typedef struct ext4_balloc_prealloc {
+	link_t link;       /* Link in the list of the filesystem */
+	uint32_t index;    /* I-node the window belongs to */
+	uint32_t iblock;   /* Logical block the window continues */
+	uint32_t fblock;   /* First reserved physical block */
+	uint32_t count;    /* Number of reserved blocks */
+} ext4_balloc_prealloc_t;
+
 typedef struct ext4_filesystem {
 	service_id_t device;
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+	ext4_balloc_summary_t *bg_summary;  /* Per-group free space summaries */
+	list_t prealloc;                    /* Preallocation windows, MRU first */
+	fibril_mutex_t prealloc_lock;       /* Protects prealloc */
 } ext4_filesystem_t;
 
 /** Size of buffer for volume name. To hold 16 latin-1 chars encoded as UTF-8
@@ -35,9 +35,12 @@
  * @brief Physical block allocator.
  */
 
+#include <assert.h>
 #include <errno.h>
+#include <macros.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "ext4/balloc.h"
 #include "ext4/bitmap.h"
 #include "ext4/block_group.h"
@@ -46,6 +49,50 @@
 #include "ext4/superblock.h"
 #include "ext4/types.h"
 
+/** Number of blocks reserved ahead of a growing regular file */
+#define EXT4_BALLOC_PREALLOC  32
+
+/** Maximum number of preallocation windows kept by a filesystem */
+#define EXT4_BALLOC_PREALLOC_WINDOWS  16
+
+/** Get free space summary of a block group.
+ *
+ * Summaries are allocated on first use. When there is not enough memory
+ * for them, the allocator simply works without.
+ *
+ * @param fs   Filesystem
+ * @param bgid Index of block group
+ *
+ * @return Summary or NULL
+ *
+ */
+static ext4_balloc_summary_t *ext4_balloc_summary(ext4_filesystem_t *fs,
+    uint32_t bgid)
+{
+	if (fs->bg_summary == NULL) {
+		uint32_t count =
+		    ext4_superblock_get_block_group_count(fs->superblock);
+		fs->bg_summary = calloc(count, sizeof(ext4_balloc_summary_t));
+		if (fs->bg_summary == NULL)
+			return NULL;
+	}
+
+	return &fs->bg_summary[bgid];
+}
+
+/** Mark free space summary of a block group as out of date.
+ *
+ * @param fs   Filesystem
+ * @param bgid Index of block group whose bitmap was modified
+ *
+ */
+static void ext4_balloc_summary_invalidate(ext4_filesystem_t *fs,
+    uint32_t bgid)
+{
+	if (fs->bg_summary != NULL)
+		fs->bg_summary[bgid].valid = false;
+}
+
 /** Free block.
  *
  * @param inode_ref  Inode, where the block is allocated
@@ -83,6 +130,7 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	/* Modify bitmap */
 	ext4_bitmap_free_bit(bitmap_block->data, index_in_group);
 	bitmap_block->dirty = true;
+	ext4_balloc_summary_invalidate(fs, block_group);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -119,10 +167,20 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
-    uint32_t first, uint32_t count)
+/** Free continuous set of blocks within one block group.
+ *
+ * @param fs        Filesystem
+ * @param inode_ref Inode the blocks are accounted to or NULL if they are
+ *                  not accounted to any
+ * @param first     First block to release
+ * @param count     Number of blocks to release
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_free_blocks_internal(ext4_filesystem_t *fs,
+    ext4_inode_ref_t *inode_ref, uint32_t first, uint32_t count)
 {
-	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
 	/* Compute indexes */
@@ -156,6 +214,7 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	/* Modify bitmap */
 	ext4_bitmap_free_bits(bitmap_block->data, index_in_group_first, count);
 	bitmap_block->dirty = true;
+	ext4_balloc_summary_invalidate(fs, block_group_first);
 
 	/* Release block with bitmap */
 	rc = block_put(bitmap_block);
@@ -174,11 +233,13 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
 
 	/* Update inode blocks count */
-	uint64_t ino_blocks =
-	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
-	ino_blocks -= count * (block_size / EXT4_INODE_BLOCK_SIZE);
-	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
-	inode_ref->dirty = true;
+	if (inode_ref != NULL) {
+		uint64_t ino_blocks =
+		    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+		ino_blocks -= count * (block_size / EXT4_INODE_BLOCK_SIZE);
+		ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+		inode_ref->dirty = true;
+	}
 
 	/* Update block group free blocks count */
 	uint32_t free_blocks =
@@ -220,16 +281,16 @@ errno_t ext4_balloc_free_blocks(ext4_inode_ref_t *inode_ref,
 			 */
 			uint32_t s = limit - first;
 
-			r = ext4_balloc_free_blocks_internal(inode_ref,
-			    first, s);
+			r = ext4_balloc_free_blocks_internal(inode_ref->fs,
+			    inode_ref, first, s);
 			if (r != EOK)
 				return r;
 
 			first = limit;
 			count -= s;
 		} else {
-			return ext4_balloc_free_blocks_internal(inode_ref,
-			    first, count);
+			return ext4_balloc_free_blocks_internal(inode_ref->fs,
+			    inode_ref, first, count);
 		}
 	}
 
@@ -312,7 +373,7 @@ static errno_t ext4_balloc_find_goal(ext4_inode_ref_t *inode_ref, uint32_t *goal
 		if (rc != EOK)
 			return rc;
 
-		if (goal != 0) {
+		if (*goal != 0) {
 			(*goal)++;
 			return EOK;
 		}
@@ -587,6 +648,7 @@ goal_failed:
 
 success:
 	block_size = ext4_superblock_get_block_size(sb);
+	ext4_balloc_summary_invalidate(inode_ref->fs, bg_ref->index);
 
 	/* Update superblock free blocks count */
 	uint32_t sb_free_blocks = ext4_superblock_get_free_blocks_count(sb);
@@ -659,6 +721,7 @@ errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock
 	if (*free) {
 		ext4_bitmap_set_bit(bitmap_block->data, index_in_group);
 		bitmap_block->dirty = true;
+		ext4_balloc_summary_invalidate(fs, block_group);
 	}
 
 	/* Release block with bitmap */
@@ -699,6 +762,547 @@ terminate:
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
+
+/** Scan the data area of a block bitmap for runs of free blocks.
+ *
+ * Rebuilds the free space summary of the group and picks a run for
+ * an allocation of @a want blocks. The free run starting at the goal is
+ * preferred even if it is shorter, then the first run long enough after the
+ * goal, then the first such run before the goal and finally the longest run
+ * there is.
+ *
+ * @param bitmap  Block bitmap of the group
+ * @param first   Index of the first data block in the group
+ * @param end     Number of blocks in the group
+ * @param goal    Preferred index of the first block
+ * @param want    Number of blocks wanted
+ * @param summary Free space summary to rebuild or NULL
+ * @param start   Output value - index of the first block of chosen run
+ * @param len     Output value - number of blocks to take, 0 if none is free
+ *
+ */
+static void ext4_balloc_scan(uint8_t *bitmap, uint32_t first, uint32_t end,
+    uint32_t goal, uint32_t want, ext4_balloc_summary_t *summary,
+    uint32_t *start, uint32_t *len)
+{
+	uint32_t goal_len = 0;
+	uint32_t after_start = 0;
+	uint32_t after_len = 0;
+	uint32_t before_start = 0;
+	uint32_t before_len = 0;
+	uint32_t long_start = 0;
+	uint32_t long_len = 0;
+
+	uint32_t idx = first;
+	while (idx < end) {
+		/* Skip used blocks, whole bytes at once where possible */
+		if (((idx % 8) == 0) && (bitmap[idx / 8] == 0xff)) {
+			idx += 8;
+			continue;
+		}
+
+		if (!ext4_bitmap_is_free_bit(bitmap, idx)) {
+			idx++;
+			continue;
+		}
+
+		/* Measure the free run */
+		uint32_t run = idx;
+		while (idx < end) {
+			if (((idx % 8) == 0) && (idx + 8 <= end) &&
+			    (bitmap[idx / 8] == 0)) {
+				idx += 8;
+				continue;
+			}
+
+			if (!ext4_bitmap_is_free_bit(bitmap, idx))
+				break;
+			idx++;
+		}
+
+		uint32_t run_len = idx - run;
+
+		if ((goal >= run) && (goal < idx)) {
+			goal_len = idx - goal;
+		} else if (run_len >= want) {
+			if ((run > goal) && (after_len == 0)) {
+				after_start = run;
+				after_len = want;
+			} else if ((run < goal) && (before_len == 0)) {
+				before_start = run;
+				before_len = want;
+			}
+		}
+
+		if (run_len > long_len) {
+			long_start = run;
+			long_len = run_len;
+		}
+	}
+
+	if (summary != NULL) {
+		summary->max_run = long_len;
+		summary->valid = true;
+	}
+
+	if (goal_len > 0) {
+		*start = goal;
+		*len = min(goal_len, want);
+	} else if (after_len > 0) {
+		*start = after_start;
+		*len = after_len;
+	} else if (before_len > 0) {
+		*start = before_start;
+		*len = before_len;
+	} else {
+		*start = long_start;
+		*len = min(long_len, want);
+	}
+}
+
+/** Allocate a run of blocks within one block group.
+ *
+ * The run is taken only if it has at least @a min_run blocks or if it
+ * starts right at the goal. Groups whose summary shows no run of
+ * @a min_run blocks are skipped without loading their bitmap, unless
+ * there is a goal in them.
+ *
+ * @param fs      Filesystem
+ * @param bgid    Index of block group
+ * @param goal    Preferred address of the first block or 0
+ * @param want    Number of blocks wanted
+ * @param min_run Smallest acceptable number of blocks
+ * @param fblock  Output value - address of the first allocated block
+ * @param count   Output value - number of allocated blocks, 0 if none
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_alloc_in_group(ext4_filesystem_t *fs,
+    uint32_t bgid, uint32_t goal, uint32_t want, uint32_t min_run,
+    uint32_t *fblock, uint32_t *count)
+{
+	ext4_superblock_t *sb = fs->superblock;
+
+	*count = 0;
+
+	ext4_block_group_ref_t *bg_ref;
+	errno_t rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t free_blocks =
+	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
+	if (free_blocks == 0)
+		return ext4_filesystem_put_block_group_ref(bg_ref);
+
+	ext4_balloc_summary_t *summary = ext4_balloc_summary(fs, bgid);
+	if ((goal == 0) && (summary != NULL) && summary->valid &&
+	    (summary->max_run < min_run))
+		return ext4_filesystem_put_block_group_ref(bg_ref);
+
+	/* Compute indexes */
+	uint32_t first = ext4_filesystem_blockaddr2_index_in_group(sb,
+	    ext4_balloc_get_first_data_block_in_group(sb, bg_ref));
+	uint32_t end = ext4_superblock_get_blocks_in_group(sb, bgid);
+
+	uint32_t goal_idx = first;
+	if (goal != 0)
+		goal_idx = ext4_filesystem_blockaddr2_index_in_group(sb, goal);
+	if (goal_idx < first)
+		goal_idx = first;
+
+	/* Load block with bitmap */
+	uint32_t bitmap_block_addr =
+	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+	block_t *bitmap_block;
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	uint32_t start;
+	uint32_t len;
+	ext4_balloc_scan(bitmap_block->data, first, end, goal_idx, want,
+	    summary, &start, &len);
+
+	if ((len > 0) && ((len >= min_run) ||
+	    ((goal != 0) && (start == goal_idx)))) {
+		ext4_bitmap_set_bits(bitmap_block->data, start, len);
+		bitmap_block->dirty = true;
+
+		/* Bring the summary up to date with the allocation */
+		if (summary != NULL) {
+			uint32_t dummy_start;
+			uint32_t dummy_len;
+			ext4_balloc_scan(bitmap_block->data, first, end, first,
+			    1, summary, &dummy_start, &dummy_len);
+		}
+
+		/* Update block group free blocks count */
+		ext4_block_group_set_free_blocks_count(bg_ref->block_group,
+		    sb, free_blocks - len);
+		bg_ref->dirty = true;
+
+		/* Update superblock free blocks count */
+		uint32_t sb_free_blocks =
+		    ext4_superblock_get_free_blocks_count(sb);
+		ext4_superblock_set_free_blocks_count(sb, sb_free_blocks - len);
+
+		*fblock = ext4_filesystem_index_in_group2blockaddr(sb, start,
+		    bgid);
+		*count = len;
+	}
+
+	rc = block_put(bitmap_block);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	return ext4_filesystem_put_block_group_ref(bg_ref);
+}
+
+/** Allocate a contiguous run of blocks.
+ *
+ * Looks for a run of the full size, starting in the group of the goal.
+ * If no group has one, takes the longest run found instead.
+ *
+ * @param fs     Filesystem
+ * @param goal   Preferred address of the first block or 0
+ * @param want   Number of blocks wanted
+ * @param fblock Output value - address of the first allocated block
+ * @param count  Output value - number of allocated blocks
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_alloc_range(ext4_filesystem_t *fs, uint32_t goal,
+    uint32_t want, uint32_t *fblock, uint32_t *count)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+	errno_t rc;
+
+	uint32_t goal_group = 0;
+	if (goal != 0)
+		goal_group = ext4_filesystem_blockaddr2group(sb, goal);
+	if (goal_group >= block_group_count) {
+		goal_group = 0;
+		goal = 0;
+	}
+
+	/* Look for a run of the full size */
+	for (uint32_t i = 0; i < block_group_count; i++) {
+		uint32_t bgid = (goal_group + i) % block_group_count;
+
+		rc = ext4_balloc_alloc_in_group(fs, bgid, i == 0 ? goal : 0,
+		    want, want, fblock, count);
+		if (rc != EOK)
+			return rc;
+		if (*count > 0)
+			return EOK;
+	}
+
+	/* Settle for the longest run, which the summaries now know about */
+	uint32_t best_group = goal_group;
+	uint32_t best_run = 1;
+	if (fs->bg_summary != NULL) {
+		best_run = 0;
+		for (uint32_t bgid = 0; bgid < block_group_count; bgid++) {
+			ext4_balloc_summary_t *summary = &fs->bg_summary[bgid];
+			if (summary->valid && (summary->max_run > best_run)) {
+				best_group = bgid;
+				best_run = summary->max_run;
+			}
+		}
+
+		if (best_run == 0)
+			return ENOSPC;
+	}
+
+	for (uint32_t i = 0; i < block_group_count; i++) {
+		uint32_t bgid = (best_group + i) % block_group_count;
+
+		rc = ext4_balloc_alloc_in_group(fs, bgid, 0, want, 1, fblock,
+		    count);
+		if (rc != EOK)
+			return rc;
+		if (*count > 0)
+			return EOK;
+	}
+
+	return ENOSPC;
+}
+
+/** Account allocated data blocks to an i-node.
+ *
+ * @param inode_ref I-node the blocks belong to
+ * @param count     Number of blocks
+ *
+ */
+static void ext4_balloc_charge(ext4_inode_ref_t *inode_ref, uint32_t count)
+{
+	ext4_superblock_t *sb = inode_ref->fs->superblock;
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+
+	/* Update inode blocks (different block size!) count */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks += count * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+}
+
+/** Find the preallocation window of an i-node.
+ *
+ * @param fs    Filesystem
+ * @param index Index of the i-node
+ *
+ * @return Window or NULL if the i-node has none
+ *
+ */
+static ext4_balloc_prealloc_t *ext4_balloc_prealloc_find(ext4_filesystem_t *fs,
+    uint32_t index)
+{
+	list_foreach(fs->prealloc, link, ext4_balloc_prealloc_t, pa) {
+		if (pa->index == index)
+			return pa;
+	}
+
+	return NULL;
+}
+
+/** Free the blocks of a preallocation window and the window itself.
+ *
+ * @param fs Filesystem
+ * @param pa Window to be released
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_prealloc_release(ext4_filesystem_t *fs,
+    ext4_balloc_prealloc_t *pa)
+{
+	errno_t rc = EOK;
+
+	list_remove(&pa->link);
+
+	/* The window never crosses a block group boundary */
+	if (pa->count > 0)
+		rc = ext4_balloc_free_blocks_internal(fs, NULL, pa->fblock,
+		    pa->count);
+
+	free(pa);
+	return rc;
+}
+
+/** Free all preallocation windows of a filesystem.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_prealloc_release_all(ext4_filesystem_t *fs)
+{
+	while (!list_empty(&fs->prealloc)) {
+		ext4_balloc_prealloc_t *pa = list_get_instance(
+		    list_first(&fs->prealloc), ext4_balloc_prealloc_t, link);
+
+		errno_t rc = ext4_balloc_prealloc_release(fs, pa);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
+/** Remember blocks reserved for the next appends to an i-node.
+ *
+ * Only the EXT4_BALLOC_PREALLOC_WINDOWS most recently used windows are
+ * kept, the least recently used one is released to make room for a new
+ * one. So are the blocks if there is no memory to track them.
+ *
+ * @param fs     Filesystem
+ * @param index  Index of the i-node
+ * @param iblock Logical block the window continues
+ * @param fblock First reserved block
+ * @param count  Number of reserved blocks
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_prealloc_add(ext4_filesystem_t *fs, uint32_t index,
+    uint32_t iblock, uint32_t fblock, uint32_t count)
+{
+	ext4_balloc_prealloc_t *pa = malloc(sizeof(ext4_balloc_prealloc_t));
+	if (pa == NULL)
+		return ext4_balloc_free_blocks_internal(fs, NULL, fblock, count);
+
+	pa->index = index;
+	pa->iblock = iblock;
+	pa->fblock = fblock;
+	pa->count = count;
+	list_prepend(&pa->link, &fs->prealloc);
+
+	if (list_count(&fs->prealloc) > EXT4_BALLOC_PREALLOC_WINDOWS) {
+		return ext4_balloc_prealloc_release(fs, list_get_instance(
+		    list_last(&fs->prealloc), ext4_balloc_prealloc_t, link));
+	}
+
+	return EOK;
+}
+
+/** Allocate a contiguous run of data blocks.
+ *
+ * If the request continues where the previous one of the i-node ended,
+ * it is served from the preallocation window without touching the block
+ * bitmaps. Otherwise a run is allocated near the goal and, for regular
+ * files, EXT4_BALLOC_PREALLOC more blocks are reserved after it for the
+ * appends that are likely to follow.
+ *
+ * The windows are kept by the filesystem rather than by the i-node
+ * reference, so they outlive the individual write operations. They are
+ * released on truncate, when the i-node is freed and when the filesystem
+ * is closed.
+ *
+ * @param inode_ref I-node to allocate blocks for
+ * @param iblock    Logical index of the first block
+ * @param goal      Preferred address of the first block, 0 for default
+ * @param count     Number of blocks wanted
+ * @param fblock    Output value - address of the first allocated block
+ * @param allocated Output value - number of allocated blocks (1..count)
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_alloc_blocks(ext4_inode_ref_t *inode_ref, uint32_t iblock,
+    uint32_t goal, uint32_t count, uint32_t *fblock, uint32_t *allocated)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	uint32_t start;
+	uint32_t got;
+	uint32_t n;
+	errno_t rc;
+
+	assert(count > 0);
+
+	fibril_mutex_lock(&fs->prealloc_lock);
+
+	ext4_balloc_prealloc_t *pa = ext4_balloc_prealloc_find(fs,
+	    inode_ref->index);
+
+	/* Take from the preallocation window */
+	if ((pa != NULL) && (pa->iblock == iblock)) {
+		n = min(count, pa->count);
+
+		*fblock = pa->fblock;
+		*allocated = n;
+
+		pa->iblock += n;
+		pa->fblock += n;
+		pa->count -= n;
+
+		list_remove(&pa->link);
+		if (pa->count > 0)
+			list_prepend(&pa->link, &fs->prealloc);
+		else
+			free(pa);
+
+		fibril_mutex_unlock(&fs->prealloc_lock);
+
+		ext4_balloc_charge(inode_ref, n);
+		return EOK;
+	}
+
+	/* The window is of no use for a non-sequential request */
+	if (pa != NULL) {
+		rc = ext4_balloc_prealloc_release(fs, pa);
+		if (rc != EOK)
+			goto out;
+	}
+
+	if (goal == 0) {
+		rc = ext4_balloc_find_goal(inode_ref, &goal);
+		if (rc != EOK)
+			goto out;
+	}
+
+	uint32_t want = count;
+	if (ext4_inode_is_type(fs->superblock, inode_ref->inode,
+	    EXT4_INODE_MODE_FILE))
+		want += EXT4_BALLOC_PREALLOC;
+
+	rc = ext4_balloc_alloc_range(fs, goal, want, &start, &got);
+	if ((rc == ENOSPC) && !list_empty(&fs->prealloc)) {
+		/* The blocks reserved for other files are needed now */
+		rc = ext4_balloc_prealloc_release_all(fs);
+		if (rc != EOK)
+			goto out;
+
+		rc = ext4_balloc_alloc_range(fs, goal, want, &start, &got);
+	}
+	if (rc != EOK)
+		goto out;
+
+	n = min(count, got);
+	ext4_balloc_charge(inode_ref, n);
+
+	*fblock = start;
+	*allocated = n;
+
+	if (got > n) {
+		rc = ext4_balloc_prealloc_add(fs, inode_ref->index, iblock + n,
+		    start + n, got - n);
+	}
+
+out:
+	fibril_mutex_unlock(&fs->prealloc_lock);
+	return rc;
+}
+
+/** Release the preallocation window of an i-node.
+ *
+ * @param inode_ref I-node whose preallocated blocks are to be freed
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_discard_prealloc(ext4_inode_ref_t *inode_ref)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	errno_t rc = EOK;
+
+	fibril_mutex_lock(&fs->prealloc_lock);
+
+	ext4_balloc_prealloc_t *pa = ext4_balloc_prealloc_find(fs,
+	    inode_ref->index);
+	if (pa != NULL)
+		rc = ext4_balloc_prealloc_release(fs, pa);
+
+	fibril_mutex_unlock(&fs->prealloc_lock);
+	return rc;
+}
+
+/** Release the preallocation windows of all i-nodes.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_discard_all_prealloc(ext4_filesystem_t *fs)
+{
+	fibril_mutex_lock(&fs->prealloc_lock);
+	errno_t rc = ext4_balloc_prealloc_release_all(fs);
+	fibril_mutex_unlock(&fs->prealloc_lock);
+
+	return rc;
+}
+
 /**
  * @}
  */
@@ -36,6 +36,7 @@
 
 #include <byteorder.h>
 #include <errno.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "ext4/balloc.h"
@@ -948,25 +949,34 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 	return EOK;
 }
 
-/** Append data block to the i-node.
+/** Append a run of data blocks to the i-node.
  *
- * This function allocates data block, tries to append it
- * to some existing extent or creates new extents.
- * It includes possible extent tree modifications (splitting).
+ * This function allocates up to @a count physically contiguous data blocks
+ * and adds them to the i-node as a whole, either by extending the last
+ * extent or by creating a new one. It includes possible extent tree
+ * modifications (splitting).
  *
- * @param inode_ref I-node to append block to
- * @param iblock    Output logical number of newly allocated block
- * @param fblock    Output physical block address of newly allocated block
+ * @param inode_ref   I-node to append blocks to
+ * @param count       Number of blocks wanted
+ * @param iblock      Output logical number of the first appended block
+ * @param fblock      Output physical address of the first appended block
+ * @param appended    Output number of appended blocks (1..count)
+ * @param update_size Whether to grow the i-node size over the new blocks
  *
  * @return Error code
  *
  */
-errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
-    uint32_t *fblock, bool update_size)
+errno_t ext4_extent_append_blocks(ext4_inode_ref_t *inode_ref, uint32_t count,
+    uint32_t *iblock, uint32_t *fblock, uint32_t *appended, bool update_size)
 {
 	ext4_superblock_t *sb = inode_ref->fs->superblock;
 	uint64_t inode_size = ext4_inode_get_size(sb, inode_ref->inode);
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint32_t block_limit = (1 << 15);
+
+	/* A single extent cannot hold more */
+	if (count > block_limit)
+		count = block_limit;
 
 	/* Calculate number of new logical block */
 	uint32_t new_block_idx = 0;
@@ -989,80 +999,70 @@ errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 	while (path_ptr->depth != 0)
 		path_ptr++;
 
+	uint32_t phys_block = 0;
+	uint32_t n = 0;
+
 	/* Add new extent to the node if not present */
 	if (path_ptr->extent == NULL)
 		goto append_extent;
 
 	uint16_t block_count = ext4_extent_get_block_count(path_ptr->extent);
-	uint16_t block_limit = (1 << 15);
 
-	uint32_t phys_block = 0;
 	if (block_count < block_limit) {
-		/* There is space for new block in the extent */
+		/* There is space for new blocks in the extent */
 		if (block_count == 0) {
 			/* Existing extent is empty */
-			rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
+			rc = ext4_balloc_alloc_blocks(inode_ref,
+			    new_block_idx, 0, count, &phys_block, &n);
 			if (rc != EOK)
 				goto finish;
 
 			/* Initialize extent */
 			ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
 			ext4_extent_set_start(path_ptr->extent, phys_block);
-			ext4_extent_set_block_count(path_ptr->extent, 1);
-
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
-			}
+			ext4_extent_set_block_count(path_ptr->extent, n);
 
 			path_ptr->block->dirty = true;
 
-			goto finish;
+			goto update_inode;
 		} else {
 			/* Existing extent contains some blocks */
-			phys_block = ext4_extent_get_start(path_ptr->extent);
-			phys_block += ext4_extent_get_block_count(path_ptr->extent);
+			uint32_t goal = ext4_extent_get_start(path_ptr->extent);
+			goal += block_count;
 
-			/* Check if the following block is free for allocation */
-			bool free;
-			rc = ext4_balloc_try_alloc_block(inode_ref, phys_block, &free);
+			rc = ext4_balloc_alloc_blocks(inode_ref, new_block_idx,
+			    goal, min(count, block_limit - block_count),
+			    &phys_block, &n);
 			if (rc != EOK)
 				goto finish;
 
-			if (!free) {
-				/* Target is not free, new block must be appended to new extent */
-				goto append_extent;
+			if (phys_block != goal) {
+				/* New blocks must be appended to new extent */
+				goto add_extent;
 			}
 
 			/* Update extent */
-			ext4_extent_set_block_count(path_ptr->extent, block_count + 1);
-
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
-			}
+			ext4_extent_set_block_count(path_ptr->extent,
+			    block_count + n);
 
 			path_ptr->block->dirty = true;
 
-			goto finish;
+			goto update_inode;
 		}
 	}
 
 append_extent:
-	/* Append new extent to the tree */
-	phys_block = 0;
-
-	/* Allocate new data block */
-	rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
+	/* Allocate new data blocks */
+	rc = ext4_balloc_alloc_blocks(inode_ref, new_block_idx, 0, count,
+	    &phys_block, &n);
 	if (rc != EOK)
 		goto finish;
 
-	/* Append extent for new block (includes tree splitting if needed) */
+add_extent:
+	/* Append extent for new blocks (includes tree splitting if needed) */
 	rc = ext4_extent_append_extent(inode_ref, path, new_block_idx);
 	if (rc != EOK) {
-		ext4_balloc_free_block(inode_ref, phys_block);
+		ext4_balloc_free_blocks(inode_ref, phys_block, n);
 		goto finish;
 	}
 
@@ -1070,24 +1070,27 @@ append_extent:
 	path_ptr = path + tree_depth;
 
 	/* Initialize newly created extent */
-	ext4_extent_set_block_count(path_ptr->extent, 1);
+	ext4_extent_set_block_count(path_ptr->extent, n);
 	ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
 	ext4_extent_set_start(path_ptr->extent, phys_block);
 
+	path_ptr->block->dirty = true;
+
+update_inode:
 	/* Update i-node */
 	if (update_size) {
-		ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
+		ext4_inode_set_size(inode_ref->inode,
+		    inode_size + (uint64_t) n * block_size);
 		inode_ref->dirty = true;
 	}
 
-	path_ptr->block->dirty = true;
-
 finish:
 	rc2 = EOK;
 
 	/* Set return values */
 	*iblock = new_block_idx;
 	*fblock = phys_block;
+	*appended = n;
 
 	/*
 	 * Put loaded blocks
@@ -1107,6 +1110,29 @@ finish:
 	return rc;
 }
 
+/** Append data block to the i-node.
+ *
+ * This function allocates data block, tries to append it
+ * to some existing extent or creates new extents.
+ * It includes possible extent tree modifications (splitting).
+ *
+ * @param inode_ref   I-node to append block to
+ * @param iblock      Output logical number of newly allocated block
+ * @param fblock      Output physical block address of newly allocated block
+ * @param update_size Whether to grow the i-node size over the new block
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
+    uint32_t *fblock, bool update_size)
+{
+	uint32_t appended;
+
+	return ext4_extent_append_blocks(inode_ref, 1, iblock, fblock,
+	    &appended, update_size);
+}
+
 /**
  * @}
  */
@@ -37,6 +37,7 @@
 
 #include <adt/hash_table.h>
 #include <adt/hash.h>
+#include <align.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <libfs.h>
@@ -1326,17 +1327,23 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 		if ((ext4_superblock_has_feature_incompatible(fs->superblock,
 		    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
 		    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
-			uint32_t last_iblock =
-			    ext4_inode_get_size(fs->superblock, inode_ref->inode) /
+			aoff64_t isize = ext4_inode_get_size(fs->superblock,
+			    inode_ref->inode);
+			uint32_t last_iblock = ALIGN_UP(isize, block_size) /
 			    block_size;
 
+			/* Fill the gap before the target block by whole runs */
 			while (last_iblock < iblock) {
-				rc = ext4_extent_append_block(inode_ref, &last_iblock,
-				    &fblock, true);
+				uint32_t appended;
+				rc = ext4_extent_append_blocks(inode_ref,
+				    iblock - last_iblock, &last_iblock, &fblock,
+				    &appended, true);
 				if (rc != EOK) {
 					async_answer_0(&call, rc);
 					goto exit;
 				}
+
+				last_iblock += appended;
 			}
 
 			rc = ext4_extent_append_block(inode_ref, &last_iblock,
@@ -45,6 +45,7 @@
 #include <str.h>
 #include <stdlib.h>
 #include <fibril_synch.h>
+#include <adt/hash.h>
 #include <ipc/vfs.h>
 #include <vfs/vfs.h>
 
@@ -904,5 +905,210 @@ errno_t fs_instance_destroy(service_id_t service_id)
 	return ENOENT;
 }
 
+/** Number of entries at which a directory name cache starts hashing names. */
+#define DCACHE_HASH_THRESHOLD  16
+
+static size_t dcache_name_hash(const char *name)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261U;
+
+	while (*name != '\0') {
+		hash ^= (uint8_t) *name++;
+		hash *= 16777619U;
+	}
+
+	return hash_mix(hash);
+}
+
+static size_t dcache_hash(const ht_link_t *item)
+{
+	libfs_dentry_t *de = hash_table_get_inst(item, libfs_dentry_t, hlink);
+	return dcache_name_hash(de->name);
+}
+
+static size_t dcache_key_hash(const void *key)
+{
+	return dcache_name_hash(key);
+}
+
+static bool dcache_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	libfs_dentry_t *de1 = hash_table_get_inst(item1, libfs_dentry_t, hlink);
+	libfs_dentry_t *de2 = hash_table_get_inst(item2, libfs_dentry_t, hlink);
+	return str_cmp(de1->name, de2->name) == 0;
+}
+
+static bool dcache_key_equal(const void *key, const ht_link_t *item)
+{
+	libfs_dentry_t *de = hash_table_get_inst(item, libfs_dentry_t, hlink);
+	return str_cmp(de->name, key) == 0;
+}
+
+static hash_table_ops_t dcache_ops = {
+	.hash = dcache_hash,
+	.key_hash = dcache_key_hash,
+	.equal = dcache_equal,
+	.key_equal = dcache_key_equal,
+	.remove_callback = NULL
+};
+
+/** Initialize an empty directory name cache.
+ *
+ * @param dc	Name cache.
+ */
+void libfs_dcache_initialize(libfs_dcache_t *dc)
+{
+	list_initialize(&dc->entries);
+	dc->count = 0;
+	dc->hashed = false;
+	dc->cursor = NULL;
+	dc->cursor_pos = 0;
+}
+
+/** Release resources held by a directory name cache.
+ *
+ * The entries themselves are owned by the caller and are left untouched.
+ *
+ * @param dc	Name cache.
+ */
+void libfs_dcache_fini(libfs_dcache_t *dc)
+{
+	if (dc->hashed) {
+		hash_table_destroy(&dc->names);
+		dc->hashed = false;
+	}
+}
+
+/** Start hashing the names of a directory which has grown large.
+ *
+ * Failure to allocate the hash is not fatal, the cache keeps falling back
+ * to a linear search.
+ */
+static void dcache_hash_build(libfs_dcache_t *dc)
+{
+	if (!hash_table_create(&dc->names, 2 * dc->count, 0, &dcache_ops))
+		return;
+
+	list_foreach(dc->entries, link, libfs_dentry_t, de)
+		hash_table_insert(&dc->names, &de->hlink);
+
+	dc->hashed = true;
+}
+
+/** Append an entry to a directory name cache.
+ *
+ * The caller is responsible for checking that the name is not present
+ * in the directory yet.
+ *
+ * @param dc	Name cache.
+ * @param de	Entry to add.
+ * @param name	Name of the entry. Must remain valid while the entry is
+ *		in the cache.
+ */
+void libfs_dcache_insert(libfs_dcache_t *dc, libfs_dentry_t *de,
+    const char *name)
+{
+	link_initialize(&de->link);
+	de->name = name;
+
+	list_append(&de->link, &dc->entries);
+	dc->count++;
+
+	if (dc->hashed)
+		hash_table_insert(&dc->names, &de->hlink);
+	else if (dc->count >= DCACHE_HASH_THRESHOLD)
+		dcache_hash_build(dc);
+}
+
+/** Remove an entry from a directory name cache.
+ *
+ * @param dc	Name cache.
+ * @param de	Entry to remove.
+ */
+void libfs_dcache_remove(libfs_dcache_t *dc, libfs_dentry_t *de)
+{
+	if (dc->hashed)
+		hash_table_remove_item(&dc->names, &de->hlink);
+
+	list_remove(&de->link);
+	dc->count--;
+
+	/* Positions of the following entries have shifted. */
+	dc->cursor = NULL;
+}
+
+/** Find a directory entry by name.
+ *
+ * @param dc	Name cache.
+ * @param name	Name to look for.
+ *
+ * @return	Matching entry or NULL if there is none.
+ */
+libfs_dentry_t *libfs_dcache_find(libfs_dcache_t *dc, const char *name)
+{
+	if (dc->hashed) {
+		ht_link_t *hlp = hash_table_find(&dc->names, name);
+		if (hlp == NULL)
+			return NULL;
+		return hash_table_get_inst(hlp, libfs_dentry_t, hlink);
+	}
+
+	list_foreach(dc->entries, link, libfs_dentry_t, de) {
+		if (str_cmp(de->name, name) == 0)
+			return de;
+	}
+
+	return NULL;
+}
+
+/** Find a directory entry by position.
+ *
+ * Directory reads ask for consecutive positions, so the search continues
+ * from the entry found last time whenever possible. Reading a whole
+ * directory thus takes linear rather than quadratic time.
+ *
+ * @param dc	Name cache.
+ * @param pos	Position of the entry in insertion order.
+ *
+ * @return	Entry or NULL if there are not that many entries.
+ */
+libfs_dentry_t *libfs_dcache_nth(libfs_dcache_t *dc, size_t pos)
+{
+	link_t *lnk;
+	size_t i;
+
+	if (pos >= dc->count)
+		return NULL;
+
+	if (dc->cursor != NULL && dc->cursor_pos <= pos) {
+		lnk = &dc->cursor->link;
+		i = dc->cursor_pos;
+	} else {
+		lnk = list_first(&dc->entries);
+		i = 0;
+	}
+
+	while (i < pos) {
+		lnk = list_next(lnk, &dc->entries);
+		i++;
+	}
+
+	dc->cursor = list_get_instance(lnk, libfs_dentry_t, link);
+	dc->cursor_pos = pos;
+	return dc->cursor;
+}
+
+/** Test whether a directory name cache is empty.
+ *
+ * @param dc	Name cache.
+ *
+ * @return	True if there are no entries.
+ */
+bool libfs_dcache_empty(libfs_dcache_t *dc)
+{
+	return dc->count == 0;
+}
+
 /** @}
  */
@@ -40,6 +40,8 @@
 #include <offset.h>
 #include <async.h>
 #include <loc.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
 
 typedef struct {
 	errno_t (*fsprobe)(service_id_t, vfs_fs_probe_info_t *);
@@ -94,6 +96,32 @@ typedef struct {
 	uint8_t *plb_ro;         /**< Read-only PLB view. */
 } fs_reg_t;
 
+/** Directory entry tracked by a name cache
+ *
+ * Embedded into the directory entry structure of the file system server.
+ */
+typedef struct {
+	link_t link;		/**< Link in the ordered list of entries. */
+	ht_link_t hlink;	/**< Link in the name hash. */
+	const char *name;	/**< Name of the entry. */
+} libfs_dentry_t;
+
+/** Name cache of a directory
+ *
+ * Keeps the entries of a directory in their insertion order and, once the
+ * directory grows large enough, also hashed by name. File system servers
+ * which keep their directories in memory can use it to implement the match
+ * operation in constant time.
+ */
+typedef struct {
+	list_t entries;		/**< Entries in insertion order. */
+	size_t count;		/**< Number of entries. */
+	bool hashed;		/**< Whether the name hash is in use. */
+	hash_table_t names;	/**< Name hash of the entries. */
+	libfs_dentry_t *cursor;	/**< Entry last found by position. */
+	size_t cursor_pos;	/**< Position of the cursor entry. */
+} libfs_dcache_t;
+
 extern errno_t fs_register(async_sess_t *, vfs_info_t *, vfs_out_ops_t *,
     libfs_ops_t *);
 
@@ -103,6 +131,15 @@ extern errno_t fs_instance_create(service_id_t, void *);
 extern errno_t fs_instance_get(service_id_t, void **);
 extern errno_t fs_instance_destroy(service_id_t);
 
+extern void libfs_dcache_initialize(libfs_dcache_t *);
+extern void libfs_dcache_fini(libfs_dcache_t *);
+extern void libfs_dcache_insert(libfs_dcache_t *, libfs_dentry_t *,
+    const char *);
+extern void libfs_dcache_remove(libfs_dcache_t *, libfs_dentry_t *);
+extern libfs_dentry_t *libfs_dcache_find(libfs_dcache_t *, const char *);
+extern libfs_dentry_t *libfs_dcache_nth(libfs_dcache_t *, size_t);
+extern bool libfs_dcache_empty(libfs_dcache_t *);
+
 #endif
 
 /** @}
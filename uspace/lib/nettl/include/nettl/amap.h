@@ -36,6 +36,7 @@
 #ifndef LIBNETTL_AMAP_H_
 #define LIBNETTL_AMAP_H_
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <inet/endpoint.h>
 #include <nettl/portrng.h>
@@ -44,7 +45,7 @@
 /** Port range for (remote endpoint, local address) */
 typedef struct {
 	/** Link to amap_t.repla */
-	link_t lamap;
+	ht_link_t lamap;
 	/** Remote endpoint */
 	inet_ep_t rep;
 	/* Local address */
@@ -73,16 +74,47 @@ typedef struct {
 	portrng_t *portrng;
 } amap_llink_t;
 
+/** Association map entry kind, from the most specific to the least one */
+typedef enum {
+	/** Remote endpoint, local address */
+	amk_repla,
+	/** Local address */
+	amk_laddr,
+	/** Local link */
+	amk_llink,
+	/** Nothing specified */
+	amk_unspec,
+	/** Number of entry kinds */
+	amk_limit
+} amap_kind_t;
+
+/** Association map entry.
+ *
+ * Every allocated endpoint (pair) is also entered into the match table
+ * of its kind so that incoming datagrams can be demultiplexed using
+ * a hash lookup.
+ */
+typedef struct {
+	/** Link to amap_t.match */
+	ht_link_t lmatch;
+	/** Endpoint pair with the fields not used by the entry kind cleared */
+	inet_ep2_t key;
+	/** User argument */
+	void *arg;
+} amap_ent_t;
+
 /** Association map */
 typedef struct {
 	/** Remote endpoint, local address */
-	list_t repla; /* of amap_repla_t */
+	hash_table_t repla; /* of amap_repla_t */
 	/** Local addresses */
 	list_t laddr; /* of amap_laddr_t */
 	/** Local links */
 	list_t llink; /* of amap_llink_t */
 	/** Nothing specified (listen on all local addresses) */
 	portrng_t *unspec;
+	/** Match tables, indexed by amap_kind_t */
+	hash_table_t match[amk_limit]; /* of amap_ent_t */
 } amap_t;
 
 typedef enum {
@@ -47,17 +47,257 @@
  *
  * In the unspecified case only the local port is known and the entry matches
  * all remote and local addresses.
+ *
+ * Port numbers are allocated from a port range associated with each key.
+ * In addition, each allocated endpoint (pair) is entered into a hash table
+ * (one per entry kind) keyed by all the attributes of its kind, including
+ * the local port. Finding a match for an incoming datagram thus takes at
+ * most one hash lookup per entry kind and does not allocate memory.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <inet/addr.h>
 #include <inet/inet.h>
 #include <io/log.h>
+#include <mem.h>
 #include <nettl/amap.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+/** Compute hash of an address.
+ *
+ * @param addr Address
+ * @return Hash
+ */
+static size_t amap_addr_hash(const inet_addr_t *addr)
+{
+	size_t hash;
+	uint32_t w;
+	size_t i;
+
+	hash = addr->version;
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (i = 0; i < sizeof(addr128_t); i += sizeof(uint32_t)) {
+			memcpy(&w, &addr->addr6[i], sizeof(uint32_t));
+			hash = hash_combine(hash, w);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+/** Determine if two addresses are the same.
+ *
+ * Unlike inet_addr_compare() this treats two unspecified addresses as equal.
+ *
+ * @param a First address
+ * @param b Second address
+ * @return @c true if the addresses are equal
+ */
+static bool amap_addr_equal(const inet_addr_t *a, const inet_addr_t *b)
+{
+	if (a->version == ip_any && b->version == ip_any)
+		return true;
+
+	return inet_addr_compare(a, b);
+}
+
+/** Compute hash of an endpoint pair.
+ *
+ * @param epp Endpoint pair
+ * @return Hash
+ */
+static size_t amap_ep2_hash(const inet_ep2_t *epp)
+{
+	size_t hash;
+
+	hash = amap_addr_hash(&epp->remote.addr);
+	hash = hash_combine(hash, epp->remote.port);
+	hash = hash_combine(hash, amap_addr_hash(&epp->local.addr));
+	hash = hash_combine(hash, epp->local.port);
+	hash = hash_combine(hash, epp->local_link);
+
+	return hash_mix(hash);
+}
+
+/** Determine if two endpoint pairs are the same.
+ *
+ * @param a First endpoint pair
+ * @param b Second endpoint pair
+ * @return @c true if the endpoint pairs are equal
+ */
+static bool amap_ep2_equal(const inet_ep2_t *a, const inet_ep2_t *b)
+{
+	return a->remote.port == b->remote.port &&
+	    a->local.port == b->local.port &&
+	    a->local_link == b->local_link &&
+	    amap_addr_equal(&a->remote.addr, &b->remote.addr) &&
+	    amap_addr_equal(&a->local.addr, &b->local.addr);
+}
+
+/** Construct repla lookup key.
+ *
+ * @param rep Remote endpoint
+ * @param la  Local address
+ * @param key Place to store key
+ */
+static void amap_repla_key(const inet_ep_t *rep, const inet_addr_t *la,
+    inet_ep2_t *key)
+{
+	inet_ep2_init(key);
+	key->remote = *rep;
+	key->local.addr = *la;
+}
+
+static size_t amap_repla_ht_key_hash(const void *key)
+{
+	return amap_ep2_hash((const inet_ep2_t *) key);
+}
+
+static size_t amap_repla_ht_hash(const ht_link_t *item)
+{
+	amap_repla_t *repla = hash_table_get_inst(item, amap_repla_t, lamap);
+	inet_ep2_t key;
+
+	amap_repla_key(&repla->rep, &repla->laddr, &key);
+	return amap_ep2_hash(&key);
+}
+
+static bool amap_repla_ht_key_equal(const void *key, const ht_link_t *item)
+{
+	amap_repla_t *repla = hash_table_get_inst(item, amap_repla_t, lamap);
+	inet_ep2_t rkey;
+
+	amap_repla_key(&repla->rep, &repla->laddr, &rkey);
+	return amap_ep2_equal((const inet_ep2_t *) key, &rkey);
+}
+
+/** Operations for repla hash table. */
+static hash_table_ops_t amap_repla_ht_ops = {
+	.hash = amap_repla_ht_hash,
+	.key_hash = amap_repla_ht_key_hash,
+	.key_equal = amap_repla_ht_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t amap_match_ht_key_hash(const void *key)
+{
+	return amap_ep2_hash((const inet_ep2_t *) key);
+}
+
+static size_t amap_match_ht_hash(const ht_link_t *item)
+{
+	amap_ent_t *ent = hash_table_get_inst(item, amap_ent_t, lmatch);
+
+	return amap_ep2_hash(&ent->key);
+}
+
+static bool amap_match_ht_key_equal(const void *key, const ht_link_t *item)
+{
+	amap_ent_t *ent = hash_table_get_inst(item, amap_ent_t, lmatch);
+
+	return amap_ep2_equal((const inet_ep2_t *) key, &ent->key);
+}
+
+/** Operations for match hash tables. */
+static hash_table_ops_t amap_match_ht_ops = {
+	.hash = amap_match_ht_hash,
+	.key_hash = amap_match_ht_key_hash,
+	.key_equal = amap_match_ht_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Construct match table lookup key.
+ *
+ * Copy the attributes used by entries of kind @a kind from @a epp,
+ * clearing the rest.
+ *
+ * @param kind Entry kind
+ * @param epp  Endpoint pair
+ * @param key  Place to store key
+ */
+static void amap_match_key(amap_kind_t kind, const inet_ep2_t *epp,
+    inet_ep2_t *key)
+{
+	inet_ep2_init(key);
+	key->local.port = epp->local.port;
+
+	switch (kind) {
+	case amk_repla:
+		key->remote = epp->remote;
+		key->local.addr = epp->local.addr;
+		break;
+	case amk_laddr:
+		key->local.addr = epp->local.addr;
+		break;
+	case amk_llink:
+		key->local_link = epp->local_link;
+		break;
+	case amk_unspec:
+	case amk_limit:
+		break;
+	}
+}
+
+/** Enter allocated endpoint pair into match table.
+ *
+ * @param map  Association map
+ * @param kind Entry kind
+ * @param epp  Endpoint pair (with allocated port number)
+ * @param arg  User argument
+ *
+ * @return EOK on success, ENOMEM if out of memory
+ */
+static errno_t amap_match_insert(amap_t *map, amap_kind_t kind,
+    inet_ep2_t *epp, void *arg)
+{
+	amap_ent_t *ent;
+
+	ent = calloc(1, sizeof(amap_ent_t));
+	if (ent == NULL)
+		return ENOMEM;
+
+	amap_match_key(kind, epp, &ent->key);
+	ent->arg = arg;
+	hash_table_insert(&map->match[kind], &ent->lmatch);
+	return EOK;
+}
+
+/** Remove endpoint pair from match table.
+ *
+ * @param map  Association map
+ * @param kind Entry kind
+ * @param epp  Endpoint pair
+ */
+static void amap_match_remove(amap_t *map, amap_kind_t kind, inet_ep2_t *epp)
+{
+	inet_ep2_t key;
+	ht_link_t *link;
+
+	amap_match_key(kind, epp, &key);
+	link = hash_table_find(&map->match[kind], &key);
+	if (link == NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_match_remove: not found");
+		return;
+	}
+
+	hash_table_remove_item(&map->match[kind], link);
+	free(hash_table_get_inst(link, amap_ent_t, lmatch));
+}
+
 /** Convert association map flags to port range flags.
  *
  * @param flags Association map flags
@@ -82,6 +322,7 @@ static portrng_flags_t aflags_to_pflags(amap_flags_t flags)
 errno_t amap_create(amap_t **rmap)
 {
 	amap_t *map;
+	amap_kind_t kind;
 	errno_t rc;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_create()");
@@ -97,7 +338,24 @@ errno_t amap_create(amap_t **rmap)
 		return ENOMEM;
 	}
 
-	list_initialize(&map->repla);
+	if (!hash_table_create(&map->repla, 0, 0, &amap_repla_ht_ops)) {
+		portrng_destroy(map->unspec);
+		free(map);
+		return ENOMEM;
+	}
+
+	for (kind = 0; kind < amk_limit; kind++) {
+		if (!hash_table_create(&map->match[kind], 0, 0,
+		    &amap_match_ht_ops)) {
+			while (kind > 0)
+				hash_table_destroy(&map->match[--kind]);
+			hash_table_destroy(&map->repla);
+			portrng_destroy(map->unspec);
+			free(map);
+			return ENOMEM;
+		}
+	}
+
 	list_initialize(&map->laddr);
 	list_initialize(&map->llink);
 
@@ -111,11 +369,21 @@ errno_t amap_create(amap_t **rmap)
  */
 void amap_destroy(amap_t *map)
 {
+	amap_kind_t kind;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_destroy()");
 
-	assert(list_empty(&map->repla));
+	assert(hash_table_empty(&map->repla));
 	assert(list_empty(&map->laddr));
 	assert(list_empty(&map->llink));
+
+	for (kind = 0; kind < amk_limit; kind++) {
+		assert(hash_table_empty(&map->match[kind]));
+		hash_table_destroy(&map->match[kind]);
+	}
+
+	hash_table_destroy(&map->repla);
+	portrng_destroy(map->unspec);
 	free(map);
 }
 
@@ -133,34 +401,21 @@ void amap_destroy(amap_t *map)
 static errno_t amap_repla_find(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
     amap_repla_t **rrepla)
 {
-	char *sraddr, *sladdr;
-
-	(void) inet_addr_format(&rep->addr, &sraddr);
-	(void) inet_addr_format(la, &sladdr);
-
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): rep=(%s,%" PRIu16
-	    ") la=%s", sraddr, rep->port, sladdr);
-	free(sraddr);
-	free(sladdr);
-
-	list_foreach(map->repla, lamap, amap_repla_t, repla) {
-		(void) inet_addr_format(&repla->rep.addr, &sraddr);
-		(void) inet_addr_format(&repla->laddr, &sladdr);
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): "
-		    "compare to rep=(%s, %" PRIu16 ") la=%s",
-		    sraddr, repla->rep.port, sladdr);
-		free(sraddr);
-		free(sladdr);
-		if (inet_addr_compare(&repla->rep.addr, &rep->addr) &&
-		    repla->rep.port == rep->port &&
-		    inet_addr_compare(&repla->laddr, la)) {
-			*rrepla = repla;
-			return EOK;
-		}
+	inet_ep2_t key;
+	ht_link_t *link;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_repla_find(): rport=%" PRIu16,
+	    rep->port);
+
+	amap_repla_key(rep, la, &key);
+	link = hash_table_find(&map->repla, &key);
+	if (link == NULL) {
+		*rrepla = NULL;
+		return ENOENT;
 	}
 
-	*rrepla = NULL;
-	return ENOENT;
+	*rrepla = hash_table_get_inst(link, amap_repla_t, lamap);
+	return EOK;
 }
 
 /** Insert repla.
@@ -194,7 +449,7 @@ static errno_t amap_repla_insert(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
 
 	repla->rep = *rep;
 	repla->laddr = *la;
-	list_append(&repla->lamap, &map->repla);
+	hash_table_insert(&map->repla, &repla->lamap);
 
 	*rrepla = repla;
 	return EOK;
@@ -209,7 +464,7 @@ static errno_t amap_repla_insert(amap_t *map, inet_ep_t *rep, inet_addr_t *la,
  */
 static void amap_repla_remove(amap_t *map, amap_repla_t *repla)
 {
-	list_remove(&repla->lamap);
+	hash_table_remove_item(&map->repla, &repla->lamap);
 	portrng_destroy(repla->portrng);
 	free(repla);
 }
@@ -396,6 +651,16 @@ static errno_t amap_insert_repla(amap_t *map, inet_ep2_t *epp, void *arg,
 	rc = portrng_alloc(repla->portrng, epp->local.port, arg, aflags_to_pflags(flags),
 	    &mepp.local.port);
 	if (rc != EOK) {
+		if (portrng_empty(repla->portrng))
+			amap_repla_remove(map, repla);
+		return rc;
+	}
+
+	rc = amap_match_insert(map, amk_repla, &mepp, arg);
+	if (rc != EOK) {
+		portrng_free_port(repla->portrng, mepp.local.port);
+		if (portrng_empty(repla->portrng))
+			amap_repla_remove(map, repla);
 		return rc;
 	}
 
@@ -440,6 +705,16 @@ static errno_t amap_insert_laddr(amap_t *map, inet_ep2_t *epp, void *arg,
 	rc = portrng_alloc(laddr->portrng, epp->local.port, arg, aflags_to_pflags(flags),
 	    &mepp.local.port);
 	if (rc != EOK) {
+		if (portrng_empty(laddr->portrng))
+			amap_laddr_remove(map, laddr);
+		return rc;
+	}
+
+	rc = amap_match_insert(map, amk_laddr, &mepp, arg);
+	if (rc != EOK) {
+		portrng_free_port(laddr->portrng, mepp.local.port);
+		if (portrng_empty(laddr->portrng))
+			amap_laddr_remove(map, laddr);
 		return rc;
 	}
 
@@ -484,6 +759,16 @@ static errno_t amap_insert_llink(amap_t *map, inet_ep2_t *epp, void *arg,
 	rc = portrng_alloc(llink->portrng, epp->local.port, arg, aflags_to_pflags(flags),
 	    &mepp.local.port);
 	if (rc != EOK) {
+		if (portrng_empty(llink->portrng))
+			amap_llink_remove(map, llink);
+		return rc;
+	}
+
+	rc = amap_match_insert(map, amk_llink, &mepp, arg);
+	if (rc != EOK) {
+		portrng_free_port(llink->portrng, mepp.local.port);
+		if (portrng_empty(llink->portrng))
+			amap_llink_remove(map, llink);
 		return rc;
 	}
 
@@ -519,6 +804,12 @@ static errno_t amap_insert_unspec(amap_t *map, inet_ep2_t *epp, void *arg,
 		return rc;
 	}
 
+	rc = amap_match_insert(map, amk_unspec, &mepp, arg);
+	if (rc != EOK) {
+		portrng_free_port(map->unspec, mepp.local.port);
+		return rc;
+	}
+
 	*aepp = mepp;
 	return EOK;
 }
@@ -606,6 +897,7 @@ static void amap_remove_repla(amap_t *map, inet_ep2_t *epp)
 		return;
 	}
 
+	amap_match_remove(map, amk_repla, epp);
 	portrng_free_port(repla->portrng, epp->local.port);
 
 	if (portrng_empty(repla->portrng))
@@ -631,6 +923,7 @@ static void amap_remove_laddr(amap_t *map, inet_ep2_t *epp)
 		return;
 	}
 
+	amap_match_remove(map, amk_laddr, epp);
 	portrng_free_port(laddr->portrng, epp->local.port);
 
 	if (portrng_empty(laddr->portrng))
@@ -656,6 +949,7 @@ static void amap_remove_llink(amap_t *map, inet_ep2_t *epp)
 		return;
 	}
 
+	amap_match_remove(map, amk_llink, epp);
 	portrng_free_port(llink->portrng, epp->local.port);
 
 	if (portrng_empty(llink->portrng))
@@ -672,6 +966,7 @@ static void amap_remove_llink(amap_t *map, inet_ep2_t *epp)
  */
 static void amap_remove_unspec(amap_t *map, inet_ep2_t *epp)
 {
+	amap_match_remove(map, amk_unspec, epp);
 	portrng_free_port(map->unspec, epp->local.port);
 }
 
@@ -712,7 +1007,8 @@ void amap_remove(amap_t *map, inet_ep2_t *epp)
 
 /** Find association matching an endpoint pair.
  *
- * Used to find which association to deliver a datagram to.
+ * Used to find which association to deliver a datagram to. Entries are
+ * tried from the most specific kind to the least specific one.
  *
  * @param map	Association map
  * @param epp	Endpoint pair
@@ -722,58 +1018,29 @@ void amap_remove(amap_t *map, inet_ep2_t *epp)
  */
 errno_t amap_find_match(amap_t *map, inet_ep2_t *epp, void **rarg)
 {
-	errno_t rc;
-	amap_repla_t *repla;
-	amap_laddr_t *laddr;
-	amap_llink_t *llink;
+	amap_kind_t kind;
+	amap_ent_t *ent;
+	inet_ep2_t key;
+	ht_link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "amap_find_match(llink=%zu)",
 	    epp->local_link);
 
-	/* Remode endpoint, local address */
-	rc = amap_repla_find(map, &epp->remote, &epp->local.addr, &repla);
-	if (rc == EOK) {
-		rc = portrng_find_port(repla->portrng, epp->local.port,
-		    rarg);
-		if (rc == EOK) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched repla / "
-			    "port %" PRIu16, epp->local.port);
+	for (kind = 0; kind < amk_limit; kind++) {
+		if (kind == amk_llink && epp->local_link == 0)
+			continue;
+
+		amap_match_key(kind, epp, &key);
+		link = hash_table_find(&map->match[kind], &key);
+		if (link != NULL) {
+			ent = hash_table_get_inst(link, amap_ent_t, lmatch);
+			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched kind %d / "
+			    "port %" PRIu16, kind, epp->local.port);
+			*rarg = ent->arg;
 			return EOK;
 		}
 	}
 
-	/* Local address */
-	rc = amap_laddr_find(map, &epp->local.addr, &laddr);
-	if (rc == EOK) {
-		rc = portrng_find_port(laddr->portrng, epp->local.port,
-		    rarg);
-		if (rc == EOK) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched laddr / "
-			    "port %" PRIu16, epp->local.port);
-			return EOK;
-		}
-	}
-
-	/* Local link */
-	rc = amap_llink_find(map, epp->local_link, &llink);
-	if (epp->local_link != 0 && rc == EOK) {
-		rc = portrng_find_port(llink->portrng, epp->local.port,
-		    rarg);
-		if (rc == EOK) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched llink / "
-			    "port %" PRIu16, epp->local.port);
-			return EOK;
-		}
-	}
-
-	/* Unspecified */
-	rc = portrng_find_port(map->unspec, epp->local.port, rarg);
-	if (rc == EOK) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "Matched unspec / port %" PRIu16,
-		    epp->local.port);
-		return EOK;
-	}
-
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "No match.");
 	return ENOENT;
 }
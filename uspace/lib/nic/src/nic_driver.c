@@ -36,6 +36,7 @@
  * @brief Internal implementation of general NIC operations
  */
 
+#include <align.h>
 #include <assert.h>
 #include <fibril_synch.h>
 #include <ns.h>
@@ -45,6 +46,7 @@
 #include <as.h>
 #include <ddf/interrupt.h>
 #include <ops/nic.h>
+#include <nic_iface.h>
 #include <errno.h>
 
 #include "nic_driver.h"
@@ -508,14 +510,14 @@ void nic_set_tx_busy(nic_t *nic_data, int busy)
 }
 
 /**
- * This is the function that the driver should call when it receives a frame.
- * The frame is checked by filters and then sent up to the NIL layer or
- * discarded. The frame is released.
+ * Check a received frame by filters and update the statistics.
  *
  * @param nic_data
  * @param frame		The received frame
+ *
+ * @return True if the frame should be sent up to the NIL layer
  */
-void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+static bool nic_received_check(nic_t *nic_data, nic_frame_t *frame)
 {
 	/*
 	 * Note: this function must not lock main lock, because loopback driver
@@ -543,21 +545,37 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 			break;
 		}
 		fibril_rwlock_write_unlock(&nic_data->stats_lock);
+		return true;
+	}
+
+	switch (frame_type) {
+	case NIC_FRAME_UNICAST:
+		nic_data->stats.receive_filtered_unicast++;
+		break;
+	case NIC_FRAME_MULTICAST:
+		nic_data->stats.receive_filtered_multicast++;
+		break;
+	case NIC_FRAME_BROADCAST:
+		nic_data->stats.receive_filtered_broadcast++;
+		break;
+	}
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+	return false;
+}
+
+/**
+ * This is the function that the driver should call when it receives a frame.
+ * The frame is checked by filters and then sent up to the NIL layer or
+ * discarded. The frame is released.
+ *
+ * @param nic_data
+ * @param frame		The received frame
+ */
+void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+{
+	if (nic_received_check(nic_data, frame)) {
 		nic_ev_received(nic_data->client_session, frame->data,
 		    frame->size);
-	} else {
-		switch (frame_type) {
-		case NIC_FRAME_UNICAST:
-			nic_data->stats.receive_filtered_unicast++;
-			break;
-		case NIC_FRAME_MULTICAST:
-			nic_data->stats.receive_filtered_multicast++;
-			break;
-		case NIC_FRAME_BROADCAST:
-			nic_data->stats.receive_filtered_broadcast++;
-			break;
-		}
-		fibril_rwlock_write_unlock(&nic_data->stats_lock);
 	}
 	nic_release_frame(nic_data, frame);
 }
@@ -565,8 +583,8 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 /**
  * Some NICs can receive multiple frames during single interrupt. These can
  * send them in whole list of frames (actually nic_frame_t structures), then
- * the list is deallocated and each frame is passed to the
- * nic_received_packet function.
+ * the list is deallocated. The frames are checked by filters and those which
+ * pass are sent up to the NIL layer in a single batch.
  *
  * @param nic_data
  * @param frames		List of received frames
@@ -575,12 +593,54 @@ void nic_received_frame_list(nic_t *nic_data, nic_frame_list_t *frames)
 {
 	if (frames == NULL)
 		return;
+
+	size_t count = 0;
+	size_t size = 0;
+
+	/* Drop frames which do not pass the filters. */
+	list_foreach_safe(*frames, cur, next) {
+		nic_frame_t *frame = list_get_instance(cur, nic_frame_t, link);
+
+		if (nic_received_check(nic_data, frame)) {
+			count++;
+			size += ALIGN_UP(sizeof(nic_batch_frame_t) + frame->size,
+			    NIC_BATCH_ALIGN);
+		} else {
+			list_remove(&frame->link);
+			nic_release_frame(nic_data, frame);
+		}
+	}
+
+	void *batch = NULL;
+	if (count > 1)
+		batch = malloc(size);
+
+	if (batch != NULL) {
+		size_t offset = 0;
+
+		list_foreach(*frames, link, nic_frame_t, frame) {
+			nic_batch_frame_t *hdr = batch + offset;
+			hdr->size = frame->size;
+			memcpy(&hdr[1], frame->data, frame->size);
+			offset += ALIGN_UP(sizeof(nic_batch_frame_t) +
+			    frame->size, NIC_BATCH_ALIGN);
+		}
+
+		nic_ev_received_batch(nic_data->client_session, batch, size,
+		    count);
+		free(batch);
+	}
+
 	while (!list_empty(frames)) {
 		nic_frame_t *frame =
 		    list_get_instance(list_first(frames), nic_frame_t, link);
 
 		list_remove(&frame->link);
-		nic_received_frame(nic_data, frame);
+		if (batch == NULL) {
+			nic_ev_received(nic_data->client_session, frame->data,
+			    frame->size);
+		}
+		nic_release_frame(nic_data, frame);
 	}
 	nic_driver_release_frame_list(frames);
 }
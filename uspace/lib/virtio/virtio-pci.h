@@ -63,6 +63,9 @@
 
 #define VIRTIO_F_VERSION_1	1
 
+/** Device and driver use the used_event and avail_event fields. */
+#define VIRTIO_F_RING_EVENT_IDX	(1U << 29)
+
 /** Common configuration structure layout according to VIRTIO version 1.0 */
 typedef struct virtio_pci_common_cfg {
 	ioport32_t device_feature_select;
@@ -151,6 +154,9 @@ typedef struct {
 	virtq_used_t *used;
 	uint16_t used_last_idx;
 
+	/** Available ring index at the time of the last notification */
+	uint16_t avail_notified_idx;
+
 	/** Address of the queue's notification register */
 	ioport16_t *notify;
 } virtq_t;
@@ -181,6 +187,9 @@ typedef struct {
 
 	/** Virtqueues */
 	virtq_t *queues;
+
+	/** Negotiated feature flags (bits 0 - 31) */
+	uint32_t features;
 } virtio_dev_t;
 
 extern errno_t virtio_setup_dma_bufs(unsigned int, size_t, bool, void *[],
@@ -198,13 +207,18 @@ extern uint16_t virtio_alloc_desc(virtio_dev_t *, uint16_t, uint16_t *);
 extern void virtio_free_desc(virtio_dev_t *, uint16_t, uint16_t *, uint16_t);
 
 extern void virtio_virtq_produce_available(virtio_dev_t *, uint16_t, uint16_t);
+extern void virtio_virtq_produce_available_deferred(virtio_dev_t *, uint16_t,
+    uint16_t);
+extern void virtio_virtq_notify(virtio_dev_t *, uint16_t);
+extern void virtio_virtq_request_interrupt(virtio_dev_t *, uint16_t, uint16_t);
+extern void virtio_virtq_suppress_interrupt(virtio_dev_t *, uint16_t);
 extern bool virtio_virtq_consume_used(virtio_dev_t *, uint16_t, uint16_t *,
     uint32_t *);
 
 extern errno_t virtio_virtq_setup(virtio_dev_t *, uint16_t, uint16_t);
 extern void virtio_virtq_teardown(virtio_dev_t *, uint16_t);
 
-extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t);
+extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t, uint32_t);
 extern void virtio_device_setup_fail(virtio_dev_t *);
 extern void virtio_device_setup_finalize(virtio_dev_t *);
 
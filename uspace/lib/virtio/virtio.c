@@ -33,6 +33,7 @@
 
 #include <as.h>
 #include <align.h>
+#include <assert.h>
 #include <macros.h>
 #include <stdalign.h>
 
@@ -170,8 +171,30 @@ void virtio_free_desc(virtio_dev_t *vdev, uint16_t num, uint16_t *head,
 	fibril_mutex_unlock(&q->lock);
 }
 
+/** Put a descriptor into the available ring and notify the device
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param descno[in]  Head of the descriptor chain to make available.
+ */
 void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
     uint16_t descno)
+{
+	virtio_virtq_produce_available_deferred(vdev, num, descno);
+	virtio_virtq_notify(vdev, num);
+}
+
+/** Put a descriptor into the available ring without notifying the device
+ *
+ * Use this to make a batch of descriptors available at once and then
+ * notify the device only once using virtio_virtq_notify().
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param descno[in]  Head of the descriptor chain to make available.
+ */
+void virtio_virtq_produce_available_deferred(virtio_dev_t *vdev, uint16_t num,
+    uint16_t descno)
 {
 	virtq_t *q = &vdev->queues[num];
 
@@ -180,8 +203,100 @@ void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
 	pio_write_le16(&q->avail->ring[idx % q->queue_size], descno);
 	write_barrier();
 	pio_write_le16(&q->avail->idx, idx + 1);
-	write_barrier();
-	pio_write_le16(q->notify, num);
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Notify the device about new available descriptors
+ *
+ * The notification is skipped if the device does not need it, i.e. if
+ * it has not yet processed the descriptors made available since the
+ * last notification (VIRTIO_F_RING_EVENT_IDX) or if it asked not to be
+ * notified (VIRTQ_USED_F_NO_NOTIFY).
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ */
+void virtio_virtq_notify(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	uint16_t new_idx = pio_read_le16(&q->avail->idx);
+	uint16_t old_idx = q->avail_notified_idx;
+	if (new_idx == old_idx) {
+		fibril_mutex_unlock(&q->lock);
+		return;
+	}
+
+	/* Order the index update before reading the device's wishes. */
+	memory_barrier();
+
+	bool notify;
+	if (vdev->features & VIRTIO_F_RING_EVENT_IDX) {
+		/* The avail_event field follows the used ring. */
+		ioport16_t *avail_event =
+		    (ioport16_t *) &q->used->ring[q->queue_size];
+		uint16_t event = pio_read_le16(avail_event);
+
+		notify = (uint16_t) (new_idx - event - 1) <
+		    (uint16_t) (new_idx - old_idx);
+	} else {
+		notify = !(pio_read_le16(&q->used->flags) &
+		    VIRTQ_USED_F_NO_NOTIFY);
+	}
+
+	q->avail_notified_idx = new_idx;
+	if (notify)
+		pio_write_le16(q->notify, num);
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Ask the device to interrupt after more buffers are used
+ *
+ * Without VIRTIO_F_RING_EVENT_IDX, the device interrupts on each used
+ * buffer once this function is called.
+ *
+ * @param vdev[in]   VIRTIO device.
+ * @param num[in]    Index of the virtqueue.
+ * @param count[in]  Number of buffers not yet consumed by the driver the
+ *                   device should use before interrupting, at least 1.
+ */
+void virtio_virtq_request_interrupt(virtio_dev_t *vdev, uint16_t num,
+    uint16_t count)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	assert(count > 0);
+
+	fibril_mutex_lock(&q->lock);
+	if (vdev->features & VIRTIO_F_RING_EVENT_IDX) {
+		/* The used_event field follows the available ring. */
+		ioport16_t *used_event = &q->avail->ring[q->queue_size];
+		pio_write_le16(used_event, q->used_last_idx + count - 1);
+	}
+	pio_write_le16(&q->avail->flags, 0);
+	memory_barrier();
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Ask the device not to interrupt when buffers are used
+ *
+ * This is only a hint to the device.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ */
+void virtio_virtq_suppress_interrupt(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	if (vdev->features & VIRTIO_F_RING_EVENT_IDX) {
+		/* Push the event as far as possible. */
+		ioport16_t *used_event = &q->avail->ring[q->queue_size];
+		pio_write_le16(used_event, q->used_last_idx - 1);
+	}
+	pio_write_le16(&q->avail->flags, VIRTQ_AVAIL_F_NO_INTERRUPT);
 	fibril_mutex_unlock(&q->lock);
 }
 
@@ -191,12 +306,18 @@ bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
 	virtq_t *q = &vdev->queues[num];
 
 	fibril_mutex_lock(&q->lock);
-	uint16_t last_idx = q->used_last_idx % q->queue_size;
-	if (last_idx == (pio_read_le16(&q->used->idx) % q->queue_size)) {
+
+	/*
+	 * Compare the free-running indices, their values modulo the queue
+	 * size are the same both for an empty and for a full ring.
+	 */
+	if (q->used_last_idx == pio_read_le16(&q->used->idx)) {
 		fibril_mutex_unlock(&q->lock);
 		return false;
 	}
 
+	uint16_t last_idx = q->used_last_idx % q->queue_size;
+
 	*descno = (uint16_t) pio_read_le32(&q->used->ring[last_idx].id);
 	*len = pio_read_le32(&q->used->ring[last_idx].len);
 
@@ -258,6 +379,7 @@ errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 	q->avail = q->virt + avail_offset;
 	q->used = q->virt + used_offset;
 	q->used_last_idx = 0;
+	q->avail_notified_idx = 0;
 
 	memset(q->virt, 0, q->size);
 
@@ -299,8 +421,14 @@ void virtio_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
 /**
  * Perform device initialization as described in section 3.1.1 of the
  * specification, steps 1 - 6.
+ *
+ * @param vdev[in]      VIRTIO device.
+ * @param features[in]  Feature flags the driver requires.
+ * @param optional[in]  Feature flags the driver uses if the device offers
+ *                      them.
  */
-errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
+errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features,
+    uint32_t optional)
 {
 	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
 
@@ -329,7 +457,9 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	if (features != (features & device_features))
 		return ENOTSUP;
+	features |= optional;
 	features &= device_features;
+	vdev->features = features;
 
 	if (reserved_features != (reserved_features & device_reserved_features))
 		return ENOTSUP;
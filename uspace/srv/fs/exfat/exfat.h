@@ -161,6 +161,17 @@ typedef struct exfat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	exfat_cluster_t	currc_cached_value;
+
+	/*
+	 * Map of a prefix of a fragmented node's cluster chain, built lazily
+	 * as the node is accessed. Lookups in it are logarithmic.
+	 */
+	fibril_mutex_t	extents_lock;
+	exfat_extent_t	*extents;
+	/* Number of runs in the map. */
+	size_t		extents_cnt;
+	/* Number of runs the map has room for. */
+	size_t		extents_max;
 } exfat_node_t;
 
 extern vfs_out_ops_t exfat_ops;
@@ -47,6 +47,7 @@
 #include <align.h>
 #include <assert.h>
 #include <fibril_synch.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include <str.h>
@@ -110,6 +111,195 @@ exfat_cluster_walk(exfat_bs_t *bs, service_id_t service_id,
 	return EOK;
 }
 
+/** Initial number of runs in a node's extent map. */
+#define EXFAT_EXTENTS_INIT	8
+/** Maximum number of runs in a node's extent map. */
+#define EXFAT_EXTENTS_MAX	4096
+
+/** Record the next cluster of the chain in the node's extent map.
+ *
+ * @param nodep		exFAT node.
+ * @param fci		Index of the cluster within the node.
+ * @param clst		The cluster.
+ *
+ * @return		True if the cluster was recorded, false if the map
+ *			is full.
+ */
+static bool exfat_extents_add(exfat_node_t *nodep, uint32_t fci,
+    exfat_cluster_t clst)
+{
+	if (nodep->extents_cnt > 0) {
+		exfat_extent_t *last = &nodep->extents[nodep->extents_cnt - 1];
+
+		assert(last->fci + last->len == fci);
+		if (last->pcl + last->len == clst) {
+			last->len++;
+			return true;
+		}
+	}
+
+	if (nodep->extents_cnt == nodep->extents_max) {
+		if (nodep->extents_max == EXFAT_EXTENTS_MAX)
+			return false;
+
+		size_t nmax = max(nodep->extents_max * 2, EXFAT_EXTENTS_INIT);
+		exfat_extent_t *extents = realloc(nodep->extents,
+		    nmax * sizeof(exfat_extent_t));
+		if (!extents)
+			return false;
+
+		nodep->extents = extents;
+		nodep->extents_max = nmax;
+	}
+
+	exfat_extent_t *ext = &nodep->extents[nodep->extents_cnt++];
+	ext->fci = fci;
+	ext->pcl = clst;
+	ext->len = 1;
+	return true;
+}
+
+/** Find a cluster of a fragmented node using its extent map.
+ *
+ * Clusters beyond the mapped part of the chain are looked up by walking the
+ * chain from the end of the map, recording the clusters seen on the way.
+ * The caller must hold the node's extents_lock.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		exFAT node.
+ * @param fci		Index of the cluster within the node.
+ * @param clp		Output argument holding the cluster.
+ *
+ * @return		EOK on success, ELIMIT if the map cannot grow to cover
+ *			the cluster or another error code.
+ */
+static errno_t _exfat_extents_lookup(exfat_bs_t *bs, exfat_node_t *nodep,
+    uint32_t fci, exfat_cluster_t *clp)
+{
+	exfat_cluster_t clst;
+	uint32_t next;
+	errno_t rc;
+
+	if (nodep->extents_cnt > 0) {
+		exfat_extent_t *last = &nodep->extents[nodep->extents_cnt - 1];
+
+		if (fci < last->fci + last->len) {
+			size_t lo = 0;
+			size_t hi = nodep->extents_cnt;
+
+			/* Find the last run starting at or before fci. */
+			while (hi - lo > 1) {
+				size_t mid = (lo + hi) / 2;
+				if (nodep->extents[mid].fci <= fci)
+					lo = mid;
+				else
+					hi = mid;
+			}
+
+			exfat_extent_t *ext = &nodep->extents[lo];
+			*clp = ext->pcl + (fci - ext->fci);
+			return EOK;
+		}
+
+		/* Continue the walk after the last mapped cluster. */
+		next = last->fci + last->len;
+		rc = exfat_get_cluster(bs, nodep->idx->service_id,
+		    last->pcl + last->len - 1, &clst);
+		if (rc != EOK)
+			return rc;
+	} else {
+		next = 0;
+		clst = nodep->firstc;
+	}
+
+	while (true) {
+		if (clst < EXFAT_CLST_FIRST || clst > EXFAT_CLST_LAST)
+			return EIO;	/* the chain is shorter than the node */
+
+		if (!exfat_extents_add(nodep, next, clst))
+			return ELIMIT;
+
+		if (next == fci)
+			break;
+
+		rc = exfat_get_cluster(bs, nodep->idx->service_id, clst,
+		    &clst);
+		if (rc != EOK)
+			return rc;
+		next++;
+	}
+
+	*clp = clst;
+	return EOK;
+}
+
+/** Find a cluster of a fragmented node using its extent map.
+ *
+ * The map is extended across blocking reads of the FAT, so the lookup is
+ * serialized with other lookups and with cutting of the map.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		exFAT node.
+ * @param fci		Index of the cluster within the node.
+ * @param clp		Output argument holding the cluster.
+ *
+ * @return		EOK on success, ELIMIT if the map cannot grow to cover
+ *			the cluster or another error code.
+ */
+static errno_t exfat_extents_lookup(exfat_bs_t *bs, exfat_node_t *nodep,
+    uint32_t fci, exfat_cluster_t *clp)
+{
+	fibril_mutex_lock(&nodep->extents_lock);
+	errno_t rc = _exfat_extents_lookup(bs, nodep, fci, clp);
+	fibril_mutex_unlock(&nodep->extents_lock);
+
+	return rc;
+}
+
+/** Cut the extent map of a node after a cluster.
+ *
+ * @param nodep		exFAT node.
+ * @param lcl		Last cluster which remains in the node or zero if no
+ *			cluster remains.
+ */
+static void exfat_extents_chop(exfat_node_t *nodep, exfat_cluster_t lcl)
+{
+	fibril_mutex_lock(&nodep->extents_lock);
+
+	if (lcl == 0) {
+		nodep->extents_cnt = 0;
+	} else {
+		for (size_t i = 0; i < nodep->extents_cnt; i++) {
+			exfat_extent_t *ext = &nodep->extents[i];
+
+			if (lcl >= ext->pcl && lcl < ext->pcl + ext->len) {
+				ext->len = lcl - ext->pcl + 1;
+				nodep->extents_cnt = i + 1;
+				break;
+			}
+		}
+
+		/*
+		 * If the cluster lies past the mapped part of the chain, the
+		 * map remains valid.
+		 */
+	}
+
+	fibril_mutex_unlock(&nodep->extents_lock);
+}
+
+/** Release the extent map of a node.
+ *
+ * @param nodep		exFAT node.
+ */
+void exfat_extents_fini(exfat_node_t *nodep)
+{
+	free(nodep->extents);
+	nodep->extents = NULL;
+	nodep->extents_cnt = 0;
+	nodep->extents_max = 0;
+}
+
 /** Read block from file located on a exFAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -144,6 +334,15 @@ exfat_block_get(block_t **block, exfat_bs_t *bs, exfat_node_t *nodep,
 			    (bn % SPC(bs)), flags);
 		}
 
+		rc = exfat_extents_lookup(bs, nodep, bn / SPC(bs), &currc);
+		if (rc == EOK) {
+			return block_get(block, nodep->idx->service_id,
+			    DATA_FS(bs) + (currc - EXFAT_CLST_FIRST) * SPC(bs) +
+			    (bn % SPC(bs)), flags);
+		}
+		if (rc != ELIMIT)
+			return rc;
+
 		if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
 			/*
 			 * We can start with the cluster cached by the previous call to
@@ -448,6 +647,7 @@ errno_t exfat_chop_clusters(exfat_bs_t *bs, exfat_node_t *nodep, exfat_cluster_t
 	nodep->lastc_cached_valid = false;
 	if (nodep->currc_cached_value != lcl)
 		nodep->currc_cached_valid = false;
+	exfat_extents_chop(nodep, lcl);
 
 	if (lcl == 0) {
 		/* The node will have zero size and no clusters allocated. */
@@ -57,6 +57,16 @@ struct exfat_bs;
 
 typedef uint32_t exfat_cluster_t;
 
+/** Run of physically contiguous clusters of a node. */
+typedef struct {
+	/** Index of the first cluster of the run within the node. */
+	uint32_t	fci;
+	/** First cluster of the run. */
+	exfat_cluster_t	pcl;
+	/** Number of clusters in the run. */
+	uint32_t	len;
+} exfat_extent_t;
+
 #define exfat_clusters_get(numc, bs, sid, fc) \
     exfat_cluster_walk((bs), (sid), (fc), NULL, (numc), (uint32_t) -1)
 
@@ -77,6 +87,7 @@ extern errno_t exfat_append_clusters(struct exfat_bs *, struct exfat_node *,
     exfat_cluster_t, exfat_cluster_t);
 extern errno_t exfat_chop_clusters(struct exfat_bs *, struct exfat_node *,
     exfat_cluster_t);
+extern void exfat_extents_fini(struct exfat_node *);
 extern errno_t exfat_alloc_clusters(struct exfat_bs *, service_id_t, unsigned,
     exfat_cluster_t *, exfat_cluster_t *);
 extern errno_t exfat_free_clusters(struct exfat_bs *, service_id_t, exfat_cluster_t);
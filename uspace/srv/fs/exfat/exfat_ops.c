@@ -112,6 +112,10 @@ static void exfat_node_initialize(exfat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	fibril_mutex_initialize(&node->extents_lock);
+	node->extents = NULL;
+	node->extents_cnt = 0;
+	node->extents_max = 0;
 }
 
 static errno_t exfat_node_sync(exfat_node_t *node)
@@ -200,6 +204,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		exfat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -238,6 +243,7 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				exfat_extents_fini(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -246,6 +252,7 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		exfat_extents_fini(nodep);
 		fn = FS_NODE(nodep);
 	} else {
 	skip_cache:
@@ -616,6 +623,7 @@ errno_t exfat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		exfat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -710,6 +718,7 @@ errno_t exfat_destroy_node(fs_node_t *fn)
 	}
 
 	exfat_idx_destroy(nodep->idx);
+	exfat_extents_fini(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -1075,6 +1084,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 	uint32_t clusters;
 	rc = exfat_clusters_get(&clusters, bs, service_id, rootp->firstc);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		(void) block_cache_fini(service_id);
 		block_fini(service_id);
@@ -1089,6 +1099,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 	exfat_dentry_t *de;
 	rc = exfat_directory_open(rootp, &di);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		(void) block_cache_fini(service_id);
 		block_fini(service_id);
@@ -1099,6 +1110,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 	/* Initialize the bitmap node. */
 	rc = exfat_directory_find(&di, EXFAT_DENTRY_BITMAP, &de);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		(void) block_cache_fini(service_id);
 		block_fini(service_id);
@@ -1109,6 +1121,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 	rc = exfat_node_get_new_by_pos(&bitmapp, service_id, rootp->firstc,
 	    di.pos);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		(void) block_cache_fini(service_id);
 		block_fini(service_id);
@@ -1129,6 +1142,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 	/* Initialize the uctable node. */
 	rc = exfat_directory_seek(&di, 0);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		free(bitmapp);
 		(void) block_cache_fini(service_id);
@@ -1139,6 +1153,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 
 	rc = exfat_directory_find(&di, EXFAT_DENTRY_UCTABLE, &de);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		free(bitmapp);
 		(void) block_cache_fini(service_id);
@@ -1150,6 +1165,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 	rc = exfat_node_get_new_by_pos(&uctablep, service_id, rootp->firstc,
 	    di.pos);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		free(bitmapp);
 		(void) block_cache_fini(service_id);
@@ -1173,6 +1189,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 		rc = exfat_directory_read_vollabel(&di, info->label,
 		    FS_LABEL_MAXLEN + 1);
 		if (rc != EOK) {
+			exfat_extents_fini(rootp);
 			free(rootp);
 			free(bitmapp);
 			free(uctablep);
@@ -1185,6 +1202,7 @@ static errno_t exfat_fs_open(service_id_t service_id, enum cache_mode cmode,
 
 	rc = exfat_directory_close(&di);
 	if (rc != EOK) {
+		exfat_extents_fini(rootp);
 		free(rootp);
 		free(bitmapp);
 		free(uctablep);
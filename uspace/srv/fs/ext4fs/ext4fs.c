@@ -50,7 +50,8 @@
 
 vfs_info_t ext4fs_vfs_info = {
 	.name = NAME,
-	.instance = 0
+	.instance = 0,
+	.page_cache = true
 };
 
 int main(int argc, char **argv)
@@ -253,6 +253,17 @@ typedef struct fat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Map of a prefix of the node's cluster chain, built lazily as the
+	 * node is accessed. Lookups in it are logarithmic.
+	 */
+	fibril_mutex_t	extents_lock;
+	fat_extent_t	*extents;
+	/* Number of runs in the map. */
+	size_t		extents_cnt;
+	/* Number of runs the map has room for. */
+	size_t		extents_max;
 } fat_node_t;
 
 typedef struct {
@@ -111,6 +111,10 @@ static void fat_node_initialize(fat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	fibril_mutex_initialize(&node->extents_lock);
+	node->extents = NULL;
+	node->extents_cnt = 0;
+	node->extents_max = 0;
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -192,6 +196,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -230,6 +235,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_extents_fini(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
@@ -238,6 +244,7 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 		idxp_tmp->nodep = NULL;
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
+		fat_extents_fini(nodep);
 		fn = FS_NODE(nodep);
 	} else {
 	skip_cache:
@@ -476,6 +483,7 @@ errno_t fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_extents_fini(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -569,6 +577,7 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_extents_fini(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -56,6 +56,7 @@ static vfs_info_t locfs_vfs_info = {
 	.name = NAME,
 	.concurrent_read_write = false,
 	.write_retains_size = false,
+	.page_cache = false,
 	.instance = 0,
 };
 
@@ -53,6 +53,7 @@ vfs_info_t mfs_vfs_info = {
 	.name = NAME,
 	.concurrent_read_write = false,
 	.write_retains_size = false,
+	.page_cache = false,
 	.instance = 0,
 };
 
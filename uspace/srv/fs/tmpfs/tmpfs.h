@@ -47,11 +47,28 @@ typedef enum {
 	TMPFS_DIRECTORY
 } tmpfs_dentry_type_t;
 
+/** Size of a page of file contents */
+#define TMPFS_PAGE_SIZE		4096
+
+/** Number of bits of a page number resolved by one level of the page tree */
+#define TMPFS_PAGE_TREE_BITS	6
+#define TMPFS_PAGE_TREE_SLOTS	(1 << TMPFS_PAGE_TREE_BITS)
+#define TMPFS_PAGE_TREE_MASK	(TMPFS_PAGE_TREE_SLOTS - 1)
+
+/** Interior node of the page tree of a file
+ *
+ * Leaves of the tree are TMPFS_PAGE_SIZE pages of file contents. A NULL slot
+ * stands for a hole, which reads as zeros and occupies no memory.
+ */
+typedef struct tmpfs_page_tree {
+	void *slot[TMPFS_PAGE_TREE_SLOTS];
+} tmpfs_page_tree_t;
+
 /* forward declaration */
 struct tmpfs_node;
 
 typedef struct tmpfs_dentry {
-	link_t link;		/**< Linkage for the list of siblings. */
+	libfs_dentry_t dentry;	/**< Linkage into the parent's name cache. */
 	struct tmpfs_node *node;/**< Back pointer to TMPFS node. */
 	char *name;		/**< Name of dentry. */
 } tmpfs_dentry_t;
@@ -63,9 +80,10 @@ typedef struct tmpfs_node {
 	ht_link_t nh_link;		/**< Nodes hash table link. */
 	tmpfs_dentry_type_t type;
 	unsigned lnkcnt;	/**< Link count. */
-	size_t size;		/**< File size if type is TMPFS_FILE. */
-	void *data;		/**< File content's if type is TMPFS_FILE. */
-	list_t cs_list;		/**< Child's siblings list. */
+	aoff64_t size;		/**< File size if type is TMPFS_FILE. */
+	void *pages;		/**< Page tree root if type is TMPFS_FILE. */
+	unsigned height;	/**< Interior levels of the page tree. */
+	libfs_dcache_t children;/**< Directory entries of the children. */
 } tmpfs_node_t;
 
 extern vfs_out_ops_t tmpfs_ops;
@@ -73,6 +91,10 @@ extern libfs_ops_t tmpfs_libfs_ops;
 
 extern bool tmpfs_init(void);
 
+extern void *tmpfs_page_find(tmpfs_node_t *, aoff64_t);
+extern void *tmpfs_page_get(tmpfs_node_t *, aoff64_t);
+extern void tmpfs_pages_truncate(tmpfs_node_t *, aoff64_t);
+
 #endif
 
 /**
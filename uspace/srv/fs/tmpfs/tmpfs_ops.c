@@ -58,6 +58,9 @@
 /** Global counter for assigning node indices. Shared by all instances. */
 fs_index_t tmpfs_next_index = 1;
 
+/** Contents of file holes. */
+static const uint8_t zero_page[TMPFS_PAGE_SIZE];
+
 /*
  * Implementation of the libfs interface.
  */
@@ -80,7 +83,7 @@ static errno_t tmpfs_root_get(fs_node_t **rfn, service_id_t service_id)
 
 static errno_t tmpfs_has_children(bool *has_children, fs_node_t *fn)
 {
-	*has_children = !list_empty(&TMPFS_NODE(fn)->cs_list);
+	*has_children = !libfs_dcache_empty(&TMPFS_NODE(fn)->children);
 	return EOK;
 }
 
@@ -170,18 +173,21 @@ static void nodes_remove_callback(ht_link_t *item)
 {
 	tmpfs_node_t *nodep = hash_table_get_inst(item, tmpfs_node_t, nh_link);
 
-	while (!list_empty(&nodep->cs_list)) {
-		tmpfs_dentry_t *dentryp = list_get_instance(
-		    list_first(&nodep->cs_list), tmpfs_dentry_t, link);
+	while (!libfs_dcache_empty(&nodep->children)) {
+		tmpfs_dentry_t *dentryp = member_to_inst(
+		    libfs_dcache_nth(&nodep->children, 0), tmpfs_dentry_t,
+		    dentry);
 
 		assert(nodep->type == TMPFS_DIRECTORY);
-		list_remove(&dentryp->link);
+		libfs_dcache_remove(&nodep->children, &dentryp->dentry);
+		free(dentryp->name);
 		free(dentryp);
 	}
+	libfs_dcache_fini(&nodep->children);
 
-	if (nodep->data) {
+	if (nodep->pages) {
 		assert(nodep->type == TMPFS_FILE);
-		free(nodep->data);
+		tmpfs_pages_truncate(nodep, 0);
 	}
 	free(nodep->bp);
 	free(nodep);
@@ -204,13 +210,13 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->type = TMPFS_NONE;
 	nodep->lnkcnt = 0;
 	nodep->size = 0;
-	nodep->data = NULL;
-	list_initialize(&nodep->cs_list);
+	nodep->pages = NULL;
+	nodep->height = 0;
+	libfs_dcache_initialize(&nodep->children);
 }
 
 static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
 {
-	link_initialize(&dentryp->link);
 	dentryp->name = NULL;
 	dentryp->node = NULL;
 }
@@ -254,12 +260,14 @@ static void tmpfs_instance_done(service_id_t service_id)
 errno_t tmpfs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
 	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
+	libfs_dentry_t *de;
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dentryp) {
-		if (!str_cmp(dentryp->name, component)) {
-			*rfn = FS_NODE(dentryp->node);
-			return EOK;
-		}
+	de = libfs_dcache_find(&parentp->children, component);
+	if (de != NULL) {
+		tmpfs_dentry_t *dentryp = member_to_inst(de, tmpfs_dentry_t,
+		    dentry);
+		*rfn = FS_NODE(dentryp->node);
+		return EOK;
 	}
 
 	*rfn = NULL;
@@ -342,7 +350,7 @@ errno_t tmpfs_destroy_node(fs_node_t *fn)
 	tmpfs_node_t *nodep = TMPFS_NODE(fn);
 
 	assert(!nodep->lnkcnt);
-	assert(list_empty(&nodep->cs_list));
+	assert(libfs_dcache_empty(&nodep->children));
 
 	hash_table_remove_item(&nodes, &nodep->nh_link);
 
@@ -362,10 +370,8 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	assert(parentp->type == TMPFS_DIRECTORY);
 
 	/* Check for duplicit entries. */
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm))
-			return EEXIST;
-	}
+	if (libfs_dcache_find(&parentp->children, nm) != NULL)
+		return EEXIST;
 
 	/* Allocate and initialize the dentry. */
 	dentryp = malloc(sizeof(tmpfs_dentry_t));
@@ -383,7 +389,8 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	str_cpy(dentryp->name, size + 1, nm);
 	dentryp->node = childp;
 	childp->lnkcnt++;
-	list_append(&dentryp->link, &parentp->cs_list);
+	libfs_dcache_insert(&parentp->children, &dentryp->dentry,
+	    dentryp->name);
 
 	return EOK;
 }
@@ -391,28 +398,26 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 errno_t tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 {
 	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
-	tmpfs_node_t *childp = NULL;
+	tmpfs_node_t *childp;
 	tmpfs_dentry_t *dentryp;
+	libfs_dentry_t *de;
 
 	if (!parentp)
 		return EBUSY;
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm)) {
-			dentryp = dp;
-			childp = dentryp->node;
-			assert(FS_NODE(childp) == cfn);
-			break;
-		}
-	}
-
-	if (!childp)
+	de = libfs_dcache_find(&parentp->children, nm);
+	if (de == NULL)
 		return ENOENT;
 
-	if ((childp->lnkcnt == 1) && !list_empty(&childp->cs_list))
+	dentryp = member_to_inst(de, tmpfs_dentry_t, dentry);
+	childp = dentryp->node;
+	assert(FS_NODE(childp) == cfn);
+
+	if ((childp->lnkcnt == 1) && !libfs_dcache_empty(&childp->children))
 		return ENOTEMPTY;
 
-	list_remove(&dentryp->link);
+	libfs_dcache_remove(&parentp->children, &dentryp->dentry);
+	free(dentryp->name);
 	free(dentryp);
 	childp->lnkcnt--;
 
@@ -491,28 +496,37 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	size_t bytes;
 	if (nodep->type == TMPFS_FILE) {
-		bytes = min(nodep->size - pos, size);
-		(void) async_data_read_finalize(&call, nodep->data + pos,
-		    bytes);
+		/*
+		 * Serve at most the rest of the page containing pos. Holes
+		 * are read from the zero page.
+		 */
+		bytes = 0;
+		if (pos < nodep->size) {
+			bytes = min(nodep->size - pos, size);
+			bytes = min(bytes, TMPFS_PAGE_SIZE -
+			    (pos % TMPFS_PAGE_SIZE));
+		}
+
+		uint8_t *page = tmpfs_page_find(nodep, pos / TMPFS_PAGE_SIZE);
+		if (page != NULL)
+			(void) async_data_read_finalize(&call,
+			    page + (pos % TMPFS_PAGE_SIZE), bytes);
+		else
+			(void) async_data_read_finalize(&call, zero_page,
+			    bytes);
 	} else {
 		tmpfs_dentry_t *dentryp;
-		link_t *lnk;
+		libfs_dentry_t *de;
 
 		assert(nodep->type == TMPFS_DIRECTORY);
 
-		/*
-		 * Yes, we really use O(n) algorithm here.
-		 * If it bothers someone, it could be fixed by introducing a
-		 * hash table.
-		 */
-		lnk = list_nth(&nodep->cs_list, pos);
-
-		if (lnk == NULL) {
+		de = libfs_dcache_nth(&nodep->children, pos);
+		if (de == NULL) {
 			async_answer_0(&call, ENOENT);
 			return ENOENT;
 		}
 
-		dentryp = list_get_instance(lnk, tmpfs_dentry_t, link);
+		dentryp = member_to_inst(de, tmpfs_dentry_t, dentry);
 
 		(void) async_data_read_finalize(&call, dentryp->name,
 		    str_size(dentryp->name) + 1);
@@ -553,33 +567,22 @@ tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	}
 
 	/*
-	 * Check whether the file needs to grow.
+	 * Write at most up to the end of the page containing pos. The page is
+	 * allocated on demand, pages skipped over remain holes.
 	 */
-	if (pos + size <= nodep->size) {
-		/* The file size is not changing. */
-		(void) async_data_write_finalize(&call, nodep->data + pos,
-		    size);
-		goto out;
-	}
-	size_t delta = (pos + size) - nodep->size;
-	/*
-	 * At this point, we are deliberately extremely straightforward and
-	 * simply realloc the contents of the file on every write that grows the
-	 * file. In the end, the situation might not be as bad as it may look:
-	 * our heap allocator can save us and just grow the block whenever
-	 * possible.
-	 */
-	void *newdata = realloc(nodep->data, nodep->size + delta);
-	if (!newdata) {
+	size = min(size, TMPFS_PAGE_SIZE - (pos % TMPFS_PAGE_SIZE));
+
+	uint8_t *page = tmpfs_page_get(nodep, pos / TMPFS_PAGE_SIZE);
+	if (!page) {
 		async_answer_0(&call, ENOMEM);
 		size = 0;
 		goto out;
 	}
-	/* Clear any newly allocated memory in order to emulate gaps. */
-	memset(newdata + nodep->size, 0, delta);
-	nodep->size += delta;
-	nodep->data = newdata;
-	(void) async_data_write_finalize(&call, nodep->data + pos, size);
+
+	(void) async_data_write_finalize(&call,
+	    page + (pos % TMPFS_PAGE_SIZE), size);
+	if (pos + size > nodep->size)
+		nodep->size = pos + size;
 
 out:
 	*wbytes = size;
@@ -606,20 +609,14 @@ static errno_t tmpfs_truncate(service_id_t service_id, fs_index_t index,
 	if (size == nodep->size)
 		return EOK;
 
-	if (size > SIZE_MAX)
-		return ENOMEM;
-
-	void *newdata = realloc(nodep->data, size);
-	if (!newdata && size)
-		return ENOMEM;
-
-	if (size > nodep->size) {
-		size_t delta = size - nodep->size;
-		memset(newdata + nodep->size, 0, delta);
-	}
+	/*
+	 * Growing the file just extends its trailing hole. The part of the
+	 * last page past the end of the file is always kept zeroed.
+	 */
+	if (size < nodep->size)
+		tmpfs_pages_truncate(nodep, size);
 
 	nodep->size = size;
-	nodep->data = newdata;
 	return EOK;
 }
 
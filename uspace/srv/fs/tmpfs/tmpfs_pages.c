@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tmpfs
+ * @{
+ */
+
+/**
+ * @file	tmpfs_pages.c
+ * @brief	Sparse page storage of TMPFS file contents.
+ *
+ * File contents are kept in a radix tree of TMPFS_PAGE_SIZE pages indexed
+ * by the page number. Pages are allocated on first write, so holes in
+ * sparse files take no memory, and growing a file never needs to move the
+ * data already written.
+ */
+
+#include "tmpfs.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <mem.h>
+
+/** Test whether a page tree of the given height covers a page number. */
+static bool page_tree_covers(unsigned height, aoff64_t pgno)
+{
+	unsigned bits = height * TMPFS_PAGE_TREE_BITS;
+
+	if (bits >= sizeof(aoff64_t) * 8)
+		return true;
+	return (pgno >> bits) == 0;
+}
+
+/** Find a page of file contents.
+ *
+ * @param nodep		TMPFS file node.
+ * @param pgno		Page number.
+ *
+ * @return		Page or NULL if the page is a hole.
+ */
+void *tmpfs_page_find(tmpfs_node_t *nodep, aoff64_t pgno)
+{
+	if (!page_tree_covers(nodep->height, pgno))
+		return NULL;
+
+	void *p = nodep->pages;
+	for (unsigned h = nodep->height; h > 0 && p != NULL; h--) {
+		tmpfs_page_tree_t *pt = p;
+		p = pt->slot[(pgno >> ((h - 1) * TMPFS_PAGE_TREE_BITS)) &
+		    TMPFS_PAGE_TREE_MASK];
+	}
+
+	return p;
+}
+
+/** Find or allocate a page of file contents.
+ *
+ * Newly allocated pages are zero-filled.
+ *
+ * @param nodep		TMPFS file node.
+ * @param pgno		Page number.
+ *
+ * @return		Page or NULL if out of memory.
+ */
+void *tmpfs_page_get(tmpfs_node_t *nodep, aoff64_t pgno)
+{
+	if (nodep->pages == NULL) {
+		while (!page_tree_covers(nodep->height, pgno))
+			nodep->height++;
+	}
+
+	while (!page_tree_covers(nodep->height, pgno)) {
+		tmpfs_page_tree_t *root = calloc(1, sizeof(tmpfs_page_tree_t));
+		if (root == NULL)
+			return NULL;
+
+		root->slot[0] = nodep->pages;
+		nodep->pages = root;
+		nodep->height++;
+	}
+
+	void **slotp = &nodep->pages;
+	for (unsigned h = nodep->height; h > 0; h--) {
+		if (*slotp == NULL) {
+			*slotp = calloc(1, sizeof(tmpfs_page_tree_t));
+			if (*slotp == NULL)
+				return NULL;
+		}
+
+		tmpfs_page_tree_t *pt = *slotp;
+		slotp = &pt->slot[(pgno >> ((h - 1) * TMPFS_PAGE_TREE_BITS)) &
+		    TMPFS_PAGE_TREE_MASK];
+	}
+
+	if (*slotp == NULL)
+		*slotp = calloc(1, TMPFS_PAGE_SIZE);
+
+	return *slotp;
+}
+
+/** Free a subtree of the page tree. */
+static void page_tree_free(void *p, unsigned height)
+{
+	if (p == NULL)
+		return;
+
+	if (height > 0) {
+		tmpfs_page_tree_t *pt = p;
+		for (unsigned i = 0; i < TMPFS_PAGE_TREE_SLOTS; i++)
+			page_tree_free(pt->slot[i], height - 1);
+	}
+
+	free(p);
+}
+
+/** Free pages of a subtree starting with a given page number.
+ *
+ * @param slotp		Slot holding the subtree.
+ * @param height	Height of the subtree.
+ * @param base		Number of the first page covered by the subtree.
+ * @param first		Number of the first page to free.
+ *
+ * @return		True if the subtree became empty and was freed.
+ */
+static bool page_tree_trim(void **slotp, unsigned height, aoff64_t base,
+    aoff64_t first)
+{
+	if (*slotp == NULL)
+		return true;
+
+	if (first <= base) {
+		page_tree_free(*slotp, height);
+		*slotp = NULL;
+		return true;
+	}
+
+	if (!page_tree_covers(height, first - base))
+		return false;
+
+	/* Leaves cover a single page, so only interior nodes get here. */
+	assert(height > 0);
+
+	tmpfs_page_tree_t *pt = *slotp;
+	aoff64_t span = (aoff64_t) 1 << ((height - 1) * TMPFS_PAGE_TREE_BITS);
+	bool empty = true;
+
+	for (unsigned i = 0; i < TMPFS_PAGE_TREE_SLOTS; i++) {
+		if (!page_tree_trim(&pt->slot[i], height - 1, base + i * span,
+		    first))
+			empty = false;
+	}
+
+	if (empty) {
+		free(pt);
+		*slotp = NULL;
+	}
+
+	return empty;
+}
+
+/** Cut file contents to a given size.
+ *
+ * Frees all pages past the new end of the file and clears the remainder of
+ * the last partial page so that the file can later grow over it.
+ *
+ * @param nodep		TMPFS file node.
+ * @param size		New size of the file.
+ */
+void tmpfs_pages_truncate(tmpfs_node_t *nodep, aoff64_t size)
+{
+	aoff64_t first = size / TMPFS_PAGE_SIZE;
+	size_t off = size % TMPFS_PAGE_SIZE;
+
+	if (off != 0) {
+		uint8_t *page = tmpfs_page_find(nodep, first);
+		if (page != NULL)
+			memset(page + off, 0, TMPFS_PAGE_SIZE - off);
+		first++;
+	}
+
+	(void) page_tree_trim(&nodep->pages, nodep->height, 0, first);
+
+	/* Shrink the tree while only its leftmost slot is in use. */
+	while (nodep->height > 0) {
+		tmpfs_page_tree_t *root = nodep->pages;
+		if (root == NULL) {
+			nodep->height = 0;
+			break;
+		}
+
+		for (unsigned i = 1; i < TMPFS_PAGE_TREE_SLOTS; i++) {
+			if (root->slot[i] != NULL)
+				return;
+		}
+
+		nodep->pages = root->slot[0];
+		nodep->height--;
+		free(root);
+	}
+}
+
+/**
+ * @}
+ */
@@ -35,6 +35,7 @@
  */
 
 #include <adt/list.h>
+#include <align.h>
 #include <async.h>
 #include <errno.h>
 #include <fibril_synch.h>
@@ -283,6 +284,52 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_call_t *call)
 	async_answer_0(call, rc);
 }
 
+static void ethip_nic_received_batch(ethip_nic_t *nic, ipc_call_t *call)
+{
+	errno_t rc;
+	void *data;
+	size_t size;
+	size_t count = ipc_get_arg1(call);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() nic=%p "
+	    "count=%zu", nic, count);
+
+	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "data_write_accept() failed");
+		return;
+	}
+
+	size_t offset = 0;
+	while (count > 0) {
+		if (size - offset < sizeof(nic_batch_frame_t)) {
+			rc = EINVAL;
+			break;
+		}
+
+		nic_batch_frame_t *hdr = data + offset;
+		if (size - offset - sizeof(nic_batch_frame_t) < hdr->size) {
+			rc = EINVAL;
+			break;
+		}
+
+		/* Errors in individual frames do not affect the others. */
+		(void) ethip_received(&nic->iplink, &hdr[1], hdr->size);
+
+		offset += ALIGN_UP(sizeof(nic_batch_frame_t) + hdr->size,
+		    NIC_BATCH_ALIGN);
+		if (offset > size)
+			offset = size;
+		count--;
+	}
+
+	free(data);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_batch() done, "
+	    "rc=%s", str_error_name(rc));
+	async_answer_0(call, rc);
+}
+
 static void ethip_nic_device_state(ethip_nic_t *nic, ipc_call_t *call)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_device_state()");
@@ -311,6 +358,9 @@ static void ethip_nic_cb_conn(ipc_call_t *icall, void *arg)
 		case NIC_EV_RECEIVED:
 			ethip_nic_received(nic, &call);
 			break;
+		case NIC_EV_RECEIVED_BATCH:
+			ethip_nic_received_batch(nic, &call);
+			break;
 		case NIC_EV_DEVICE_STATE:
 			ethip_nic_device_state(nic, &call);
 			break;
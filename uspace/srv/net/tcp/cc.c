@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file Congestion control
+ *
+ * Congestion window bookkeeping common to all algorithms (RFC 5681,
+ * RFC 6582). How the window grows and how much it is reduced on loss is
+ * delegated to the congestion control algorithm of the connection.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <macros.h>
+#include <stdint.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Congestion control algorithm used for new connections */
+const tcp_cc_ops_t *tcp_cc_default = &tcp_cc_newreno;
+
+/** Compute initial congestion window (RFC 5681 section 3.1).
+ *
+ * @param smss	Sender maximum segment size
+ * @return	Initial window in bytes
+ */
+static uint32_t tcp_cc_initial_window(uint32_t smss)
+{
+	if (smss > 2190)
+		return 2 * smss;
+	if (smss > 1095)
+		return 3 * smss;
+	return 4 * smss;
+}
+
+/** Initialize congestion control state of a new connection.
+ *
+ * @param conn	Connection
+ * @return	EOK on success or an error code
+ */
+errno_t tcp_cc_init(tcp_conn_t *conn)
+{
+	conn->cc.ops = tcp_cc_default;
+	conn->cc.priv = NULL;
+	conn->cc.cwnd = tcp_cc_initial_window(conn->smss);
+	/* Arbitrarily high, reduced in response to congestion */
+	conn->cc.ssthresh = UINT32_MAX;
+	conn->cc.dupacks = 0;
+	conn->cc.in_recovery = false;
+	conn->cc.recover = 0;
+
+	if (conn->cc.ops->init != NULL)
+		return conn->cc.ops->init(conn);
+
+	return EOK;
+}
+
+/** Set sender maximum segment size negotiated at connection setup.
+ *
+ * The initial congestion window depends on SMSS, it is recomputed.
+ * Must not be called once data has been sent.
+ *
+ * @param conn	Connection
+ * @param smss	Sender maximum segment size
+ */
+void tcp_cc_smss_set(tcp_conn_t *conn, uint32_t smss)
+{
+	conn->smss = smss;
+	conn->cc.cwnd = tcp_cc_initial_window(smss);
+}
+
+/** Finalize congestion control state.
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_fini(tcp_conn_t *conn)
+{
+	if (conn->cc.ops != NULL && conn->cc.ops->fini != NULL)
+		conn->cc.ops->fini(conn);
+}
+
+/** Return amount of data that has been sent, but not yet acked.
+ *
+ * @param conn	Connection
+ * @return	Flight size in bytes of sequence space
+ */
+uint32_t tcp_cc_flight_size(tcp_conn_t *conn)
+{
+	/*
+	 * After a retransmission timeout, segments which have not been
+	 * resent yet are considered lost.
+	 */
+	if (conn->retransmit.go_back)
+		return conn->retransmit.rexmit_nxt - conn->snd_una;
+
+	return conn->snd_nxt - conn->snd_una;
+}
+
+/** New data was acked outside of fast recovery.
+ *
+ * @param conn	Connection
+ * @param acked	Number of newly acked bytes of sequence space
+ */
+void tcp_cc_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	assert(!conn->cc.in_recovery);
+
+	conn->cc.dupacks = 0;
+	conn->cc.ops->cong_avoid(conn, acked);
+}
+
+/** Loss was detected.
+ *
+ * A segment which is lost again keeps the slow start threshold set when
+ * it was lost first, so that repeated backoff does not collapse it further
+ * (RFC 5681 section 3.1).
+ *
+ * @param conn	Connection
+ * @param ev	tcp_cc_ev_rto if the retransmission timer expired,
+ *		tcp_cc_ev_rto_again if it expired again for a segment which
+ *		has already been retransmitted, tcp_cc_ev_recovery if
+ *		entering fast recovery
+ */
+void tcp_cc_loss(tcp_conn_t *conn, tcp_cc_event_t ev)
+{
+	assert(ev == tcp_cc_ev_rto || ev == tcp_cc_ev_rto_again ||
+	    ev == tcp_cc_ev_recovery);
+
+	if (ev != tcp_cc_ev_rto_again)
+		conn->cc.ssthresh = conn->cc.ops->ssthresh(conn);
+	conn->cc.recover = conn->snd_nxt;
+
+	if (ev != tcp_cc_ev_recovery) {
+		/* Restart from the loss window */
+		conn->cc.cwnd = conn->smss;
+		conn->cc.in_recovery = false;
+		conn->cc.dupacks = 0;
+	} else {
+		/* Account for the segments that triggered the duplicate ACKs */
+		conn->cc.cwnd = conn->cc.ssthresh + 3 * conn->smss;
+		conn->cc.in_recovery = true;
+	}
+
+	if (conn->cc.ops->event != NULL)
+		conn->cc.ops->event(conn, ev);
+}
+
+/** Partial ACK was received during fast recovery.
+ *
+ * Deflate the window by the amount of new data acked and add back one
+ * segment if at least one segment's worth was acked (RFC 6582 section 3.2,
+ * step 5).
+ *
+ * @param conn	Connection
+ * @param acked	Number of newly acked bytes of sequence space
+ */
+void tcp_cc_partial_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	assert(conn->cc.in_recovery);
+
+	if (conn->cc.cwnd > acked)
+		conn->cc.cwnd -= acked;
+	else
+		conn->cc.cwnd = 0;
+
+	if (acked >= conn->smss)
+		conn->cc.cwnd += conn->smss;
+
+	conn->cc.cwnd = max(conn->cc.cwnd, conn->smss);
+}
+
+/** All data outstanding at the time of loss has been acked.
+ *
+ * Leave fast recovery (RFC 6582 section 3.2, step 3, option 1).
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_recovered(tcp_conn_t *conn)
+{
+	uint32_t flight;
+
+	assert(conn->cc.in_recovery);
+
+	flight = tcp_cc_flight_size(conn);
+	conn->cc.cwnd = min(conn->cc.ssthresh,
+	    max(flight, conn->smss) + conn->smss);
+	conn->cc.in_recovery = false;
+	conn->cc.dupacks = 0;
+
+	if (conn->cc.ops->event != NULL)
+		conn->cc.ops->event(conn, tcp_cc_ev_recovered);
+}
+
+/**
+ * @}
+ */
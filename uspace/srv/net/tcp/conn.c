@@ -42,13 +42,16 @@
 #include <nettl/amap.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
+#include "ncsim.h"
 #include "iqueue.h"
 #include "pdu.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "seq_no.h"
+#include "std.h"
 #include "tcp_type.h"
 #include "tqueue.h"
 #include "ucall.h"
@@ -56,6 +59,12 @@
 #define RCV_BUF_SIZE 4096/*2*/
 #define SND_BUF_SIZE 4096
 
+/** Sender MSS assumed when peer sends no MSS option (RFC 9293 3.7.1) */
+#define DEFAULT_SMSS 536
+
+/** Path MTU assumed in lieu of path MTU discovery */
+#define PATH_MTU 1500
+
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
 
@@ -163,6 +172,11 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 
 	tqueue_inited = true;
 
+	/* Set up congestion control */
+	conn->smss = DEFAULT_SMSS;
+	if (tcp_cc_init(conn) != EOK)
+		goto error;
+
 	/* Connection state change signalling */
 	fibril_condvar_initialize(&conn->cstate_cv);
 
@@ -215,6 +229,17 @@ static void tcp_conn_free(tcp_conn_t *conn)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_free(%p)", conn->name, conn);
 
 	assert(conn->mapped == false);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: sent %" PRIu64 " segments, "
+	    "retransmitted %" PRIu64 " (%" PRIu64 " fast, %" PRIu64 " timeouts), "
+	    "%" PRIu64 " dup ACKs, %" PRIu64 " bytes acked, SRTT=%lld us, "
+	    "RTO=%lld us, CWND=%" PRIu32, conn->name, conn->stats.seg_sent,
+	    conn->stats.seg_rexmit, conn->stats.fast_rexmit,
+	    conn->stats.rto_expired, conn->stats.dup_acks,
+	    conn->stats.bytes_acked, conn->retransmit.srtt,
+	    conn->retransmit.rto, conn->cc.cwnd);
+
+	tcp_cc_fini(conn);
 	tcp_tqueue_fini(&conn->retransmit);
 
 	fibril_mutex_lock(&conn_list_lock);
@@ -383,6 +408,7 @@ void tcp_conn_sync(tcp_conn_t *conn)
 	conn->iss = 1;
 	conn->snd_nxt = conn->iss;
 	conn->snd_una = conn->iss;
+	conn->cc.recover = conn->iss;
 	conn->ap = ap_active;
 
 	tcp_tqueue_ctrl_seg(conn, CTL_SYN);
@@ -483,6 +509,45 @@ static void tcp_reset_signal(tcp_conn_t *conn)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_reset_signal()", conn->name);
 }
 
+/** Determine largest segment size the path to the peer can carry.
+ *
+ * This is also the MSS advertised to the peer in our SYN.
+ *
+ * @param conn	Connection
+ * @return	Maximum segment size in bytes
+ */
+uint32_t tcp_conn_path_mss(tcp_conn_t *conn)
+{
+	size_t ip_hdr_size;
+
+	if (conn->ident.remote.addr.version == ip_v6)
+		ip_hdr_size = 40;
+	else
+		ip_hdr_size = 20;
+
+	return PATH_MTU - ip_hdr_size - sizeof(tcp_header_t);
+}
+
+/** Set sender maximum segment size from the peer's SYN.
+ *
+ * The MSS option of the peer is honored up to what the path can carry
+ * (RFC 9293 section 3.7.1).
+ *
+ * @param conn	Connection
+ * @param seg	SYN segment
+ */
+static void tcp_conn_smss_setup(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	uint32_t smss;
+
+	smss = seg->mss != 0 ? seg->mss : DEFAULT_SMSS;
+	smss = min(smss, tcp_conn_path_mss(conn));
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: SMSS = %" PRIu32, conn->name,
+	    smss);
+	tcp_cc_smss_set(conn, smss);
+}
+
 /** Determine if SYN has been received.
  *
  * @param conn	Connection
@@ -540,6 +605,7 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
+	tcp_conn_smss_setup(conn, seg);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "rcv_nxt=%u", conn->rcv_nxt);
 
@@ -550,6 +616,7 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 	conn->iss = 1;
 	conn->snd_nxt = conn->iss;
 	conn->snd_una = conn->iss;
+	conn->cc.recover = conn->iss;
 
 	/*
 	 * Surprisingly the spec does not deal with initial window setting.
@@ -614,6 +681,7 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
+	tcp_conn_smss_setup(conn, seg);
 
 	if ((seg->ctrl & CTL_ACK) != 0) {
 		conn->snd_una = seg->ack;
@@ -826,6 +894,10 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 			tcp_segment_delete(seg);
 			return cp_done;
+		} else if (seg->ack == conn->snd_una && seg->len == 0 &&
+		    seg->wnd == conn->snd_wnd && conn->snd_nxt != conn->snd_una) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Duplicate ACK.");
+			tcp_tqueue_dup_ack_received(conn);
 		} else {
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring duplicate ACK.");
 		}
@@ -1410,17 +1482,14 @@ static void tcp_transmit_segment(inet_ep2_t *epp, tcp_segment_t *seg)
 	tcp_segment_dump(seg);
 
 	if (tcp_conn_lb == tcp_lb_segment) {
-		/* Loop back segment */
-#if 0
-		tcp_ncsim_bounce_seg(sp, seg);
-#endif
-
-		/* Reverse the identification */
-		tcp_ep2_flipped(epp, &rident);
-
-		/* Insert segment back into rqueue */
+		/* Loop back segment through network condition simulator */
 		dseg = tcp_segment_dup(seg);
-		tcp_rqueue_insert_seg(&rident, dseg);
+		if (dseg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_WARN, "Not enough memory. Segment dropped.");
+			return;
+		}
+
+		tcp_ncsim_bounce_seg(epp, dseg);
 		return;
 	}
 
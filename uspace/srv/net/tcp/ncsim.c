@@ -36,6 +36,12 @@
  * Simulate network conditions for testing the reliability implementation:
  *    - variable latency
  *    - frame drop
+ *
+ * Segments looped back by the connection layer (tcp_lb_segment) pass
+ * through the simulator. With the default settings they pass unchanged,
+ * the server's --ncsim-drop and --ncsim-delay options turn the loopback on
+ * and enable the simulation. Delaying segments requires the simulator fibril
+ * to be running.
  */
 
 #include <adt/list.h>
@@ -51,9 +57,16 @@
 #include "segment.h"
 #include "tcp_type.h"
 
+/** Drop every n-th segment (zero to disable) */
+unsigned tcp_ncsim_drop_nth = 0;
+/** Maximum random delay of a segment in microseconds (zero to disable) */
+usec_t tcp_ncsim_max_delay = 0;
+
 static list_t sim_queue;
 static fibril_mutex_t sim_queue_lock;
 static fibril_condvar_t sim_queue_cv;
+/** Number of segments that passed through the simulator */
+static unsigned sim_seg_cnt;
 
 /** Initialize segment receive queue. */
 void tcp_ncsim_init(void)
@@ -76,24 +89,29 @@ void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_bounce_seg()");
-	tcp_ep2_flipped(epp, &rident);
-	tcp_rqueue_insert_seg(&rident, seg);
-	return;
 
-	if (0 /* rand() % 4 == 3 */) {
+	++sim_seg_cnt;
+	if (tcp_ncsim_drop_nth != 0 && sim_seg_cnt % tcp_ncsim_drop_nth == 0) {
 		/* Drop segment */
-		log_msg(LOG_DEFAULT, LVL_ERROR, "NCSim dropping segment");
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim dropping segment");
 		tcp_segment_delete(seg);
 		return;
 	}
 
+	if (tcp_ncsim_max_delay == 0) {
+		tcp_ep2_flipped(epp, &rident);
+		tcp_rqueue_insert_seg(&rident, seg);
+		return;
+	}
+
 	sqe = calloc(1, sizeof(tcp_squeue_entry_t));
 	if (sqe == NULL) {
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating SQE.");
+		tcp_segment_delete(seg);
 		return;
 	}
 
-	sqe->delay = rand() % (1000 * 1000);
+	sqe->delay = rand() % tcp_ncsim_max_delay;
 	sqe->epp = *epp;
 	sqe->seg = seg;
 
@@ -102,8 +120,11 @@ void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 	link = list_first(&sim_queue);
 	while (link != NULL && sqe->delay > 0) {
 		old_qe = list_get_instance(link, tcp_squeue_entry_t, link);
-		if (sqe->delay < old_qe->delay)
+		if (sqe->delay < old_qe->delay) {
+			/* Delays in the queue are relative to predecessor */
+			old_qe->delay -= sqe->delay;
 			break;
+		}
 
 		sqe->delay -= old_qe->delay;
 
@@ -113,7 +134,7 @@ void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 	}
 
 	if (link != NULL)
-		list_insert_after(&sqe->link, link);
+		list_insert_before(&sqe->link, link);
 	else
 		list_append(&sqe->link, &sim_queue);
 
@@ -137,14 +158,18 @@ static errno_t tcp_ncsim_fibril(void *arg)
 		while (list_empty(&sim_queue))
 			fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
 
-		do {
+		while (true) {
 			link = list_first(&sim_queue);
 			sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+			if (sqe->delay == 0)
+				break;
 
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - Sleep");
 			rc = fibril_condvar_wait_timeout(&sim_queue_cv,
 			    &sim_queue_lock, sqe->delay);
-		} while (rc != ETIMEOUT);
+			if (rc == ETIMEOUT)
+				break;
+		}
 
 		list_remove(link);
 		fibril_mutex_unlock(&sim_queue_lock);
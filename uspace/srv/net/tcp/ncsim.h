@@ -38,6 +38,9 @@
 #include <inet/endpoint.h>
 #include "tcp_type.h"
 
+extern unsigned tcp_ncsim_drop_nth;
+extern usec_t tcp_ncsim_max_delay;
+
 extern void tcp_ncsim_init(void);
 extern void tcp_ncsim_bounce_seg(inet_ep2_t *, tcp_segment_t *);
 extern void tcp_ncsim_fibril_start(void);
@@ -125,7 +125,8 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *hdr)
+static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t hdr_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -135,7 +136,7 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = (hdr_size / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -190,18 +191,68 @@ static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 	seg->up = uint16_t_be2host(hdr->urg_ptr);
 }
 
+/** Decode TCP options.
+ *
+ * Unknown options are skipped. Decoding stops at the end of option list
+ * or at a malformed option.
+ *
+ * @param opt	Options following the fixed part of the header
+ * @param size	Size of options in bytes
+ * @param seg	Segment to store decoded options to
+ */
+static void tcp_header_decode_opts(uint8_t *opt, size_t size,
+    tcp_segment_t *seg)
+{
+	size_t i = 0;
+
+	while (i < size) {
+		if (opt[i] == OPT_END_LIST)
+			break;
+
+		if (opt[i] == OPT_NOP) {
+			++i;
+			continue;
+		}
+
+		/* All other options have a length octet */
+		if (size - i < 2 || opt[i + 1] < 2 || opt[i + 1] > size - i)
+			break;
+
+		if (opt[i] == OPT_MAX_SEG_SIZE &&
+		    opt[i + 1] == OPT_MAX_SEG_SIZE_LEN)
+			seg->mss = ((uint16_t) opt[i + 2] << 8) | opt[i + 3];
+
+		i += opt[i + 1];
+	}
+}
+
 static errno_t tcp_header_encode(inet_ep2_t *epp, tcp_segment_t *seg,
     void **header, size_t *size)
 {
 	tcp_header_t *hdr;
+	size_t hdr_size;
+	uint8_t *opt;
 
-	hdr = calloc(1, sizeof(tcp_header_t));
+	hdr_size = sizeof(tcp_header_t);
+	if (seg->mss != 0)
+		hdr_size += OPT_MAX_SEG_SIZE_LEN;
+
+	hdr = calloc(1, hdr_size);
 	if (hdr == NULL)
 		return ENOMEM;
 
-	tcp_header_setup(epp, seg, hdr);
+	tcp_header_setup(epp, seg, hdr, hdr_size);
+
+	if (seg->mss != 0) {
+		opt = (uint8_t *) (hdr + 1);
+		opt[0] = OPT_MAX_SEG_SIZE;
+		opt[1] = OPT_MAX_SEG_SIZE_LEN;
+		opt[2] = seg->mss >> 8;
+		opt[3] = seg->mss & 0xff;
+	}
+
 	*header = hdr;
-	*size = sizeof(tcp_header_t);
+	*size = hdr_size;
 
 	return EOK;
 }
@@ -306,6 +357,12 @@ errno_t tcp_pdu_decode(tcp_pdu_t *pdu, inet_ep2_t *epp, tcp_segment_t **seg)
 	tcp_header_decode(pdu->header, nseg);
 	nseg->len += seq_no_control_len(nseg->ctrl);
 
+	if (pdu->header_size > sizeof(tcp_header_t)) {
+		tcp_header_decode_opts((uint8_t *) pdu->header +
+		    sizeof(tcp_header_t), pdu->header_size -
+		    sizeof(tcp_header_t), nseg);
+	}
+
 	hdr = (tcp_header_t *)pdu->header;
 
 	epp->local.port = uint16_t_be2host(hdr->dest_port);
@@ -87,6 +87,20 @@ bool seq_no_ack_duplicate(tcp_conn_t *conn, uint32_t seg_ack)
 	return diff == 0 || (diff & (0x1 << 31)) != 0;
 }
 
+/** Determine whether SND.UNA has reached sequence number @a sn.
+ *
+ * Used to find out whether all data outstanding at some earlier point
+ * has been acknowledged (SND.UNA >= sn). Best-effort comparison based
+ * on the difference, same as in seq_no_ack_duplicate().
+ */
+bool seq_no_una_reached(tcp_conn_t *conn, uint32_t sn)
+{
+	uint32_t diff;
+
+	diff = conn->snd_una - sn;
+	return (diff & (0x1 << 31)) == 0;
+}
+
 /** Determine if sequence number is in receive window. */
 bool seq_no_in_rcv_wnd(tcp_conn_t *conn, uint32_t sn)
 {
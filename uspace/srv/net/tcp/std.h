@@ -112,6 +112,12 @@ enum opt_kind {
 	OPT_MAX_SEG_SIZE	= 2
 };
 
+/** Option length, including kind and length octets */
+enum opt_len {
+	/** Maximum segment size */
+	OPT_MAX_SEG_SIZE_LEN	= 4
+};
+
 #endif
 
 /** @}
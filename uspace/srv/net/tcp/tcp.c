@@ -38,6 +38,7 @@
 #include <errno.h>
 #include <io/log.h>
 #include <stdio.h>
+#include <str.h>
 #include <task.h>
 
 #include "conn.h"
@@ -54,6 +55,59 @@ static tcp_rqueue_cb_t tcp_rqueue_cb = {
 	.seg_received = tcp_as_segment_arrived
 };
 
+static void syntax_print(void)
+{
+	fprintf(stderr, "Usage: %s [--ncsim-drop=<n>] [--ncsim-delay=<usec>]\n",
+	    NAME);
+	fprintf(stderr, "  --ncsim-drop=<n>      Drop every n-th looped back "
+	    "segment\n");
+	fprintf(stderr, "  --ncsim-delay=<usec>  Delay looped back segments "
+	    "randomly up to <usec>\n");
+	fprintf(stderr, "Either option loops all segments back instead of "
+	    "sending them to the network.\n");
+}
+
+/** Parse command line options.
+ *
+ * The options configure the network condition simulator, which allows
+ * exercising retransmission and congestion control. Since only segments
+ * looped back by the connection layer pass through the simulator, either
+ * option also turns the loopback on.
+ *
+ * @return EOK on success, EINVAL on invalid command line
+ */
+static errno_t tcp_parse_args(int argc, char **argv)
+{
+	const char *val;
+	uint32_t drop_nth;
+	uint64_t max_delay;
+	errno_t rc;
+
+	for (int arg = 1; arg < argc; arg++) {
+		if (str_test_prefix(argv[arg], "--ncsim-drop=")) {
+			val = argv[arg] + str_lsize(argv[arg], 13);
+			rc = str_uint32_t(val, NULL, 10, true, &drop_nth);
+			if (rc != EOK)
+				return EINVAL;
+
+			tcp_ncsim_drop_nth = drop_nth;
+			tcp_conn_lb = tcp_lb_segment;
+		} else if (str_test_prefix(argv[arg], "--ncsim-delay=")) {
+			val = argv[arg] + str_lsize(argv[arg], 14);
+			rc = str_uint64_t(val, NULL, 10, true, &max_delay);
+			if (rc != EOK || max_delay > INT32_MAX)
+				return EINVAL;
+
+			tcp_ncsim_max_delay = max_delay;
+			tcp_conn_lb = tcp_lb_segment;
+		} else {
+			return EINVAL;
+		}
+	}
+
+	return EOK;
+}
+
 static errno_t tcp_init(void)
 {
 	errno_t rc;
@@ -95,6 +149,11 @@ int main(int argc, char **argv)
 
 	printf(NAME ": TCP (Transmission Control Protocol) network module\n");
 
+	if (tcp_parse_args(argc, argv) != EOK) {
+		syntax_print();
+		return 1;
+	}
+
 	rc = log_init(NAME);
 	if (rc != EOK) {
 		printf(NAME ": Failed to initialize log.\n");
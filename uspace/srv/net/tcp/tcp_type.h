@@ -37,12 +37,14 @@
 
 #include <adt/list.h>
 #include <async.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <fibril.h>
 #include <fibril_synch.h>
 #include <refcount.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 
@@ -168,6 +170,8 @@ typedef struct {
 	uint32_t wnd;
 	/** Segment urgent pointer */
 	uint32_t up;
+	/** Maximum segment size option or zero if not present */
+	uint16_t mss;
 
 	/** Segment data, may be moved when trimming segment */
 	void *data;
@@ -207,6 +211,8 @@ typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Number of times the segment has been retransmitted */
+	unsigned rexmit_cnt;
 } tcp_tqueue_entry_t;
 
 /** Retransmission queue callbacks */
@@ -225,8 +231,95 @@ typedef struct {
 
 	/** Callbacks */
 	tcp_tqueue_cb_t *cb;
+
+	/** Smoothed round-trip time (usec) */
+	usec_t srtt;
+	/** Round-trip time variation (usec) */
+	usec_t rttvar;
+	/** Retransmission timeout (usec) */
+	usec_t rto;
+	/** Entry being timed for an RTT sample or @c NULL */
+	tcp_tqueue_entry_t *rtt_tqe;
+	/** Time when @c rtt_tqe was transmitted */
+	struct timespec rtt_start;
+	/**
+	 * Outstanding segments are being resent after a retransmission
+	 * timeout (go-back-N)
+	 */
+	bool go_back;
+	/** Sequence number up to which segments have been resent */
+	uint32_t rexmit_nxt;
 } tcp_tqueue_t;
 
+/** Congestion control events */
+typedef enum {
+	/** Retransmission timeout expired */
+	tcp_cc_ev_rto,
+	/** Retransmission timeout expired again for the same segment */
+	tcp_cc_ev_rto_again,
+	/** Loss detected by duplicate ACKs, entering fast recovery */
+	tcp_cc_ev_recovery,
+	/** All data outstanding at the time of loss has been acked */
+	tcp_cc_ev_recovered
+} tcp_cc_event_t;
+
+/** Congestion control algorithm
+ *
+ * The generic code (cc.c, tqueue.c) takes care of loss detection,
+ * retransmission and fast recovery. The algorithm only decides how
+ * the congestion window grows and how much it shrinks on loss.
+ */
+typedef struct {
+	/** Algorithm name */
+	const char *name;
+	/** Set up algorithm state of a new connection (optional) */
+	errno_t (*init)(tcp_conn_t *);
+	/** Free algorithm state (optional) */
+	void (*fini)(tcp_conn_t *);
+	/** New data was acked outside of recovery, grow congestion window */
+	void (*cong_avoid)(tcp_conn_t *, uint32_t);
+	/** Compute slow start threshold when loss is detected */
+	uint32_t (*ssthresh)(tcp_conn_t *);
+	/** Congestion event notification (optional) */
+	void (*event)(tcp_conn_t *, tcp_cc_event_t);
+} tcp_cc_ops_t;
+
+/** Congestion control state */
+typedef struct {
+	/** Algorithm */
+	const tcp_cc_ops_t *ops;
+	/** Algorithm private data */
+	void *priv;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** Connection is in fast recovery */
+	bool in_recovery;
+	/** SND.NXT at the time loss was last detected (RFC 6582 'recover') */
+	uint32_t recover;
+} tcp_cc_t;
+
+/** Connection statistics */
+typedef struct {
+	/** Segments transmitted (including retransmissions) */
+	uint64_t seg_sent;
+	/** Segments retransmitted */
+	uint64_t seg_rexmit;
+	/** Bytes of sequence space acknowledged by peer */
+	uint64_t bytes_acked;
+	/** Duplicate ACKs received */
+	uint64_t dup_acks;
+	/** Fast retransmissions (entries into fast recovery) */
+	uint64_t fast_rexmit;
+	/** Retransmission timer expirations */
+	uint64_t rto_expired;
+	/** RTT samples taken */
+	uint64_t rtt_samples;
+} tcp_conn_stats_t;
+
 /** Connection */
 struct tcp_conn {
 	char *name;
@@ -307,6 +400,13 @@ struct tcp_conn {
 	uint32_t snd_wl2;
 	/** Initial send sequence number */
 	uint32_t iss;
+	/** Sender maximum segment size */
+	uint32_t smss;
+
+	/** Congestion control */
+	tcp_cc_t cc;
+	/** Statistics */
+	tcp_conn_stats_t stats;
 
 	/** Receive next */
 	uint32_t rcv_nxt;
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+#include "../cc.h"
+#include "../tcp_type.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cc);
+
+/** Set up congestion control for a connection with given SMSS */
+static void cc_test_conn_init(tcp_conn_t *conn, uint32_t smss)
+{
+	errno_t rc;
+
+	memset(conn, 0, sizeof(tcp_conn_t));
+	conn->smss = smss;
+	conn->snd_una = 1000;
+	conn->snd_nxt = 1000;
+
+	rc = tcp_cc_init(conn);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Test initial window */
+PCUT_TEST(initial_window)
+{
+	tcp_conn_t conn;
+
+	cc_test_conn_init(&conn, 536);
+	PCUT_ASSERT_INT_EQUALS(4 * 536, conn.cc.cwnd);
+	PCUT_ASSERT_FALSE(conn.cc.in_recovery);
+	tcp_cc_fini(&conn);
+
+	cc_test_conn_init(&conn, 1460);
+	PCUT_ASSERT_INT_EQUALS(3 * 1460, conn.cc.cwnd);
+	tcp_cc_fini(&conn);
+
+	cc_test_conn_init(&conn, 4000);
+	PCUT_ASSERT_INT_EQUALS(2 * 4000, conn.cc.cwnd);
+	tcp_cc_fini(&conn);
+}
+
+/** Test NewReno slow start and congestion avoidance */
+PCUT_TEST(newreno_grow)
+{
+	tcp_conn_t conn;
+
+	cc_test_conn_init(&conn, 500);
+	conn.cc.ops = &tcp_cc_newreno;
+	conn.cc.cwnd = 1000;
+	conn.cc.ssthresh = 2000;
+
+	/* Slow start, increase by at most SMSS per ACK */
+	tcp_cc_ack(&conn, 300);
+	PCUT_ASSERT_INT_EQUALS(1300, conn.cc.cwnd);
+	tcp_cc_ack(&conn, 1000);
+	PCUT_ASSERT_INT_EQUALS(1800, conn.cc.cwnd);
+	tcp_cc_ack(&conn, 500);
+	PCUT_ASSERT_INT_EQUALS(2300, conn.cc.cwnd);
+
+	/* Congestion avoidance, increase by SMSS * SMSS / CWND per ACK */
+	conn.cc.cwnd = 5000;
+	tcp_cc_ack(&conn, 500);
+	PCUT_ASSERT_INT_EQUALS(5050, conn.cc.cwnd);
+
+	tcp_cc_fini(&conn);
+}
+
+/** Test reaction to retransmission timeout */
+PCUT_TEST(loss_rto)
+{
+	tcp_conn_t conn;
+
+	cc_test_conn_init(&conn, 500);
+	conn.cc.ops = &tcp_cc_newreno;
+	conn.snd_nxt = conn.snd_una + 8000;
+
+	tcp_cc_loss(&conn, tcp_cc_ev_rto);
+	PCUT_ASSERT_INT_EQUALS(4000, conn.cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(500, conn.cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(conn.snd_nxt, conn.cc.recover);
+	PCUT_ASSERT_FALSE(conn.cc.in_recovery);
+
+	/* Slow start threshold is at least two segments */
+	conn.snd_nxt = conn.snd_una + 500;
+	tcp_cc_loss(&conn, tcp_cc_ev_rto);
+	PCUT_ASSERT_INT_EQUALS(1000, conn.cc.ssthresh);
+
+	tcp_cc_fini(&conn);
+}
+
+/** Test repeated retransmission timeout of the same segment */
+PCUT_TEST(loss_rto_again)
+{
+	tcp_conn_t conn;
+
+	cc_test_conn_init(&conn, 500);
+	conn.cc.ops = &tcp_cc_newreno;
+	conn.snd_nxt = conn.snd_una + 8000;
+
+	tcp_cc_loss(&conn, tcp_cc_ev_rto);
+	PCUT_ASSERT_INT_EQUALS(4000, conn.cc.ssthresh);
+
+	/* Flight size is down to one segment, but ssthresh is kept */
+	conn.cc.cwnd = 2000;
+	tcp_cc_loss(&conn, tcp_cc_ev_rto_again);
+	PCUT_ASSERT_INT_EQUALS(4000, conn.cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(500, conn.cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(conn.snd_nxt, conn.cc.recover);
+	PCUT_ASSERT_FALSE(conn.cc.in_recovery);
+
+	tcp_cc_fini(&conn);
+}
+
+/** Test fast recovery with partial and full ACK */
+PCUT_TEST(loss_recovery)
+{
+	tcp_conn_t conn;
+
+	cc_test_conn_init(&conn, 500);
+	conn.cc.ops = &tcp_cc_newreno;
+	conn.snd_nxt = conn.snd_una + 8000;
+
+	tcp_cc_loss(&conn, tcp_cc_ev_recovery);
+	PCUT_ASSERT_TRUE(conn.cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(4000, conn.cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(5500, conn.cc.cwnd);
+
+	/* Partial ACK deflates window, but adds back one segment */
+	conn.snd_una += 1000;
+	tcp_cc_partial_ack(&conn, 1000);
+	PCUT_ASSERT_TRUE(conn.cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(5000, conn.cc.cwnd);
+
+	/* Full ACK, window is set to at most ssthresh */
+	conn.snd_una = conn.snd_nxt;
+	tcp_cc_recovered(&conn);
+	PCUT_ASSERT_FALSE(conn.cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(1000, conn.cc.cwnd);
+
+	tcp_cc_fini(&conn);
+}
+
+PCUT_EXPORT(cc);
@@ -102,6 +102,32 @@ PCUT_TEST(ack_duplicate)
 	tcp_conn_delete(conn);
 }
 
+/** Test seq_no_una_reached() */
+PCUT_TEST(una_reached)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	/* Reached iff SND.UNA >= SN */
+
+	conn->snd_una = 10;
+
+	PCUT_ASSERT_TRUE(seq_no_una_reached(conn, 9));
+	PCUT_ASSERT_TRUE(seq_no_una_reached(conn, 10));
+	PCUT_ASSERT_FALSE(seq_no_una_reached(conn, 11));
+
+	conn->snd_una = 5;
+
+	PCUT_ASSERT_TRUE(seq_no_una_reached(conn, (uint32_t) -5));
+	PCUT_ASSERT_FALSE(seq_no_una_reached(conn, 6));
+
+	tcp_conn_delete(conn);
+}
+
 /** Test seq_no_in_rcv_wnd() */
 PCUT_TEST(in_rcv_wnd)
 {
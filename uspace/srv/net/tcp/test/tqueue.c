@@ -257,6 +257,206 @@ PCUT_TEST(ack_received)
 	tcp_conn_delete(conn);
 }
 
+/** Test that sending data is limited by congestion window and SMSS */
+PCUT_TEST(new_data_cwnd)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 4096;
+	conn->smss = 500;
+	conn->cc.cwnd = 1200;
+	conn->snd_buf_used = 2000;
+	conn->snd_buf_fin = false;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+
+	PCUT_ASSERT_EQUALS(1210, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(800, conn->snd_buf_used);
+
+	tcp_conn_delete(conn);
+	PCUT_ASSERT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_EQUALS(10, trans_seg[0]->seq);
+	PCUT_ASSERT_EQUALS(500, trans_seg[0]->len);
+	PCUT_ASSERT_EQUALS(510, trans_seg[1]->seq);
+	PCUT_ASSERT_EQUALS(500, trans_seg[1]->len);
+	PCUT_ASSERT_EQUALS(1010, trans_seg[2]->seq);
+	PCUT_ASSERT_EQUALS(200, trans_seg[2]->len);
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test fast retransmit and recovery */
+PCUT_TEST(fast_retransmit)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 4096;
+	conn->smss = 500;
+	conn->cc.cwnd = 2000;
+	conn->cc.recover = 9;
+	conn->snd_buf_used = 1500;
+	conn->snd_buf_fin = false;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_EQUALS(1510, conn->snd_nxt);
+
+	/* First segment is lost, the other two generate duplicate ACKs */
+	tcp_tqueue_dup_ack_received(conn);
+	tcp_tqueue_dup_ack_received(conn);
+	PCUT_ASSERT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_FALSE(conn->cc.in_recovery);
+
+	/* Third duplicate ACK triggers fast retransmit */
+	tcp_tqueue_dup_ack_received(conn);
+	PCUT_ASSERT_EQUALS(4, seg_cnt);
+	PCUT_ASSERT_EQUALS(10, trans_seg[3]->seq);
+	PCUT_ASSERT_EQUALS(500, trans_seg[3]->len);
+	PCUT_ASSERT_TRUE(conn->cc.in_recovery);
+	PCUT_ASSERT_EQUALS(1510, conn->cc.recover);
+	PCUT_ASSERT_EQUALS(1000, conn->cc.ssthresh);
+	PCUT_ASSERT_EQUALS(2500, conn->cc.cwnd);
+	PCUT_ASSERT_EQUALS(3, conn->stats.dup_acks);
+	PCUT_ASSERT_EQUALS(1, conn->stats.fast_rexmit);
+	PCUT_ASSERT_EQUALS(1, conn->stats.seg_rexmit);
+
+	/* Full ACK ends recovery */
+	conn->snd_una = 1510;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_FALSE(conn->cc.in_recovery);
+	PCUT_ASSERT_EQUALS(1000, conn->cc.cwnd);
+	PCUT_ASSERT_TRUE(list_empty(&conn->retransmit.list));
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test resending the rest of the flight after retransmission timeout */
+PCUT_TEST(go_back_n)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 4096;
+	conn->smss = 500;
+	conn->cc.cwnd = 2000;
+	conn->snd_buf_used = 2000;
+	conn->snd_buf_fin = false;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(4, seg_cnt);
+	PCUT_ASSERT_EQUALS(2010, conn->snd_nxt);
+
+	/* State after timeout, with the first segment resent */
+	conn->cc.cwnd = 500;
+	conn->cc.ssthresh = 1000;
+	conn->retransmit.go_back = true;
+	conn->retransmit.rexmit_nxt = 510;
+
+	/* ACK of the first segment lets slow start resend two more */
+	conn->snd_una = 510;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_EQUALS(510, trans_seg[4]->seq);
+	PCUT_ASSERT_EQUALS(1010, trans_seg[5]->seq);
+	PCUT_ASSERT_TRUE(conn->retransmit.go_back);
+	PCUT_ASSERT_EQUALS(1510, conn->retransmit.rexmit_nxt);
+	PCUT_ASSERT_EQUALS(2, conn->stats.seg_rexmit);
+
+	/* The peer had buffered the rest, nothing is left to resend */
+	conn->snd_una = 2010;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_FALSE(conn->retransmit.go_back);
+	PCUT_ASSERT_TRUE(list_empty(&conn->retransmit.list));
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test computing retransmission timeout from RTT samples */
+PCUT_TEST(rtt_sample)
+{
+	tcp_tqueue_t tqueue;
+
+	tqueue.srtt = 0;
+	tqueue.rttvar = 0;
+
+	/* RTO is at least one second */
+	tcp_tqueue_rtt_sample(&tqueue, 100 * 1000);
+	PCUT_ASSERT_INT_EQUALS(100 * 1000, tqueue.srtt);
+	PCUT_ASSERT_INT_EQUALS(50 * 1000, tqueue.rttvar);
+	PCUT_ASSERT_INT_EQUALS(1000 * 1000, tqueue.rto);
+
+	tqueue.srtt = 0;
+	tqueue.rttvar = 0;
+
+	/* RTO = SRTT + 4 * RTTVAR */
+	tcp_tqueue_rtt_sample(&tqueue, 2000 * 1000);
+	PCUT_ASSERT_INT_EQUALS(2000 * 1000, tqueue.srtt);
+	PCUT_ASSERT_INT_EQUALS(1000 * 1000, tqueue.rttvar);
+	PCUT_ASSERT_INT_EQUALS(6000 * 1000, tqueue.rto);
+
+	tcp_tqueue_rtt_sample(&tqueue, 2000 * 1000);
+	PCUT_ASSERT_INT_EQUALS(2000 * 1000, tqueue.srtt);
+	PCUT_ASSERT_INT_EQUALS(750 * 1000, tqueue.rttvar);
+	PCUT_ASSERT_INT_EQUALS(5000 * 1000, tqueue.rto);
+}
+
 static void tqueue_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	trans_seg[seg_cnt++] = tcp_segment_dup(seg);
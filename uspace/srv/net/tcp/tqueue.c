@@ -42,7 +42,9 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <time.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "ncsim.h"
@@ -52,7 +54,17 @@
 #include "tqueue.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
+/** Initial retransmission timeout (RFC 6298 section 2.1) */
+#define RTO_INITIAL	(1000*1000)
+/** Lower bound for retransmission timeout (RFC 6298 section 2.4) */
+#define RTO_MIN		(1000*1000)
+/** Upper bound for retransmission timeout */
+#define RTO_MAX		(60*1000*1000)
+/** Clock granularity assumed in RTO computation */
+#define RTO_CLOCK_G	(10*1000)
+
+/** Number of duplicate ACKs that trigger fast retransmit */
+#define DUPACK_THRESHOLD	3
 
 static void retransmit_timeout_func(void *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
@@ -61,6 +73,9 @@ static void tcp_tqueue_seg(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_prepare_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_tqueue_send_immed(tcp_conn_t *, tcp_segment_t *);
+static errno_t tcp_tqueue_retransmit(tcp_conn_t *);
+static errno_t tcp_tqueue_resend(tcp_conn_t *, tcp_tqueue_entry_t *);
+static bool tcp_tqueue_go_back(tcp_conn_t *);
 
 errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
     tcp_tqueue_cb_t *cb)
@@ -71,6 +86,13 @@ errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
 	if (tqueue->timer == NULL)
 		return ENOMEM;
 
+	tqueue->srtt = 0;
+	tqueue->rttvar = 0;
+	tqueue->rto = RTO_INITIAL;
+	tqueue->rtt_tqe = NULL;
+	tqueue->go_back = false;
+	tqueue->rexmit_nxt = 0;
+
 	list_initialize(&tqueue->list);
 
 	return EOK;
@@ -91,6 +113,8 @@ void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
 		tqueue->timer = NULL;
 	}
 
+	tqueue->rtt_tqe = NULL;
+
 	while (!list_empty(&tqueue->list)) {
 		link = list_first(&tqueue->list);
 		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
@@ -110,6 +134,11 @@ void tcp_tqueue_ctrl_seg(tcp_conn_t *conn, tcp_control_t ctrl)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_tqueue_ctrl_seg(%p, %u)", conn, ctrl);
 
 	seg = tcp_segment_make_ctrl(ctrl);
+
+	/* Advertise our MSS (RFC 9293 section 3.7.1) */
+	if ((ctrl & CTL_SYN) != 0)
+		seg->mss = tcp_conn_path_mss(conn);
+
 	tcp_tqueue_seg(conn, seg);
 	tcp_segment_delete(seg);
 }
@@ -118,6 +147,7 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *rt_seg;
 	tcp_tqueue_entry_t *tqe;
+	bool was_empty;
 
 	assert(fibril_mutex_is_locked(&conn->lock));
 
@@ -145,12 +175,24 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 
 		tqe->conn = conn;
 		tqe->seg = rt_seg;
+		tqe->rexmit_cnt = 0;
 		rt_seg->seq = conn->snd_nxt;
 
+		was_empty = list_empty(&conn->retransmit.list);
 		list_append(&tqe->link, &conn->retransmit.list);
 
-		/* Set retransmission timer */
-		tcp_tqueue_timer_set(conn);
+		/* Time one segment per round trip (RFC 6298 section 3) */
+		if (conn->retransmit.rtt_tqe == NULL) {
+			conn->retransmit.rtt_tqe = tqe;
+			getuptime(&conn->retransmit.rtt_start);
+		}
+
+		/*
+		 * Set retransmission timer unless it is already running
+		 * (RFC 6298 section 5.1)
+		 */
+		if (was_empty)
+			tcp_tqueue_timer_set(conn);
 	}
 
 	tcp_prepare_transmit_segment(conn, seg);
@@ -172,7 +214,26 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 	tcp_conn_transmit_segment(conn, seg);
 }
 
+/** Determine number of sequence numbers we are allowed to send now.
+ *
+ * @param conn	Connection
+ * @return	Free space in the lesser of send window and congestion window
+ */
+static uint32_t tcp_tqueue_avail_wnd(tcp_conn_t *conn)
+{
+	uint32_t usable_wnd;
+	uint32_t flight;
+
+	usable_wnd = min(conn->snd_wnd, conn->cc.cwnd);
+	flight = tcp_cc_flight_size(conn);
+
+	return usable_wnd > flight ? usable_wnd - flight : 0;
+}
+
 /** Transmit data from the send buffer.
+ *
+ * Data is sent in segments of at most SMSS bytes for as long as both
+ * the send window and the congestion window allow.
  *
  * @param conn	Connection
  */
@@ -189,62 +250,110 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
 
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
-	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
+	/* Segments lost to a retransmission timeout go first */
+	if (!tcp_tqueue_go_back(conn))
+		return;
+
+	while (true) {
+		/* Number of free sequence numbers in send window */
+		avail_wnd = tcp_tqueue_avail_wnd(conn);
+		snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
 
-	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, SND.WND = %" PRIu32 ", "
-	    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen, conn->snd_wnd,
-	    xfer_seqlen);
+		xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, "
+		    "SND.WND = %" PRIu32 ", CWND = %" PRIu32 ", xfer_seqlen = %zu",
+		    conn->name, snd_buf_seqlen, conn->snd_wnd, conn->cc.cwnd,
+		    xfer_seqlen);
 
-	if (xfer_seqlen == 0)
-		return;
+		if (xfer_seqlen == 0)
+			return;
 
-	/* XXX Do not always send immediately */
+		/* XXX Do not always send immediately */
 
-	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
-	data_size = xfer_seqlen - (send_fin ? 1 : 0);
+		send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
+		data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
-	if (send_fin) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
-		/* We are sending out FIN */
-		ctrl = CTL_FIN;
-	} else {
-		ctrl = 0;
-	}
+		if (data_size > conn->smss) {
+			data_size = conn->smss;
+			send_fin = false;
+		}
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
-	if (seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
+		if (send_fin) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
+			/* We are sending out FIN */
+			ctrl = CTL_FIN;
+		} else {
+			ctrl = 0;
+		}
+
+		seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
+		if (seg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
+			return;
+		}
+
+		/* Remove data from send buffer */
+		memmove(conn->snd_buf, conn->snd_buf + data_size,
+		    conn->snd_buf_used - data_size);
+		conn->snd_buf_used -= data_size;
+
+		if (send_fin)
+			conn->snd_buf_fin = false;
+
+		fibril_condvar_broadcast(&conn->snd_buf_cv);
+
+		if (send_fin)
+			tcp_conn_fin_sent(conn);
+
+		tcp_tqueue_seg(conn, seg);
+		tcp_segment_delete(seg);
 	}
+}
 
-	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
+/** Update RTT estimate and retransmission timeout with a new RTT sample.
+ *
+ * As per RFC 6298 section 2 with alpha = 1/8 and beta = 1/4.
+ *
+ * @param tqueue	Retransmission queue
+ * @param rtt		Measured round-trip time in microseconds
+ */
+void tcp_tqueue_rtt_sample(tcp_tqueue_t *tqueue, usec_t rtt)
+{
+	usec_t delta;
 
-	if (send_fin)
-		conn->snd_buf_fin = false;
+	if (rtt < 0)
+		rtt = 0;
 
-	fibril_condvar_broadcast(&conn->snd_buf_cv);
+	if (tqueue->srtt == 0) {
+		/* First measurement */
+		tqueue->srtt = rtt;
+		tqueue->rttvar = rtt / 2;
+	} else {
+		delta = tqueue->srtt - rtt;
+		if (delta < 0)
+			delta = -delta;
 
-	if (send_fin)
-		tcp_conn_fin_sent(conn);
+		tqueue->rttvar = tqueue->rttvar - tqueue->rttvar / 4 + delta / 4;
+		tqueue->srtt = tqueue->srtt - tqueue->srtt / 8 + rtt / 8;
+	}
 
-	tcp_tqueue_seg(conn, seg);
-	tcp_segment_delete(seg);
+	tqueue->rto = tqueue->srtt + max(RTO_CLOCK_G, 4 * tqueue->rttvar);
+	tqueue->rto = max(tqueue->rto, RTO_MIN);
+	tqueue->rto = min(tqueue->rto, RTO_MAX);
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
  * more data.
  *
  * This should be called when SND.UNA is updated due to incoming ACK.
+ * Takes an RTT sample, opens the congestion window or handles a partial
+ * or full ACK during fast recovery.
  */
 void tcp_tqueue_ack_received(tcp_conn_t *conn)
 {
 	link_t *cur, *next;
+	struct timespec now;
+	uint32_t acked = 0;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_ack_received(%p)", conn->name,
 	    conn);
@@ -270,16 +379,56 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 				conn->fin_is_acked = true;
 			}
 
+			if (tqe == conn->retransmit.rtt_tqe) {
+				/* Timed segment acked, take RTT sample */
+				getuptime(&now);
+				tcp_tqueue_rtt_sample(&conn->retransmit,
+				    NSEC2USEC(ts_sub_diff(&now,
+				    &conn->retransmit.rtt_start)));
+				conn->retransmit.rtt_tqe = NULL;
+				++conn->stats.rtt_samples;
+			}
+
+			acked += tqe->seg->len;
 			tcp_segment_delete(tqe->seg);
 			free(tqe);
-
-			/* Reset retransmission timer */
-			tcp_tqueue_timer_set(conn);
 		}
 
 		cur = next;
 	}
 
+	/*
+	 * The peer may have received and buffered segments which we have
+	 * not resent yet.
+	 */
+	if (conn->retransmit.go_back &&
+	    seq_no_una_reached(conn, conn->retransmit.rexmit_nxt)) {
+		conn->retransmit.rexmit_nxt = conn->snd_una;
+		if (conn->retransmit.rexmit_nxt == conn->snd_nxt)
+			conn->retransmit.go_back = false;
+	}
+
+	if (acked > 0) {
+		conn->stats.bytes_acked += acked;
+
+		if (!conn->cc.in_recovery) {
+			tcp_cc_ack(conn, acked);
+		} else if (seq_no_una_reached(conn, conn->cc.recover)) {
+			/* Full ACK */
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Leaving fast recovery",
+			    conn->name);
+			tcp_cc_recovered(conn);
+		} else {
+			/* Partial ACK, next hole needs to be filled */
+			tcp_cc_partial_ack(conn, acked);
+			(void) tcp_tqueue_retransmit(conn);
+		}
+
+		/* Restart retransmission timer (RFC 6298 section 5.3) */
+		if (!list_empty(&conn->retransmit.list))
+			tcp_tqueue_timer_set(conn);
+	}
+
 	/* Clear retransmission timer if the queue is empty. */
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
@@ -288,6 +437,48 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 	tcp_tqueue_new_data(conn);
 }
 
+/** Duplicate ACK was received.
+ *
+ * Should be called for ACKs that do not advance SND.UNA, carry no data,
+ * do not change the send window and arrive while there is outstanding data
+ * (RFC 5681 section 2). Performs fast retransmit on the third such ACK
+ * and inflates the congestion window during fast recovery.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_dup_ack_received(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	++conn->stats.dup_acks;
+
+	if (conn->cc.in_recovery) {
+		/* Another segment has left the network */
+		conn->cc.cwnd += conn->smss;
+		tcp_tqueue_new_data(conn);
+		return;
+	}
+
+	if (++conn->cc.dupacks != DUPACK_THRESHOLD)
+		return;
+
+	/*
+	 * Do not start another recovery for losses in data that was
+	 * outstanding when loss was last detected (RFC 6582 section 3.2).
+	 */
+	if (!seq_no_una_reached(conn, conn->cc.recover + 1))
+		return;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Fast retransmit, SND.UNA=%" PRIu32,
+	    conn->name, conn->snd_una);
+
+	++conn->stats.fast_rexmit;
+	tcp_cc_loss(conn, tcp_cc_ev_recovery);
+
+	(void) tcp_tqueue_retransmit(conn);
+	tcp_tqueue_new_data(conn);
+}
+
 static void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
@@ -314,15 +505,108 @@ void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	tcp_segment_dump(seg);
 
+	++conn->stats.seg_sent;
 	conn->retransmit.cb->transmit_seg(&conn->ident, seg);
 }
 
+/** Retransmit a segment from the retransmission queue.
+ *
+ * @param conn	Connection
+ * @param tqe	Retransmission queue entry
+ * @return	EOK on success, ENOMEM if out of memory
+ */
+static errno_t tcp_tqueue_resend(tcp_conn_t *conn, tcp_tqueue_entry_t *tqe)
+{
+	tcp_segment_t *rt_seg;
+
+	rt_seg = tcp_segment_dup(tqe->seg);
+	if (rt_seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+		return ENOMEM;
+	}
+
+	/* Karn's algorithm: never sample RTT of a retransmitted segment */
+	conn->retransmit.rtt_tqe = NULL;
+
+	++tqe->rexmit_cnt;
+	++conn->stats.seg_rexmit;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
+	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+
+	return EOK;
+}
+
+/** Retransmit first segment in the retransmission queue.
+ *
+ * @param conn	Connection
+ * @return	EOK on success, ENOENT if queue is empty, ENOMEM if out
+ *		of memory
+ */
+static errno_t tcp_tqueue_retransmit(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *tqe;
+	link_t *link;
+
+	link = list_first(&conn->retransmit.list);
+	if (link == NULL)
+		return ENOENT;
+
+	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+	return tcp_tqueue_resend(conn, tqe);
+}
+
+/** Resend outstanding segments after a retransmission timeout.
+ *
+ * Segments which have not been resent since the timeout are resent in
+ * order for as long as both the send window and the congestion window
+ * allow, so that slow start recovers the whole flight and not just its
+ * first segment (go-back-N).
+ *
+ * @param conn	Connection
+ * @return	@c true if all outstanding segments have been resent and
+ *		new data may follow
+ */
+static bool tcp_tqueue_go_back(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *tqe;
+
+	while (conn->retransmit.go_back) {
+		tqe = NULL;
+		list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t,
+		    cur) {
+			if (!seq_no_segment_acked(conn, cur->seg,
+			    conn->retransmit.rexmit_nxt)) {
+				tqe = cur;
+				break;
+			}
+		}
+
+		if (tqe == NULL) {
+			conn->retransmit.go_back = false;
+			break;
+		}
+
+		if (tqe->seg->len > tcp_tqueue_avail_wnd(conn))
+			return false;
+
+		if (tcp_tqueue_resend(conn, tqe) != EOK)
+			return false;
+
+		conn->retransmit.rexmit_nxt = tqe->seg->seq + tqe->seg->len;
+		if (conn->retransmit.rexmit_nxt == conn->snd_nxt)
+			conn->retransmit.go_back = false;
+	}
+
+	return true;
+}
+
 static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
 	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
-	link_t *link;
+	errno_t rc;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
 
@@ -335,30 +619,41 @@ static void retransmit_timeout_func(void *arg)
 		return;
 	}
 
-	link = list_first(&conn->retransmit.list);
-	if (link == NULL) {
+	if (list_empty(&conn->retransmit.list)) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Nothing to retransmit");
 		tcp_conn_unlock(conn);
 		tcp_conn_delref(conn);
 		return;
 	}
 
-	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+	++conn->stats.rto_expired;
 
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+	tqe = list_get_instance(list_first(&conn->retransmit.list),
+	    tcp_tqueue_entry_t, link);
+
+	/* Collapse congestion window and back off the timer (RFC 6298 5.5) */
+	tcp_cc_loss(conn, tqe->rexmit_cnt > 0 ? tcp_cc_ev_rto_again :
+	    tcp_cc_ev_rto);
+	conn->retransmit.rto = min(2 * conn->retransmit.rto, RTO_MAX);
+
+	rc = tcp_tqueue_retransmit(conn);
+	if (rc != EOK) {
 		tcp_conn_unlock(conn);
 		tcp_conn_delref(conn);
 		/* XXX Handle properly */
 		return;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	/*
+	 * Go back to the first segment, the rest of the flight is resent as
+	 * the congestion window opens again.
+	 */
+	conn->retransmit.rexmit_nxt = tqe->seg->seq + tqe->seg->len;
+	conn->retransmit.go_back =
+	    conn->retransmit.rexmit_nxt != conn->snd_nxt;
 
 	/* Reset retransmission timer */
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->retransmit.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	tcp_conn_unlock(conn);
@@ -377,7 +672,7 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->retransmit.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_set() end", conn->name);
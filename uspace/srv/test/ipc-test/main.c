@@ -39,6 +39,7 @@
 
 #include <as.h>
 #include <async.h>
+#include <async_ring.h>
 #include <errno.h>
 #include <str_error.h>
 #include <io/log.h>
@@ -181,6 +182,34 @@ static void ipc_test_share_in_rw_srv(ipc_call_t *icall)
 	async_answer_0(icall, EOK);
 }
 
+static void ipc_test_ring_handler(ipc_call_t *req, ipc_call_t *answer,
+    void *arg)
+{
+	switch (ipc_get_imethod(req)) {
+	case IPC_TEST_PING:
+		ipc_set_retval(answer, EOK);
+		break;
+	default:
+		ipc_set_retval(answer, ENOTSUP);
+		break;
+	}
+}
+
+static errno_t ipc_test_ring_srv(ipc_call_t *icall)
+{
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ipc_test_ring_srv");
+
+	rc = async_ring_serve(icall, ipc_test_ring_handler, NULL);
+	if (rc != EOK && rc != EHANGUP) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "async_ring_serve failed (%s)",
+		    str_error(rc));
+	}
+
+	return rc;
+}
+
 static void ipc_test_connection(ipc_call_t *icall, void *arg)
 {
 	/* Accept connection */
@@ -211,6 +240,10 @@ static void ipc_test_connection(ipc_call_t *icall, void *arg)
 		case IPC_TEST_SHARE_IN_RW:
 			ipc_test_share_in_rw_srv(&call);
 			break;
+		case IPC_TEST_RING:
+			if (ipc_test_ring_srv(&call) == EHANGUP)
+				return;
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 			break;
@@ -229,6 +229,20 @@ extern void vfs_register(ipc_call_t *);
 
 extern void vfs_page_in(ipc_call_t *);
 
+extern bool vfs_page_cache_init(void);
+extern size_t vfs_page_cache_shrink(size_t);
+extern void *vfs_page_cache_alloc(void);
+extern uint64_t vfs_page_cache_gen(void);
+extern void vfs_page_cache_insert(const vfs_triplet_t *, aoff64_t, void *,
+    size_t, uint64_t);
+extern bool vfs_page_cache_copy(const vfs_triplet_t *, aoff64_t, void *,
+    size_t *);
+extern errno_t vfs_page_cache_read(const vfs_triplet_t *, aoff64_t,
+    ipc_call_t *, size_t, size_t *);
+extern void vfs_page_cache_invalidate(const vfs_triplet_t *, aoff64_t,
+    aoff64_t);
+extern void vfs_page_cache_invalidate_fs(fs_handle_t, service_id_t);
+
 typedef struct {
 	void *buffer;
 	size_t size;
@@ -129,6 +129,9 @@ void vfs_node_delref(vfs_node_t *node)
 		 * are no more hard links.
 		 */
 
+		vfs_triplet_t tri = node_triplet(node);
+		vfs_page_cache_invalidate(&tri, 0, UINT64_MAX);
+
 		async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
 		async_msg_2(exch, VFS_OUT_DESTROY, (sysarg_t) node->service_id,
 		    (sysarg_t)node->index);
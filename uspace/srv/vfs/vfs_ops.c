@@ -49,6 +49,8 @@
 #include <ctype.h>
 #include <assert.h>
 #include <vfs/canonify.h>
+#include <align.h>
+#include <as.h>
 
 /* Forward declarations of static functions. */
 static errno_t vfs_truncate_internal(fs_handle_t, service_id_t, fs_index_t,
@@ -79,6 +81,8 @@ static size_t shared_path(char *a, char *b)
 /* This call destroys the file if and only if there are no hard links left. */
 static void out_destroy(vfs_triplet_t *file)
 {
+	vfs_page_cache_invalidate(file, 0, UINT64_MAX);
+
 	async_exch_t *exch = vfs_exchange_grab(file->fs_handle);
 	async_msg_2(exch, VFS_OUT_DESTROY, (sysarg_t) file->service_id,
 	    (sysarg_t) file->index);
@@ -351,12 +355,150 @@ errno_t vfs_op_open(int fd, int mode)
 typedef errno_t (*rdwr_ipc_cb_t)(async_exch_t *, vfs_file_t *, aoff64_t,
     ipc_call_t *, bool, void *);
 
+/** Read a page of a file from the file system into the page cache.
+ *
+ * @param exch		Exchange with the file system server.
+ * @param file		File to read from.
+ * @param offset	Page-aligned offset of the page.
+ * @param answer	Place to store the answer of the last read.
+ *
+ * @return EOK on success or an error code.
+ */
+static errno_t rdwr_page_fill(async_exch_t *exch, vfs_file_t *file,
+    aoff64_t offset, ipc_call_t *answer)
+{
+	vfs_triplet_t triplet = {
+		.fs_handle = file->node->fs_handle,
+		.service_id = file->node->service_id,
+		.index = file->node->index
+	};
+
+	uint8_t *data = vfs_page_cache_alloc();
+	if (data == NULL)
+		return ENOMEM;
+
+	uint64_t gen = vfs_page_cache_gen();
+
+	/*
+	 * File systems may return less than requested, e.g. when the read
+	 * crosses a block boundary, so keep reading until the page is full
+	 * or the end of the file is reached.
+	 */
+	size_t total = 0;
+	while (total < PAGE_SIZE) {
+		aoff64_t pos = offset + total;
+		aid_t msg = async_send_4(exch, VFS_OUT_READ,
+		    file->node->service_id, file->node->index, LOWER32(pos),
+		    UPPER32(pos), answer);
+		if (msg == 0) {
+			free(data);
+			return EINVAL;
+		}
+
+		errno_t rc = async_data_read_start(exch, data + total,
+		    PAGE_SIZE - total);
+		if (rc != EOK) {
+			async_forget(msg);
+			free(data);
+			return rc;
+		}
+
+		async_wait_for(msg, &rc);
+		if (rc != EOK) {
+			free(data);
+			return rc;
+		}
+
+		size_t bytes = ipc_get_arg1(answer);
+		if (bytes == 0)
+			break;
+		total += bytes;
+	}
+
+	vfs_page_cache_insert(&triplet, offset, data, total, gen);
+	return EOK;
+}
+
+/** Read from a file on behalf of a client, using the page cache.
+ *
+ * Reads which fit into a single page are served from the page cache,
+ * populating it from the file system on a miss. Larger reads are forwarded
+ * to the file system server unless they can be satisfied from a single
+ * cached page containing the end of the file.
+ */
+static errno_t rdwr_ipc_client_read(async_exch_t *exch, vfs_file_t *file,
+    aoff64_t pos, ipc_call_t *answer, size_t *bytes)
+{
+	vfs_triplet_t triplet = {
+		.fs_handle = file->node->fs_handle,
+		.service_id = file->node->service_id,
+		.index = file->node->index
+	};
+
+	if (exch == NULL)
+		return ENOENT;
+
+	ipc_call_t call;
+	size_t size;
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
+	}
+
+	ipc_set_arg1(answer, 0);
+	*bytes = 0;
+
+	errno_t rc = vfs_page_cache_read(&triplet, pos, &call, size, bytes);
+	if (rc != ENOENT)
+		return rc;
+
+	aoff64_t offset = ALIGN_DOWN(pos, PAGE_SIZE);
+	if (pos - offset + size <= PAGE_SIZE &&
+	    rdwr_page_fill(exch, file, offset, answer) == EOK) {
+		rc = vfs_page_cache_read(&triplet, pos, &call, size, bytes);
+		if (rc != ENOENT)
+			return rc;
+	}
+
+	/*
+	 * Forward the IPC_M_DATA_READ request to the destination FS server.
+	 * The call will be routed as if sent by ourselves.
+	 */
+	aid_t msg = async_send_4(exch, VFS_OUT_READ, file->node->service_id,
+	    file->node->index, LOWER32(pos), UPPER32(pos), answer);
+	if (msg == 0) {
+		async_answer_0(&call, EINVAL);
+		return EINVAL;
+	}
+
+	rc = async_forward_0(&call, exch, 0, IPC_FF_ROUTE_FROM_ME);
+	if (rc != EOK) {
+		async_forget(msg);
+		async_answer_0(&call, rc);
+		return rc;
+	}
+
+	async_wait_for(msg, &rc);
+
+	*bytes = ipc_get_arg1(answer);
+	return rc;
+}
+
 static errno_t rdwr_ipc_client(async_exch_t *exch, vfs_file_t *file, aoff64_t pos,
     ipc_call_t *answer, bool read, void *data)
 {
 	size_t *bytes = (size_t *) data;
 	errno_t rc;
 
+	if (read && file->node->type == VFS_NODE_FILE) {
+		vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
+
+		if (fs_info->page_cache) {
+			return rdwr_ipc_client_read(exch, file, pos, answer,
+			    bytes);
+		}
+	}
+
 	/*
 	 * Make a VFS_READ/VFS_WRITE request at the destination FS server
 	 * and forward the IPC_M_DATA_READ/IPC_M_DATA_WRITE request to the
@@ -483,6 +625,28 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	if (file->node->type == VFS_NODE_DIRECTORY)
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 
+	if (!read) {
+		/*
+		 * Drop the written pages from the page cache. If the write
+		 * might have changed the size of the file, the page containing
+		 * the former end of the file is no longer valid either.
+		 */
+		vfs_triplet_t triplet = {
+			.fs_handle = file->node->fs_handle,
+			.service_id = file->node->service_id,
+			.index = file->node->index
+		};
+
+		if (rc == EOK && file->node->size == MERGE_LOUP32(
+		    ipc_get_arg2(&answer), ipc_get_arg3(&answer))) {
+			vfs_page_cache_invalidate(&triplet, pos,
+			    pos + ipc_get_arg1(&answer));
+		} else {
+			vfs_page_cache_invalidate(&triplet,
+			    min(pos, file->node->size), UINT64_MAX);
+		}
+	}
+
 	/* Unlock the VFS node. */
 	if (rlock) {
 		fibril_rwlock_read_unlock(&file->node->contents_rwlock);
@@ -626,6 +790,15 @@ errno_t vfs_op_resize(int fd, int64_t size)
 
 	errno_t rc = vfs_truncate_internal(file->node->fs_handle,
 	    file->node->service_id, file->node->index, size);
+
+	vfs_triplet_t triplet = {
+		.fs_handle = file->node->fs_handle,
+		.service_id = file->node->service_id,
+		.index = file->node->index
+	};
+	vfs_page_cache_invalidate(&triplet,
+	    min((aoff64_t) size, file->node->size), UINT64_MAX);
+
 	if (rc == EOK)
 		file->node->size = size;
 
@@ -822,6 +995,8 @@ errno_t vfs_op_unmount(int mpfd)
 		return rc;
 	}
 
+	vfs_page_cache_invalidate_fs(mp->node->mount->fs_handle,
+	    mp->node->mount->service_id);
 	vfs_node_forget(mp->node->mount);
 	vfs_node_put(mp->node);
 	mp->node->mount = NULL;
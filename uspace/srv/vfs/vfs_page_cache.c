@@ -0,0 +1,542 @@
+/*
+ * Copyright (c) 2026 HelenOS Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup vfs
+ * @{
+ */
+
+/**
+ * @file vfs_page_cache.c
+ * @brief VFS page cache.
+ *
+ * The page cache keeps page-sized, page-aligned pieces of regular files
+ * keyed by the file's triplet and the offset of the page. It is consulted
+ * both by the pager when resolving faults of file-backed mappings and by
+ * the read path, so that hot files can be served without a round trip to
+ * the file system server.
+ *
+ * Cached pages are never handed out directly. The pager copies them into
+ * a fresh area and reads copy them into the client's buffer. Because all
+ * modifications of file contents go through VFS, invalidating the affected
+ * pages on write, truncate, destroy and unmount keeps the cache coherent
+ * with the file system.
+ *
+ * HelenOS does not deliver memory pressure notifications, so the cache is
+ * bounded by a fixed number of pages and is also shrunk whenever VFS fails
+ * to allocate memory for a new page.
+ */
+
+#include "vfs.h"
+#include <adt/hash_table.h>
+#include <adt/hash.h>
+#include <adt/list.h>
+#include <align.h>
+#include <as.h>
+#include <assert.h>
+#include <async.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <stdlib.h>
+#include <str.h>
+
+/** Maximum number of pages kept in the cache */
+#define PAGE_CACHE_MAX_PAGES  1024
+
+/** Number of pages evicted at once when an allocation fails */
+#define PAGE_CACHE_SHRINK_PAGES  64
+
+/** Cached file */
+typedef struct {
+	/** Link to file_cache */
+	ht_link_t link;
+	/** Identity of the file */
+	vfs_triplet_t triplet;
+	/** Cached pages of this file */
+	list_t pages;
+} page_cache_file_t;
+
+/** Cached page */
+typedef struct {
+	/** Link to page_cache */
+	ht_link_t link;
+	/** Link to page_cache_file_t.pages */
+	link_t file_link;
+	/** Link to page_lru */
+	link_t lru_link;
+	/** File this page belongs to */
+	page_cache_file_t *file;
+	/** Offset of the page within the file */
+	aoff64_t offset;
+	/** Number of valid bytes, less than PAGE_SIZE only at end of file */
+	size_t size;
+	/** Page data */
+	uint8_t *data;
+} page_cache_page_t;
+
+/** Page lookup key */
+typedef struct {
+	const vfs_triplet_t *triplet;
+	aoff64_t offset;
+} page_cache_key_t;
+
+/** Mutex protecting all the page cache structures. */
+static FIBRIL_MUTEX_INITIALIZE(page_cache_mutex);
+
+/** Cached files */
+static hash_table_t file_cache;
+
+/** Cached pages */
+static hash_table_t page_cache;
+
+/** Cached pages in LRU order, least recently used first */
+static LIST_INITIALIZE(page_lru);
+
+/** Number of cached pages */
+static size_t page_count;
+
+/** Invalidation generation
+ *
+ * Incremented on every invalidation. Pages read from the file system
+ * are only inserted if no invalidation happened since the read started.
+ */
+static uint64_t page_cache_generation;
+
+static size_t triplet_hash(const vfs_triplet_t *tri)
+{
+	size_t hash = hash_combine(tri->fs_handle, tri->index);
+	return hash_combine(hash, tri->service_id);
+}
+
+static bool triplet_equal(const vfs_triplet_t *a, const vfs_triplet_t *b)
+{
+	return a->fs_handle == b->fs_handle &&
+	    a->service_id == b->service_id && a->index == b->index;
+}
+
+static size_t file_key_hash(const void *key)
+{
+	return triplet_hash(key);
+}
+
+static size_t file_hash(const ht_link_t *item)
+{
+	page_cache_file_t *file =
+	    hash_table_get_inst(item, page_cache_file_t, link);
+	return triplet_hash(&file->triplet);
+}
+
+static bool file_key_equal(const void *key, const ht_link_t *item)
+{
+	page_cache_file_t *file =
+	    hash_table_get_inst(item, page_cache_file_t, link);
+	return triplet_equal(key, &file->triplet);
+}
+
+static hash_table_ops_t file_cache_ops = {
+	.hash = file_hash,
+	.key_hash = file_key_hash,
+	.key_equal = file_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t page_key_hash(const void *key)
+{
+	const page_cache_key_t *pkey = key;
+	return hash_combine(triplet_hash(pkey->triplet),
+	    hash_mix64(pkey->offset));
+}
+
+static size_t page_hash(const ht_link_t *item)
+{
+	page_cache_page_t *page =
+	    hash_table_get_inst(item, page_cache_page_t, link);
+	page_cache_key_t pkey = {
+		.triplet = &page->file->triplet,
+		.offset = page->offset
+	};
+	return page_key_hash(&pkey);
+}
+
+static bool page_key_equal(const void *key, const ht_link_t *item)
+{
+	const page_cache_key_t *pkey = key;
+	page_cache_page_t *page =
+	    hash_table_get_inst(item, page_cache_page_t, link);
+	return page->offset == pkey->offset &&
+	    triplet_equal(pkey->triplet, &page->file->triplet);
+}
+
+static hash_table_ops_t page_cache_ops = {
+	.hash = page_hash,
+	.key_hash = page_key_hash,
+	.key_equal = page_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Initialize the VFS page cache.
+ *
+ * @return True on success, false on allocation failure.
+ */
+bool vfs_page_cache_init(void)
+{
+	if (!hash_table_create(&file_cache, 0, 0, &file_cache_ops))
+		return false;
+
+	if (!hash_table_create(&page_cache, 0, 0, &page_cache_ops)) {
+		hash_table_destroy(&file_cache);
+		return false;
+	}
+
+	return true;
+}
+
+/** Remove a page from the cache and free it.
+ *
+ * The file is freed as well if this was its last cached page.
+ * Must be called with page_cache_mutex held.
+ */
+static void page_cache_page_remove(page_cache_page_t *page)
+{
+	page_cache_file_t *file = page->file;
+
+	hash_table_remove_item(&page_cache, &page->link);
+	list_remove(&page->file_link);
+	list_remove(&page->lru_link);
+	page_count--;
+
+	if (list_empty(&file->pages)) {
+		hash_table_remove_item(&file_cache, &file->link);
+		free(file);
+	}
+
+	free(page->data);
+	free(page);
+}
+
+/** Find a cached page and mark it as recently used.
+ *
+ * Must be called with page_cache_mutex held.
+ */
+static page_cache_page_t *page_cache_find(const vfs_triplet_t *triplet,
+    aoff64_t offset)
+{
+	page_cache_key_t pkey = {
+		.triplet = triplet,
+		.offset = offset
+	};
+
+	ht_link_t *link = hash_table_find(&page_cache, &pkey);
+	if (link == NULL)
+		return NULL;
+
+	page_cache_page_t *page =
+	    hash_table_get_inst(link, page_cache_page_t, link);
+
+	list_remove(&page->lru_link);
+	list_append(&page->lru_link, &page_lru);
+
+	return page;
+}
+
+/** Evict least recently used pages.
+ *
+ * Must be called with page_cache_mutex held.
+ */
+static size_t page_cache_evict(size_t count)
+{
+	size_t evicted = 0;
+
+	while (evicted < count && !list_empty(&page_lru)) {
+		page_cache_page_t *page = list_get_instance(
+		    list_first(&page_lru), page_cache_page_t, lru_link);
+		page_cache_page_remove(page);
+		evicted++;
+	}
+
+	return evicted;
+}
+
+/** Release memory held by the page cache.
+ *
+ * This is the page cache's reaction to memory pressure. It is called
+ * whenever VFS fails to allocate memory on behalf of the cache.
+ *
+ * @param count	Maximum number of pages to release.
+ *
+ * @return Number of pages actually released.
+ */
+size_t vfs_page_cache_shrink(size_t count)
+{
+	fibril_mutex_lock(&page_cache_mutex);
+	size_t evicted = page_cache_evict(count);
+	fibril_mutex_unlock(&page_cache_mutex);
+
+	return evicted;
+}
+
+/** Allocate a buffer for a page, shrinking the cache if necessary.
+ *
+ * @return Page-sized buffer or NULL if there is not enough memory.
+ */
+void *vfs_page_cache_alloc(void)
+{
+	void *data = malloc(PAGE_SIZE);
+	if (data == NULL && vfs_page_cache_shrink(PAGE_CACHE_SHRINK_PAGES) > 0)
+		data = malloc(PAGE_SIZE);
+
+	return data;
+}
+
+/** Get the current invalidation generation of the page cache.
+ *
+ * The value should be obtained before reading the page contents from the
+ * file system and passed to vfs_page_cache_insert() afterwards.
+ */
+uint64_t vfs_page_cache_gen(void)
+{
+	fibril_mutex_lock(&page_cache_mutex);
+	uint64_t gen = page_cache_generation;
+	fibril_mutex_unlock(&page_cache_mutex);
+
+	return gen;
+}
+
+/** Insert a page into the page cache.
+ *
+ * The page is silently dropped if the cache has been invalidated since
+ * @a gen was obtained, since its contents may be stale in that case.
+ *
+ * @param triplet	File the page belongs to.
+ * @param offset	Page-aligned offset of the page within the file.
+ * @param data		Buffer of PAGE_SIZE bytes obtained from
+ *			vfs_page_cache_alloc(). The cache takes ownership of
+ *			the buffer.
+ * @param size		Number of valid bytes in @a data.
+ * @param gen		Generation returned by vfs_page_cache_gen() before
+ *			the data was read.
+ */
+void vfs_page_cache_insert(const vfs_triplet_t *triplet, aoff64_t offset,
+    void *data, size_t size, uint64_t gen)
+{
+	assert(ALIGN_DOWN(offset, PAGE_SIZE) == offset);
+	assert(size <= PAGE_SIZE);
+
+	fibril_mutex_lock(&page_cache_mutex);
+
+	if (gen != page_cache_generation ||
+	    page_cache_find(triplet, offset) != NULL)
+		goto drop;
+
+	if (page_count >= PAGE_CACHE_MAX_PAGES)
+		page_cache_evict(page_count - PAGE_CACHE_MAX_PAGES + 1);
+
+	page_cache_page_t *page = malloc(sizeof(page_cache_page_t));
+	if (page == NULL)
+		goto drop;
+
+	page_cache_file_t *file;
+	ht_link_t *flink = hash_table_find(&file_cache, triplet);
+	if (flink != NULL) {
+		file = hash_table_get_inst(flink, page_cache_file_t, link);
+	} else {
+		file = malloc(sizeof(page_cache_file_t));
+		if (file == NULL) {
+			free(page);
+			goto drop;
+		}
+
+		file->triplet = *triplet;
+		list_initialize(&file->pages);
+		hash_table_insert(&file_cache, &file->link);
+	}
+
+	link_initialize(&page->file_link);
+	link_initialize(&page->lru_link);
+	page->file = file;
+	page->offset = offset;
+	page->size = size;
+	page->data = data;
+
+	list_append(&page->file_link, &file->pages);
+	list_append(&page->lru_link, &page_lru);
+	hash_table_insert(&page_cache, &page->link);
+	page_count++;
+
+	fibril_mutex_unlock(&page_cache_mutex);
+	return;
+
+drop:
+	fibril_mutex_unlock(&page_cache_mutex);
+	free(data);
+}
+
+/** Copy a cached page.
+ *
+ * @param triplet	File the page belongs to.
+ * @param offset	Page-aligned offset of the page within the file.
+ * @param buffer	Buffer of PAGE_SIZE bytes to copy the page to.
+ * @param size		Place to store the number of valid bytes.
+ *
+ * @return True if the page was found in the cache.
+ */
+bool vfs_page_cache_copy(const vfs_triplet_t *triplet, aoff64_t offset,
+    void *buffer, size_t *size)
+{
+	fibril_mutex_lock(&page_cache_mutex);
+
+	page_cache_page_t *page = page_cache_find(triplet, offset);
+	if (page != NULL) {
+		memcpy(buffer, page->data, page->size);
+		*size = page->size;
+	}
+
+	fibril_mutex_unlock(&page_cache_mutex);
+	return page != NULL;
+}
+
+/** Answer a data read request from the page cache.
+ *
+ * The request is served only if it can be satisfied entirely from a single
+ * cached page, i.e. if it does not extend past the end of the page or if the
+ * page contains the end of the file. Otherwise the request is left
+ * unanswered.
+ *
+ * @param triplet	File to read from.
+ * @param pos		Position of the read.
+ * @param call		IPC_M_DATA_READ request to answer.
+ * @param size		Size of the request.
+ * @param bytes		Place to store the number of bytes read.
+ *
+ * @return EOK if the request was answered from the cache, ENOENT if the
+ *	   request cannot be served from the cache, or an error code
+ *	   returned by async_data_read_finalize().
+ */
+errno_t vfs_page_cache_read(const vfs_triplet_t *triplet, aoff64_t pos,
+    ipc_call_t *call, size_t size, size_t *bytes)
+{
+	aoff64_t offset = ALIGN_DOWN(pos, PAGE_SIZE);
+	size_t in_page = pos - offset;
+	errno_t rc = ENOENT;
+
+	fibril_mutex_lock(&page_cache_mutex);
+
+	page_cache_page_t *page = page_cache_find(triplet, offset);
+	if (page == NULL)
+		goto out;
+
+	if (in_page + size > PAGE_SIZE && page->size == PAGE_SIZE)
+		goto out;
+
+	size_t avail = (in_page < page->size) ? page->size - in_page : 0;
+	size_t len = min(size, avail);
+
+	rc = async_data_read_finalize(call, page->data + in_page, len);
+	if (rc == EOK)
+		*bytes = len;
+
+out:
+	fibril_mutex_unlock(&page_cache_mutex);
+	return rc;
+}
+
+/** Invalidate cached pages of a file.
+ *
+ * @param triplet	File whose pages are to be invalidated.
+ * @param start		Start of the invalidated range.
+ * @param end		End of the invalidated range (exclusive).
+ */
+void vfs_page_cache_invalidate(const vfs_triplet_t *triplet, aoff64_t start,
+    aoff64_t end)
+{
+	fibril_mutex_lock(&page_cache_mutex);
+
+	page_cache_generation++;
+
+	ht_link_t *flink = hash_table_find(&file_cache, triplet);
+	if (flink != NULL) {
+		page_cache_file_t *file =
+		    hash_table_get_inst(flink, page_cache_file_t, link);
+
+		/*
+		 * Removing the last page frees the file, so the loop must not
+		 * touch the file once the list becomes empty.
+		 */
+		link_t *cur = list_first(&file->pages);
+		while (cur != NULL) {
+			link_t *next = list_next(cur, &file->pages);
+			bool last = (next == NULL);
+
+			page_cache_page_t *page = list_get_instance(cur,
+			    page_cache_page_t, file_link);
+			if (page->offset < end &&
+			    page->offset + PAGE_SIZE > start)
+				page_cache_page_remove(page);
+
+			if (last)
+				break;
+			cur = next;
+		}
+	}
+
+	fibril_mutex_unlock(&page_cache_mutex);
+}
+
+/** Invalidate all cached pages of a file system instance.
+ *
+ * @param fs_handle	File system handle.
+ * @param service_id	Service ID of the file system instance.
+ */
+void vfs_page_cache_invalidate_fs(fs_handle_t fs_handle,
+    service_id_t service_id)
+{
+	fibril_mutex_lock(&page_cache_mutex);
+
+	page_cache_generation++;
+
+	link_t *cur = list_first(&page_lru);
+	while (cur != NULL) {
+		link_t *next = list_next(cur, &page_lru);
+
+		page_cache_page_t *page = list_get_instance(cur,
+		    page_cache_page_t, lru_link);
+		if (page->file->triplet.fs_handle == fs_handle &&
+		    page->file->triplet.service_id == service_id)
+			page_cache_page_remove(page);
+
+		cur = next;
+	}
+
+	fibril_mutex_unlock(&page_cache_mutex);
+}
+
+/**
+ * @}
+ */
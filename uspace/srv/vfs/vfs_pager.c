@@ -40,24 +40,84 @@
 #include <fibril_synch.h>
 #include <errno.h>
 #include <as.h>
+#include <align.h>
+#include <macros.h>
+#include <mem.h>
+
+/** Find out whether a page of a file may be kept in the page cache.
+ *
+ * @param fd		File descriptor of the mapped file.
+ * @param offset	Offset of the page within the file.
+ * @param page_size	Size of the page.
+ * @param triplet	Place to store the identity of the file.
+ *
+ * @return True if the page may be cached.
+ */
+static bool vfs_page_cacheable(int fd, aoff64_t offset, size_t page_size,
+    vfs_triplet_t *triplet)
+{
+	if (page_size != PAGE_SIZE || ALIGN_DOWN(offset, PAGE_SIZE) != offset)
+		return false;
+
+	vfs_file_t *file = vfs_file_get(fd);
+	if (file == NULL)
+		return false;
+
+	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
+
+	bool cacheable = file->open_read &&
+	    file->node->type == VFS_NODE_FILE &&
+	    fs_info != NULL && fs_info->page_cache;
+
+	triplet->fs_handle = file->node->fs_handle;
+	triplet->service_id = file->node->service_id;
+	triplet->index = file->node->index;
+
+	vfs_file_put(file);
+	return cacheable;
+}
 
 void vfs_page_in(ipc_call_t *req)
 {
 	aoff64_t offset = ipc_get_arg1(req);
 	size_t page_size = ipc_get_arg2(req);
 	int fd = ipc_get_arg3(req);
+	vfs_triplet_t triplet;
 	void *page;
 	errno_t rc;
 
+	bool cacheable = vfs_page_cacheable(fd, offset, page_size, &triplet);
+
 	page = as_area_create(AS_AREA_ANY, page_size,
 	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
 	    AS_AREA_UNPAGED);
 
+	if (page == AS_MAP_FAILED && vfs_page_cache_shrink(page_size /
+	    PAGE_SIZE) > 0) {
+		page = as_area_create(AS_AREA_ANY, page_size,
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+		    AS_AREA_UNPAGED);
+	}
+
 	if (page == AS_MAP_FAILED) {
 		async_answer_0(req, ENOMEM);
 		return;
 	}
 
+	/*
+	 * The mapping receives a private copy of the cached page. Handing out
+	 * the cached page itself would let a writable mapping modify the
+	 * cache.
+	 */
+	size_t cached;
+	if (cacheable && vfs_page_cache_copy(&triplet, offset, page, &cached)) {
+		async_answer_1(req, EOK, (sysarg_t) page);
+		as_area_destroy(page);
+		return;
+	}
+
+	uint64_t gen = vfs_page_cache_gen();
+
 	rdwr_io_chunk_t chunk = {
 		.buffer = page,
 		.size = page_size
@@ -79,12 +139,15 @@ void vfs_page_in(ipc_call_t *req)
 
 	async_answer_1(req, rc, (sysarg_t) page);
 
-	/*
-	 * FIXME:
-	 * This is just for now until we implement proper page cache
-	 * management.  Not keeping the pages around in a cache results in
-	 * inherently non-coherent private mappings.
-	 */
+	if (rc == EOK && cacheable) {
+		void *data = vfs_page_cache_alloc();
+		if (data != NULL) {
+			memcpy(data, page, total);
+			vfs_page_cache_insert(&triplet, offset, data, total,
+			    gen);
+		}
+	}
+
 	as_area_destroy(page);
 }
 